@@ -9,12 +9,34 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Traces above this level (0 errors ... 3 debug) or outside these categories
+# (bit mask of Trace::Category) are compiled out; see trace.h
+#DEFINES += TRACE_LEVEL=1 TRACE_CATEGORIES=0xFFFFFFFF
+
 SOURCES += \
     bolus.cpp \
+    bolusBatch.cpp \
+    bolusHistory.cpp \
+    bolusPool.cpp \
+    cohortSimulator.cpp \
+    controller.cpp \
+    controllerBenchmark.cpp \
+    deliveryScheduler.cpp \
+    eventLog.cpp \
+    eventQueue.cpp \
+    glucoseModel.cpp \
     home.cpp \
+    insulinOnBoard.cpp \
     log.cpp \
+    logArchive.cpp \
+    logFormat.cpp \
+    logRingBuffer.cpp \
+    logStore.cpp \
+    logTableModel.cpp \
     main.cpp \
     mainwindow.cpp \
+    monteCarloRunner.cpp \
+    patientSimulation.cpp \
     pump.cpp \
     qboluswindow.cpp \
     qerrormessage.cpp \
@@ -23,14 +45,45 @@ SOURCES += \
     qoptionsmenu.cpp \
     qpersonalprofiles.cpp \
     profile.cpp \
+    profileArena.cpp \
+    profileBenchmark.cpp \
+    profileIndex.cpp \
     profileManager.cpp \
+    profileStore.cpp \
+    profileTransfer.cpp \
+    realTimePacer.cpp \
+    simulationEngine.cpp \
+    snapshot.cpp \
+    trace.cpp \
+    workStealingPool.cpp \
 
 
 HEADERS += \
     bolus.h \
+    bolusBatch.h \
+    bolusHistory.h \
+    bolusPool.h \
+    bolusRules.h \
+    cohortSimulator.h \
+    controller.h \
+    controllerBenchmark.h \
+    deliveryScheduler.h \
+    eventLog.h \
+    eventQueue.h \
+    glucoseModel.h \
     home.h \
+    homeRules.h \
+    insulinOnBoard.h \
     log.h \
+    logArchive.h \
+    logFormat.h \
+    logRingBuffer.h \
+    logStore.h \
+    logTableModel.h \
     mainwindow.h \
+    monteCarloRunner.h \
+    odeIntegrator.h \
+    patientSimulation.h \
     pump.h \
     qboluswindow.h \
     qerrormessage.h \
@@ -39,7 +92,19 @@ HEADERS += \
     qoptionsmenu.h \
     qpersonalprofiles.h \
     profile.h \
-    profileManager.h
+    profileArena.h \
+    profileBenchmark.h \
+    profileIndex.h \
+    profileManager.h \
+    profileRules.h \
+    profileStore.h \
+    profileTransfer.h \
+    realTimePacer.h \
+    simulationEngine.h \
+    snapshot.h \
+    trace.h \
+    units.h \
+    workStealingPool.h
 
 FORMS += \
     mainwindow.ui \
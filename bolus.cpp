@@ -1,47 +1,58 @@
 #include "bolus.h"
-#include <iostream>
+#include "bolusRules.h"
+#include "trace.h"
 #include <cmath>
 #include <algorithm>
+#include "snapshot.h"
 
 using namespace std;
 
 // Constructor
-Bolus::Bolus(const string& bolusID, float glucoseLevel, float carbIntake, Profile* profile)
+Bolus::Bolus(const string& bolusID, float glucoseLevel, float carbIntake, const Profile* profile)
   : bolusID(bolusID), glucoseLevel(glucoseLevel), carbIntake(carbIntake),
-    appropriateDose(0.0f), iob(0.0f), patientProfile(profile)
+    appropriateDose(0.0f), iob(0.0f)
 {
+  setProfile(profile);
+}
+
+void Bolus::setProfile(const Profile* profile)
+{
+  profileVersion = profile ? profile->getVersion() : nullptr;
 }
 
 // Calculates final bolus dose based on user input and profile settings
 void Bolus::calculateFinalBolus()
 {
-  if (!patientProfile) {
-      cerr << "[Error] No profile available. Cannot calculate bolus with missing ratios.\n";
+  if (!profileVersion) {
+      TRACE(Error, Bolus, "[Error] No profile available. Cannot calculate bolus with missing ratios.");
       appropriateDose = 0.0f;
       return;
   }
 
-  float icr = patientProfile->getCarbohydratesRatio();
-  float cf = (overrideCorrectionFactor > 0.0f) ? overrideCorrectionFactor : patientProfile->getCorrectionFactor();
-  float targetBG = patientProfile->getTargetGlucoseLevels();
+  if (iobSource) {
+      iob = iobSource->getIOB();
+  }
 
-  if (icr <= 0.0f || cf <= 0.0f || targetBG <= 0.0f) {
-      cerr << "[Error] Invalid profile settings: ICR, Correction Factor, and Target BG must all be greater than 0.\n";
+  const ProfileSegment& segment = profileVersion->segmentAt(minuteOfDay);
+  float icr = segment.carbohydratesRatio;
+  float cf = (overrideCorrectionFactor > 0.0f) ? overrideCorrectionFactor : segment.correctionFactor;
+  float targetBG = segment.targetGlucoseLevels;
+
+  if (!BolusRules::validSettings(icr, cf, targetBG)) {
+      TRACE(Error, Bolus, "[Error] Invalid profile settings: ICR, Correction Factor, and Target BG must all be greater than 0.");
       appropriateDose = 0.0f;
       return;
   }
 
-  float foodBolus = carbIntake / icr;
-  float correctionBolus = max((glucoseLevel - targetBG) / cf, 0.0f);
-
-  float totalBolus = foodBolus + correctionBolus;
-  appropriateDose = max(totalBolus - iob, 0.0f);
+  float foodBolus = BolusRules::foodBolus(carbIntake, icr);
+  float correctionBolus = BolusRules::correctionBolus(glucoseLevel, targetBG, cf);
+  appropriateDose = BolusRules::finalDose(foodBolus, correctionBolus, iob);
 
-  cout << "[Calculation Summary]\n";
-  cout << "  Food Bolus:       " << foodBolus << " units\n";
-  cout << "  Correction Bolus: " << correctionBolus << " units\n";
-  cout << "  IOB:              " << iob << " units\n";
-  cout << "  Final Bolus:      " << appropriateDose << " units\n";
+  TRACE(Debug, Bolus, "[Calculation Summary]\n"
+        << "  Food Bolus:       " << foodBolus << " units\n"
+        << "  Correction Bolus: " << correctionBolus << " units\n"
+        << "  IOB:              " << iob << " units\n"
+        << "  Final Bolus:      " << appropriateDose << " units");
 }
 
 // Recalculate after input change
@@ -50,36 +61,62 @@ void Bolus::adjustDose()
   calculateFinalBolus();
 }
 
+// What the pump can actually give of the calculated dose
+InsulinUnits Bolus::getDeliverableDose() const
+{
+  return InsulinUnits::fromTicks(BolusRules::deliverableTicks(appropriateDose));
+}
+
+// Portion of the dose delivered right away for the chosen bolus type
+InsulinUnits Bolus::getImmediateDose() const
+{
+  switch (deliveryType) {
+  case QUICK:    return getDeliverableDose().scaled(QUICK_PERCENT, 100).roundDown(BolusRules::PULSE);
+  case EXTENDED: return InsulinUnits();
+  default:       return getDeliverableDose();
+  }
+}
+
+// Portion spread over the extended duration
+InsulinUnits Bolus::getExtendedDose() const
+{
+  if (deliveryType != EXTENDED) {
+      return InsulinUnits();
+  }
+  return getDeliverableDose().scaled(EXTENDED_PERCENT, 100).roundDown(BolusRules::PULSE);
+}
+
 // Quick bolus: immediate 60%
 void Bolus::quickBolus()
 {
-  float dose = 0.6f * appropriateDose;
-  cout << "Quick Bolus: " << dose << " units delivered immediately.\n";
+  deliveryType = QUICK;
+  InsulinUnits dose = getImmediateDose();
+  TRACE(Info, Bolus, "Quick Bolus: " << dose.toFloat() << " units delivered immediately.");
 }
 
-// Extended bolus: 40% over time (no simulation, just math)
+// Extended bolus: 40% over time; the pump's DeliveryScheduler does the delivery
 void Bolus::extendedBolus(int durationHours) {
-    float dose = 0.4f * appropriateDose;
+    deliveryType = EXTENDED;
+    float dose = getExtendedDose().toFloat();
 
     if (durationHours <= 0) {
-        cout << "[Warning] Invalid extended bolus time. Defaulting to 1 hour.\n";
+        TRACE(Warning, Bolus, "[Warning] Invalid extended bolus time. Defaulting to 1 hour.");
         durationHours = 1;
     }
 
-    float hourlyRate = dose / durationHours;
-    cout << "Extended Bolus: " << dose << " units scheduled over " << durationHours
-         << " hours (" << hourlyRate << " units/hour).\n";
+    TRACE(Info, Bolus, "Extended Bolus: " << dose << " units scheduled over " << durationHours
+          << " hours (" << dose / durationHours << " units/hour).");
 }
 
 // Pause bolus delivery
 void Bolus::pauseDelivery() {
     if (deliveryState == ACTIVE) {
         deliveryState = PAUSED;
-        cout << "Bolus " << bolusID << " delivery paused." << endl;
+        TRACE(Info, Bolus, "Bolus " << bolusID << " delivery paused.");
     } else if (deliveryState == CANCELED) {
-        cout << "Cannot pause: Bolus " << bolusID << " has already been canceled." << endl;
+        TRACE(Warning, Bolus, "Cannot pause: Bolus " << bolusID << " has already been canceled.");
     } else {
-        cout << "Bolus " << bolusID << " is already paused." << endl;
+        TRACE(Warning, Bolus, "Bolus " << bolusID << " is already paused.");
     }
 }
 
@@ -87,11 +124,11 @@ void Bolus::pauseDelivery() {
 void Bolus::resumeDelivery() {
     if (deliveryState == PAUSED) {
         deliveryState = ACTIVE;
-        cout << "Bolus " << bolusID << " delivery resumed." << endl;
+        TRACE(Info, Bolus, "Bolus " << bolusID << " delivery resumed.");
     } else if (deliveryState == CANCELED) {
-        cout << "Cannot resume: Bolus " << bolusID << " has been canceled." << endl;
+        TRACE(Warning, Bolus, "Cannot resume: Bolus " << bolusID << " has been canceled.");
     } else {
-        cout << "Bolus " << bolusID << " is already active." << endl;
+        TRACE(Warning, Bolus, "Bolus " << bolusID << " is already active.");
     }
 }
 
@@ -99,9 +136,9 @@ void Bolus::resumeDelivery() {
 void Bolus::cancelDelivery() {
     if (deliveryState != CANCELED) {
         deliveryState = CANCELED;
-        cout << "Bolus " << bolusID << " delivery canceled." << endl;
+        TRACE(Info, Bolus, "Bolus " << bolusID << " delivery canceled.");
     } else {
-        cout << "Bolus " << bolusID << " is already canceled." << endl;
+        TRACE(Warning, Bolus, "Bolus " << bolusID << " is already canceled.");
     }
 }
 
@@ -151,6 +188,11 @@ void Bolus::setIOB(float insulinOnBoard)
    iob = insulinOnBoard;
 }
 
+void Bolus::setInsulinOnBoardSource(const InsulinOnBoard* source)
+{
+   iobSource = source;
+}
+
 void Bolus::setExtendedDuration(int hours) {
     extendedDurationHours = hours;
 }
@@ -172,3 +214,55 @@ void Bolus::setPaused(){
 void Bolus::setCanceled(){
     deliveryState = CANCELED;
 }
+
+void Bolus::saveState(SnapshotWriter& out) const {
+    out.writeString(bolusID);
+    out.write(glucoseLevel);
+    out.write(carbIntake);
+    out.write(appropriateDose);
+    out.write(iob);
+    out.write(overrideCorrectionFactor);
+    out.write(extendedDurationHours);
+    out.write(minuteOfDay);
+    out.write(delivered);
+    out.write(deliveryType);
+    out.write(deliveryState);
+    out.write(profileVersion != nullptr);
+    if (profileVersion) {
+        out.writeString(profileVersion->getMode());
+        out.writeVector(profileVersion->getSegments());
+        out.write(profileVersion->getRevision());
+    }
+}
+
+bool Bolus::restoreState(SnapshotReader& in) {
+    in.readString(bolusID);
+    in.read(glucoseLevel);
+    in.read(carbIntake);
+    in.read(appropriateDose);
+    in.read(iob);
+    in.read(overrideCorrectionFactor);
+    in.read(extendedDurationHours);
+    in.read(minuteOfDay);
+    in.read(delivered);
+    in.read(deliveryType);
+    in.read(deliveryState);
+
+    // The pinned version is saved whole, as the profile may since have changed
+    bool hasProfile = false;
+    in.read(hasProfile);
+    profileVersion = nullptr;
+    if (hasProfile) {
+        string mode;
+        vector<ProfileSegment> segments;
+        uint64_t revision = 0;
+        in.readString(mode);
+        in.readVector(segments);
+        in.read(revision);
+        if (!Profile::validSegmentTimes(segments)) {
+            return false;
+        }
+        profileVersion = make_shared<const ProfileVersion>(mode, segments, revision);
+    }
+    return in.isValid();
+}
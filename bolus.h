@@ -3,10 +3,22 @@
 
 #include <string>
 #include "profile.h"
+#include "insulinOnBoard.h"
+#include "units.h"
+
+class SnapshotWriter;
+class SnapshotReader;
 
 class Bolus {
 public:
-   Bolus(const std::string& bolusID, float glucoseLevel, float carbIntake, Profile* profile);
+   // How the dose is split over time
+   enum BolusType {
+       STANDARD, // whole dose now
+       QUICK,    // 60% now
+       EXTENDED  // 40% spread over the extended duration
+   };
+
+   Bolus(const std::string& bolusID, float glucoseLevel, float carbIntake, const Profile* profile);
 
    void calculateFinalBolus();
    void adjustDose(); // Recalculate if values change
@@ -20,24 +32,44 @@ public:
    bool isActive() const;
    bool isPaused() const;
    bool isCanceled() const;
+   bool isDelivered() const { return delivered; } // handed to the pump for delivery
+   void markDelivered() { delivered = true; }
 
    // Getters
    std::string getBolusID() const;
    float getGlucoseLevel() const;
    float getCarbIntake() const;
-   float getAppropriateDose() const;
+   float getAppropriateDose() const; // as calculated
+   InsulinUnits getDeliverableDose() const; // rounded down to whole pump pulses
    float getDeliveryState() { return deliveryState; }
+   BolusType getDeliveryType() const { return deliveryType; }
+   int getExtendedDuration() const { return extendedDurationHours; }
+   InsulinUnits getImmediateDose() const;
+   InsulinUnits getExtendedDose() const;
    // Setters
    void setGlucoseLevel(float glucose);
    void setCarbIntake(float carbs);
    void setAppropriateDose(float dose);
    void setCorrectionFactorOverride(float cf);
    void setIOB(float insulinOnBoard);
+   void setInsulinOnBoardSource(const InsulinOnBoard* source); // IOB is read from here at calculation time
    void setExtendedDuration(int hours);
+   // Time of day the bolus is for; picks the profile segment it is dosed with
+   void setMinuteOfDay(int minute) { minuteOfDay = minute; }
+   int getMinuteOfDay() const { return minuteOfDay; }
+   void setDeliveryType(BolusType type) { deliveryType = type; }
    void setActive();
    void setPaused();
    void setCanceled();
 
+   // Snapshot support; the IOB source is re-linked by the caller
+   void saveState(SnapshotWriter& out) const;
+   bool restoreState(SnapshotReader& in);
+   // The profile version the bolus is dosed with, pinned when the bolus is
+   // made; later edits or deleting the profile do not change it
+   const ProfileVersion* getProfileVersion() const { return profileVersion.get(); }
+   void setProfile(const Profile* profile);
+
 
 
 private:
@@ -46,8 +78,16 @@ private:
    float carbIntake;
    float appropriateDose;
    float iob;
+   const InsulinOnBoard* iobSource = nullptr;
    float overrideCorrectionFactor = 0.0f;
    int extendedDurationHours = 0;
+   int minuteOfDay = 0;
+   bool delivered = false; // dose handed to the pump's delivery scheduler
+   BolusType deliveryType = STANDARD;
+
+   // Shares of the deliverable dose, in percent so the split is exact
+   const int QUICK_PERCENT = 60;
+   const int EXTENDED_PERCENT = 40;
 
    // tracking bolus state
    enum BolusState {
@@ -57,7 +97,7 @@ private:
    };
    BolusState deliveryState = PAUSED;
 
-   Profile* patientProfile;
+   std::shared_ptr<const ProfileVersion> profileVersion;
 };
 
 #endif // BOLUS_H
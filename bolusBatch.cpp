@@ -0,0 +1,114 @@
+#include "bolusBatch.h"
+#include "bolusRules.h"
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+
+// Set bits in a 4-bit lane mask
+static const int LANES_SET[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+#endif
+
+// The kernels mirror BolusRules exactly: max(0, x) returns x unless 0 > x,
+// which keeps NaN and -0 where the scalar `x < 0 ? 0 : x` does, the
+// validity test is "not less or equal" so NaN settings pass the same way,
+// and NaN doses are replaced by the canonical quiet NaN. Deliverable ticks
+// are worked out in float, where every tick count below MAX_DOSE_TICKS is
+// exact: max(x, 0) sends NaN to zero, the conversion rounds to nearest even
+// like nearbyint, and truncating ticks / PULSE_TICKS equals the integer division.
+size_t BolusBatch::calculate(const BolusBatchInput& in, const BolusBatchOutput& out, size_t count) {
+    size_t rejected = 0;
+    size_t i = 0;
+
+#if defined(__AVX__)
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 quietNan = _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN());
+    const __m256 ticksPerUnit = _mm256_set1_ps(static_cast<float>(InsulinUnits::TICKS_PER_UNIT));
+    const __m256 maxTicks = _mm256_set1_ps(BolusRules::MAX_DOSE_TICKS);
+    const __m256 pulseTicks = _mm256_set1_ps(static_cast<float>(BolusRules::PULSE_TICKS));
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 icr = _mm256_loadu_ps(&in.carbohydratesRatio[i]);
+        __m256 cf = _mm256_loadu_ps(&in.correctionFactor[i]);
+        __m256 target = _mm256_loadu_ps(&in.targetGlucose[i]);
+        __m256 valid = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(icr, zero, _CMP_NLE_UQ),
+                                                   _mm256_cmp_ps(cf, zero, _CMP_NLE_UQ)),
+                                     _mm256_cmp_ps(target, zero, _CMP_NLE_UQ));
+
+        __m256 food = _mm256_div_ps(_mm256_loadu_ps(&in.carbIntake[i]), icr);
+        __m256 correction = _mm256_max_ps(zero, _mm256_div_ps(
+                _mm256_sub_ps(_mm256_loadu_ps(&in.glucoseLevel[i]), target), cf));
+        __m256 dose = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_add_ps(food, correction),
+                                                        _mm256_loadu_ps(&in.insulinOnBoard[i])));
+        __m256 nan = _mm256_cmp_ps(dose, dose, _CMP_UNORD_Q);
+        dose = _mm256_or_ps(_mm256_andnot_ps(nan, dose), _mm256_and_ps(nan, quietNan));
+
+        _mm256_storeu_ps(&out.foodBolus[i], _mm256_and_ps(valid, food));
+        _mm256_storeu_ps(&out.correctionBolus[i], _mm256_and_ps(valid, correction));
+        _mm256_storeu_ps(&out.dose[i], _mm256_and_ps(valid, dose));
+        if (out.deliverableTicks) {
+            __m256 ticks = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(dose, ticksPerUnit), zero), maxTicks);
+            ticks = _mm256_round_ps(ticks, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            __m256 pulses = _mm256_round_ps(_mm256_div_ps(ticks, pulseTicks), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out.deliverableTicks[i]),
+                                _mm256_cvttps_epi32(_mm256_and_ps(valid, _mm256_mul_ps(pulses, pulseTicks))));
+        }
+        int mask = _mm256_movemask_ps(valid);
+        rejected += 8 - LANES_SET[mask & 15] - LANES_SET[mask >> 4];
+    }
+#elif defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 quietNan = _mm_set1_ps(std::numeric_limits<float>::quiet_NaN());
+    const __m128 ticksPerUnit = _mm_set1_ps(static_cast<float>(InsulinUnits::TICKS_PER_UNIT));
+    const __m128 maxTicks = _mm_set1_ps(BolusRules::MAX_DOSE_TICKS);
+    const __m128 pulseTicks = _mm_set1_ps(static_cast<float>(BolusRules::PULSE_TICKS));
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 icr = _mm_loadu_ps(&in.carbohydratesRatio[i]);
+        __m128 cf = _mm_loadu_ps(&in.correctionFactor[i]);
+        __m128 target = _mm_loadu_ps(&in.targetGlucose[i]);
+        __m128 valid = _mm_and_ps(_mm_and_ps(_mm_cmpnle_ps(icr, zero), _mm_cmpnle_ps(cf, zero)),
+                                  _mm_cmpnle_ps(target, zero));
+
+        __m128 food = _mm_div_ps(_mm_loadu_ps(&in.carbIntake[i]), icr);
+        __m128 correction = _mm_max_ps(zero, _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(&in.glucoseLevel[i]), target), cf));
+        __m128 dose = _mm_max_ps(zero, _mm_sub_ps(_mm_add_ps(food, correction), _mm_loadu_ps(&in.insulinOnBoard[i])));
+        __m128 nan = _mm_cmpunord_ps(dose, dose);
+        dose = _mm_or_ps(_mm_andnot_ps(nan, dose), _mm_and_ps(nan, quietNan));
+
+        _mm_storeu_ps(&out.foodBolus[i], _mm_and_ps(valid, food));
+        _mm_storeu_ps(&out.correctionBolus[i], _mm_and_ps(valid, correction));
+        _mm_storeu_ps(&out.dose[i], _mm_and_ps(valid, dose));
+        if (out.deliverableTicks) {
+            __m128 ticks = _mm_min_ps(_mm_max_ps(_mm_mul_ps(dose, ticksPerUnit), zero), maxTicks);
+            ticks = _mm_cvtepi32_ps(_mm_cvtps_epi32(ticks));
+            __m128 pulses = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(ticks, pulseTicks)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&out.deliverableTicks[i]),
+                             _mm_cvttps_epi32(_mm_and_ps(valid, _mm_mul_ps(pulses, pulseTicks))));
+        }
+        rejected += 4 - LANES_SET[_mm_movemask_ps(valid)];
+    }
+#endif
+
+    // Scalar tail (and fallback) is the single-bolus rule itself
+    for (; i < count; ++i) {
+        if (!BolusRules::validSettings(in.carbohydratesRatio[i], in.correctionFactor[i], in.targetGlucose[i])) {
+            out.foodBolus[i] = 0.0f;
+            out.correctionBolus[i] = 0.0f;
+            out.dose[i] = 0.0f;
+            if (out.deliverableTicks) {
+                out.deliverableTicks[i] = 0;
+            }
+            ++rejected;
+            continue;
+        }
+        float food = BolusRules::foodBolus(in.carbIntake[i], in.carbohydratesRatio[i]);
+        float correction = BolusRules::correctionBolus(in.glucoseLevel[i], in.targetGlucose[i], in.correctionFactor[i]);
+        out.foodBolus[i] = food;
+        out.correctionBolus[i] = correction;
+        out.dose[i] = BolusRules::finalDose(food, correction, in.insulinOnBoard[i]);
+        if (out.deliverableTicks) {
+            out.deliverableTicks[i] = BolusRules::deliverableTicks(out.dose[i]);
+        }
+    }
+    return rejected;
+}
@@ -0,0 +1,36 @@
+#ifndef BOLUSBATCH_H
+#define BOLUSBATCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Parallel input arrays, one row per dose to calculate. Rows carry their
+// own settings, so a what-if grid can vary any of them.
+struct BolusBatchInput {
+    const float* glucoseLevel;
+    const float* carbIntake;
+    const float* insulinOnBoard;
+    const float* carbohydratesRatio;
+    const float* correctionFactor;     // already overridden where the caller wants
+    const float* targetGlucose;
+};
+
+// Output arrays; rows with invalid settings get zero in all of them, like
+// a single Bolus does
+struct BolusBatchOutput {
+    float* foodBolus;
+    float* correctionBolus;
+    float* dose;
+    int32_t* deliverableTicks = nullptr; // optional: the dose in whole pump pulses, as insulin ticks
+};
+
+// Calculates many boluses in one pass with SSE/AVX kernels. Every row
+// follows BolusRules, so the results equal Bolus::calculateFinalBolus()
+// bit for bit, without its logging.
+class BolusBatch {
+    public:
+        // Returns the number of rows rejected for invalid settings
+        static size_t calculate(const BolusBatchInput& in, const BolusBatchOutput& out, size_t count);
+};
+
+#endif // BOLUSBATCH_H
@@ -0,0 +1,76 @@
+#include "bolusHistory.h"
+#include <algorithm>
+#include "snapshot.h"
+
+BolusHistory::BolusHistory() : delivering(0) {}
+
+uint32_t BolusHistory::add(long long now, InsulinUnits dose, InsulinUnits plannedUnits, int extendedSeconds,
+                           uint8_t type, Origin origin) {
+    BolusEntry entry;
+    entry.startSecond = now;
+    entry.lastPulseSecond = now;
+    entry.dose = dose;
+    entry.plannedUnits = plannedUnits;
+    entry.deliveredUnits = InsulinUnits();
+    entry.extendedSeconds = extendedSeconds;
+    entry.type = type;
+    entry.state = Delivering;
+    entry.origin = origin;
+    entry.reserved = 0;
+    entries.push_back(entry);
+    ++delivering;
+    return static_cast<uint32_t>(entries.size() - 1);
+}
+
+void BolusHistory::recordPulse(uint32_t entry, InsulinUnits units, long long now) {
+    if (entry >= entries.size()) {
+        return;
+    }
+    BolusEntry& e = entries[entry];
+    e.deliveredUnits += units;
+    e.lastPulseSecond = now;
+}
+
+void BolusHistory::finish(uint32_t entry, State state) {
+    if (entry >= entries.size() || entries[entry].state != Delivering) {
+        return;
+    }
+    entries[entry].state = state;
+    --delivering;
+}
+
+void BolusHistory::clear() {
+    entries.clear();
+    delivering = 0;
+}
+
+std::pair<size_t, size_t> BolusHistory::startedBetween(long long from, long long to) const {
+    auto byStart = [](const BolusEntry& e, long long t) { return e.startSecond < t; };
+    size_t first = std::lower_bound(entries.begin(), entries.end(), from, byStart) - entries.begin();
+    size_t last = std::lower_bound(entries.begin() + first, entries.end(), to, byStart) - entries.begin();
+    return std::make_pair(first, last);
+}
+
+InsulinUnits BolusHistory::deliveredBetween(long long from, long long to) const {
+    std::pair<size_t, size_t> range = startedBetween(from, to);
+    InsulinUnits units;
+    for (size_t i = range.first; i < range.second; ++i) {
+        units += entries[i].deliveredUnits;
+    }
+    return units;
+}
+
+void BolusHistory::saveState(SnapshotWriter& out) const {
+    out.writeVector(entries);
+}
+
+bool BolusHistory::restoreState(SnapshotReader& in) {
+    clear();
+    if (!in.readVector(entries)) {
+        return false;
+    }
+    for (const BolusEntry& e : entries) {
+        delivering += (e.state == Delivering) ? 1 : 0;
+    }
+    return true;
+}
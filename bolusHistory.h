@@ -0,0 +1,72 @@
+#ifndef BOLUSHISTORY_H
+#define BOLUSHISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "units.h"
+
+class SnapshotWriter;
+class SnapshotReader;
+
+// One bolus as the pump delivered it. Times are simulated seconds.
+struct BolusEntry {
+    int64_t startSecond;        // when the delivery was queued
+    int64_t lastPulseSecond;    // latest pulse delivered; startSecond before the first
+    InsulinUnits dose;          // calculated dose, to the nearest tick
+    InsulinUnits plannedUnits;  // units queued, after rounding to pump pulses
+    InsulinUnits deliveredUnits;
+    int32_t extendedSeconds;    // 0 unless part of the dose was spread out
+    uint8_t type;               // Bolus::BolusType
+    uint8_t state;              // BolusHistory::State
+    uint8_t origin;             // BolusHistory::Origin
+    uint8_t reserved;
+};
+static_assert(sizeof(BolusEntry) == 48, "BolusEntry is saved as raw bytes");
+
+// Every bolus the pump has queued, in the order queued and so by start
+// time. Entries are only ever appended; delivery progress is updated in
+// place until the entry is finished. Time queries for reporting
+// binary-search the start times, so they stay cheap however long the
+// history grows. Insulin on board is not taken from here: it also counts
+// basal pulses, which InsulinOnBoard follows pulse by pulse.
+class BolusHistory {
+    public:
+        enum State : uint8_t {Delivering, Completed, Canceled};
+        enum Origin : uint8_t {
+            Manual,     // calculated in the bolus window and started from home
+            Pump,       // deliverBolus/deliverQuickBolus/deliverExtendedBolus
+            Controller  // closed-loop correction
+        };
+
+        static const uint32_t NO_ENTRY = 0xFFFFFFFFu;
+
+        BolusHistory();
+
+        // `now` must not be before the previous entry's start
+        uint32_t add(long long now, InsulinUnits dose, InsulinUnits plannedUnits, int extendedSeconds,
+                     uint8_t type, Origin origin);
+        void recordPulse(uint32_t entry, InsulinUnits units, long long now);
+        void finish(uint32_t entry, State state);
+
+        const BolusEntry& at(uint32_t entry) const { return entries[entry]; }
+        size_t size() const { return entries.size(); }
+        size_t getDeliveringCount() const { return delivering; }
+        void clear();
+
+        // Entries [first, last) started in [from, to)
+        std::pair<size_t, size_t> startedBetween(long long from, long long to) const;
+        // Insulin delivered by entries started in [from, to); exact, as
+        // entries hold whole ticks
+        InsulinUnits deliveredBetween(long long from, long long to) const;
+
+        void saveState(SnapshotWriter& out) const;
+        bool restoreState(SnapshotReader& in);
+
+    private:
+        std::vector<BolusEntry> entries;
+        size_t delivering;
+};
+
+#endif // BOLUSHISTORY_H
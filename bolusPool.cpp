@@ -0,0 +1,33 @@
+#include "bolusPool.h"
+
+BolusPool::BolusPool() : freeList(nullptr), used(BLOCK_BOLUSES), count(0) {}
+
+BolusPool::~BolusPool() {}
+
+// Reuse a freed cell first, then carve the next one from the last block
+BolusPool::Cell* BolusPool::takeCell() {
+    if (freeList) {
+        Cell* cell = freeList;
+        freeList = cell->next;
+        return cell;
+    }
+    if (used == BLOCK_BOLUSES) {
+        blocks.emplace_back(new Cell[BLOCK_BOLUSES]);
+        used = 0;
+    }
+    return &blocks.back()[used++];
+}
+
+void BolusPool::releaseCell(Cell* cell) {
+    cell->next = freeList;
+    freeList = cell;
+}
+
+void BolusPool::destroy(Bolus* b) {
+    if (!b) {
+        return;
+    }
+    b->~Bolus();
+    releaseCell(reinterpret_cast<Cell*>(b));
+    --count;
+}
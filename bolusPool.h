@@ -0,0 +1,57 @@
+#ifndef BOLUSPOOL_H
+#define BOLUSPOOL_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include "bolus.h"
+
+// Slab storage for the pump's boluses, laid out like ProfileArena: boluses
+// are built in place in fixed-size blocks that never move, and a finished
+// bolus's cell is reused by the next one, so steady use allocates nothing.
+class BolusPool {
+    public:
+        BolusPool();
+        ~BolusPool();
+
+        BolusPool(const BolusPool&) = delete;
+        BolusPool& operator=(const BolusPool&) = delete;
+
+        template <class... Args>
+        Bolus* create(Args&&... args) {
+            Cell* cell = takeCell();
+            try {
+                Bolus* b = new (cell->storage) Bolus(std::forward<Args>(args)...);
+                ++count;
+                return b;
+            } catch (...) {
+                releaseCell(cell);
+                throw;
+            }
+        }
+
+        // `b` must have come from this pool
+        void destroy(Bolus* b);
+
+        size_t size() const { return count; }
+
+        static const size_t BLOCK_BOLUSES = 16;
+
+    private:
+        union Cell {
+            Cell* next; // while free
+            alignas(Bolus) unsigned char storage[sizeof(Bolus)];
+        };
+
+        Cell* takeCell();
+        void releaseCell(Cell* cell);
+
+        std::vector<std::unique_ptr<Cell[]>> blocks;
+        Cell* freeList;
+        size_t used;    // cells handed out from the last block
+        size_t count;
+};
+
+#endif // BOLUSPOOL_H
@@ -0,0 +1,63 @@
+#ifndef BOLUSRULES_H
+#define BOLUSRULES_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include "units.h"
+
+// Dose arithmetic shared by Bolus (one dose) and BolusBatch (many), so a
+// batch row comes out bit-identical to the same bolus calculated alone.
+// Each step is one IEEE operation, which the SSE/AVX kernels repeat lane by lane.
+namespace BolusRules {
+
+    // The ratios and target must all be positive. Written as the negation
+    // of the rejection test so a NaN setting is let through, as before.
+    inline bool validSettings(float carbohydratesRatio, float correctionFactor, float targetGlucose) {
+        return !(carbohydratesRatio <= 0.0f || correctionFactor <= 0.0f || targetGlucose <= 0.0f);
+    }
+
+    inline float foodBolus(float carbIntake, float carbohydratesRatio) {
+        return carbIntake / carbohydratesRatio;
+    }
+
+    // Only high glucose is corrected
+    inline float correctionBolus(float glucoseLevel, float targetGlucose, float correctionFactor) {
+        float correction = (glucoseLevel - targetGlucose) / correctionFactor;
+        return (correction < 0.0f) ? 0.0f : correction;
+    }
+
+    // Insulin already on board is subtracted; the dose is never negative.
+    // The compiler may swap the operands of the sum, which changes which
+    // NaN comes out, so a NaN dose is always the one canonical quiet NaN.
+    inline float finalDose(float foodBolus, float correctionBolus, float insulinOnBoard) {
+        float dose = (foodBolus + correctionBolus) - insulinOnBoard;
+        if (dose != dose) {
+            return std::numeric_limits<float>::quiet_NaN();
+        }
+        return (dose < 0.0f) ? 0.0f : dose;
+    }
+
+    // Pump resolution: insulin goes out in whole pulses
+    constexpr int32_t PULSE_TICKS = 50;
+    constexpr InsulinUnits PULSE = InsulinUnits::fromTicks(PULSE_TICKS); // 0.05 U
+    constexpr float MAX_DOSE_TICKS = 1000000.0f; // 1000 U; tick counts stay exact in a float
+
+    // The part of a calculated dose the pump can deliver, in insulin ticks:
+    // the dose to the nearest tick (ties to even, like the SIMD conversion),
+    // then down to whole pulses so the pump never gives more than was
+    // calculated. NaN and negative doses deliver nothing.
+    inline int32_t deliverableTicks(float dose) {
+        float ticks = dose * static_cast<float>(InsulinUnits::TICKS_PER_UNIT);
+        if (!(ticks > 0.0f)) {
+            return 0;
+        }
+        if (ticks > MAX_DOSE_TICKS) {
+            ticks = MAX_DOSE_TICKS;
+        }
+        int32_t whole = static_cast<int32_t>(std::nearbyint(ticks));
+        return whole - whole % PULSE_TICKS;
+    }
+}
+
+#endif // BOLUSRULES_H
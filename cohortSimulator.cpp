@@ -0,0 +1,183 @@
+#include "cohortSimulator.h"
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+CohortSimulator::CohortSimulator() : elapsedSeconds(0) {}
+
+void CohortSimulator::reserve(size_t patients) {
+    glucose.reserve(patients);
+    iob.reserve(patients);
+    battery.reserve(patients);
+    reservoir.reserve(patients);
+    chargingMask.reserve(patients);
+    activeMask.reserve(patients);
+    targetGlucose.reserve(patients);
+}
+
+size_t CohortSimulator::addPatient(const Profile& profile, float initialGlucose) {
+    glucose.push_back(initialGlucose);
+    iob.push_back(0.0f);
+    battery.push_back(HomeRules::MAX_BATTERY);
+    reservoir.push_back(InsulinUnits::fromWhole(HomeRules::RESERVOIR_CAPACITY));
+    chargingMask.push_back(0u);
+    activeMask.push_back(0u);
+
+    targetGlucose.push_back(profile.getTargetGlucoseLevels());
+    return glucose.size() - 1;
+}
+
+void CohortSimulator::setCharging(size_t patient, bool isCharging) {
+    chargingMask[patient] = isCharging ? 0xFFFFFFFFu : 0u;
+}
+
+void CohortSimulator::setBolusActive(size_t patient, bool active) {
+    activeMask[patient] = active ? 0xFFFFFFFFu : 0u;
+}
+
+void CohortSimulator::setIOB(size_t patient, float insulinOnBoard) {
+    iob[patient] = (insulinOnBoard < 0.0f) ? 0.0f : insulinOnBoard;
+}
+
+void CohortSimulator::recordInsulinDose(size_t patient, InsulinUnits units) {
+    iob[patient] += units.toFloat();
+    InsulinUnits left = reservoir[patient] - units;
+    reservoir[patient] = (left < InsulinUnits()) ? InsulinUnits() : left;
+}
+
+void CohortSimulator::runSeconds(long long seconds) {
+    // Split the run at minute boundaries so minute ticks line up with SimulationEngine
+    while (seconds > 0) {
+        int toMinute = 60 - static_cast<int>(elapsedSeconds % 60);
+        int chunk = (seconds < toMinute) ? static_cast<int>(seconds) : toMinute;
+        stepBlock(chunk, chunk == toMinute);
+        elapsedSeconds += chunk;
+        seconds -= chunk;
+    }
+}
+
+void CohortSimulator::stepBlock(int seconds, bool minuteTick) {
+    const size_t n = size();
+    size_t i = 0;
+
+#if defined(__AVX__)
+    const __m256 step = _mm256_set1_ps(HomeRules::GLUCOSE_STEP);
+    const __m256 negStep = _mm256_set1_ps(-HomeRules::GLUCOSE_STEP);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 maxBattery = _mm256_set1_ps(HomeRules::MAX_BATTERY);
+    const __m256 chargeRate = _mm256_set1_ps(HomeRules::CHARGE_RATE);
+    const __m256 drainRate = _mm256_set1_ps(-HomeRules::PASSIVE_DRAIN_RATE);
+    const __m256 iobDecay = _mm256_set1_ps(HomeRules::IOB_DECAY_PER_MINUTE);
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 g = _mm256_loadu_ps(&glucose[i]);
+        __m256 t = _mm256_loadu_ps(&targetGlucose[i]);
+        __m256 active = _mm256_loadu_ps(reinterpret_cast<const float*>(&activeMask[i]));
+
+        // Glucose steps toward target, only for patients with an active bolus
+        for (int s = 0; s < seconds; ++s) {
+            __m256 up = _mm256_and_ps(_mm256_cmp_ps(t, g, _CMP_GT_OQ), step);
+            __m256 down = _mm256_and_ps(_mm256_cmp_ps(t, g, _CMP_LT_OQ), negStep);
+            g = _mm256_add_ps(g, _mm256_and_ps(active, _mm256_or_ps(up, down)));
+        }
+        _mm256_storeu_ps(&glucose[i], g);
+
+        if (minuteTick) {
+            // Battery: charge toward 100, otherwise passive drain toward 0
+            __m256 b = _mm256_loadu_ps(&battery[i]);
+            __m256 charging = _mm256_loadu_ps(reinterpret_cast<const float*>(&chargingMask[i]));
+            __m256 up = _mm256_and_ps(charging, _mm256_cmp_ps(b, maxBattery, _CMP_LT_OQ));
+            __m256 down = _mm256_andnot_ps(charging, _mm256_cmp_ps(b, zero, _CMP_GT_OQ));
+            __m256 delta = _mm256_or_ps(_mm256_and_ps(up, chargeRate), _mm256_and_ps(down, drainRate));
+            b = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(b, delta), zero), maxBattery);
+            _mm256_storeu_ps(&battery[i], b);
+
+            // IOB: fixed decay, never negative
+            __m256 x = _mm256_loadu_ps(&iob[i]);
+            __m256 positive = _mm256_cmp_ps(x, zero, _CMP_GT_OQ);
+            __m256 decayed = _mm256_max_ps(_mm256_sub_ps(x, iobDecay), zero);
+            x = _mm256_or_ps(_mm256_and_ps(positive, decayed), _mm256_andnot_ps(positive, x));
+            _mm256_storeu_ps(&iob[i], x);
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128 step = _mm_set1_ps(HomeRules::GLUCOSE_STEP);
+    const __m128 negStep = _mm_set1_ps(-HomeRules::GLUCOSE_STEP);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxBattery = _mm_set1_ps(HomeRules::MAX_BATTERY);
+    const __m128 chargeRate = _mm_set1_ps(HomeRules::CHARGE_RATE);
+    const __m128 drainRate = _mm_set1_ps(-HomeRules::PASSIVE_DRAIN_RATE);
+    const __m128 iobDecay = _mm_set1_ps(HomeRules::IOB_DECAY_PER_MINUTE);
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 g = _mm_loadu_ps(&glucose[i]);
+        __m128 t = _mm_loadu_ps(&targetGlucose[i]);
+        __m128 active = _mm_loadu_ps(reinterpret_cast<const float*>(&activeMask[i]));
+
+        // Glucose steps toward target, only for patients with an active bolus
+        for (int s = 0; s < seconds; ++s) {
+            __m128 up = _mm_and_ps(_mm_cmpgt_ps(t, g), step);
+            __m128 down = _mm_and_ps(_mm_cmplt_ps(t, g), negStep);
+            g = _mm_add_ps(g, _mm_and_ps(active, _mm_or_ps(up, down)));
+        }
+        _mm_storeu_ps(&glucose[i], g);
+
+        if (minuteTick) {
+            // Battery: charge toward 100, otherwise passive drain toward 0
+            __m128 b = _mm_loadu_ps(&battery[i]);
+            __m128 charging = _mm_loadu_ps(reinterpret_cast<const float*>(&chargingMask[i]));
+            __m128 up = _mm_and_ps(charging, _mm_cmplt_ps(b, maxBattery));
+            __m128 down = _mm_andnot_ps(charging, _mm_cmpgt_ps(b, zero));
+            __m128 delta = _mm_or_ps(_mm_and_ps(up, chargeRate), _mm_and_ps(down, drainRate));
+            b = _mm_min_ps(_mm_max_ps(_mm_add_ps(b, delta), zero), maxBattery);
+            _mm_storeu_ps(&battery[i], b);
+
+            // IOB: fixed decay, never negative
+            __m128 x = _mm_loadu_ps(&iob[i]);
+            __m128 positive = _mm_cmpgt_ps(x, zero);
+            __m128 decayed = _mm_max_ps(_mm_sub_ps(x, iobDecay), zero);
+            x = _mm_or_ps(_mm_and_ps(positive, decayed), _mm_andnot_ps(positive, x));
+            _mm_storeu_ps(&iob[i], x);
+        }
+    }
+#endif
+
+    // Scalar tail (and fallback) uses the same rules as Home
+    for (; i < n; ++i) {
+        if (activeMask[i]) {
+            for (int s = 0; s < seconds; ++s) {
+                glucose[i] = HomeRules::glucoseStep(glucose[i], targetGlucose[i]);
+            }
+        }
+        if (minuteTick) {
+            battery[i] = HomeRules::batteryTick(battery[i], chargingMask[i] != 0u);
+            iob[i] = HomeRules::iobTick(iob[i]);
+        }
+    }
+}
+
+size_t CohortSimulator::countLowBattery() const {
+    size_t count = 0;
+    for (float b : battery) {
+        count += (b < HomeRules::LOW_BATTERY_THRESHOLD) ? 1 : 0;
+    }
+    return count;
+}
+
+size_t CohortSimulator::countCriticalBattery() const {
+    size_t count = 0;
+    for (float b : battery) {
+        count += (b <= HomeRules::CRITICAL_BATTERY_THRESHOLD) ? 1 : 0;
+    }
+    return count;
+}
+
+size_t CohortSimulator::countLowInsulin() const {
+    size_t count = 0;
+    const InsulinUnits threshold = InsulinUnits::fromWhole(HomeRules::LOW_INSULIN_THRESHOLD);
+    for (InsulinUnits remaining : reservoir) {
+        count += (remaining < threshold) ? 1 : 0;
+    }
+    return count;
+}
@@ -0,0 +1,73 @@
+#ifndef COHORTSIMULATOR_H
+#define COHORTSIMULATOR_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "profile.h"
+#include "homeRules.h"
+#include "units.h"
+
+// Steps many virtual patients together. Each state field lives in its own
+// contiguous array (structure of arrays) so the per-second and per-minute
+// rules from HomeRules run as SSE/AVX kernels over the whole cohort.
+// Patients follow the same cadence as SimulationEngine: glucose moves every
+// simulated second while a bolus is active, battery and IOB every minute.
+// Battery, reservoir and alerts match Home; glucose and IOB are the cheap
+// nudge and fixed decay, not Home's physiological model and action curves.
+class CohortSimulator {
+    public:
+        CohortSimulator();
+
+        void reserve(size_t patients);
+        size_t addPatient(const Profile& profile, float initialGlucose);
+        size_t size() const { return glucose.size(); }
+
+        // Per-patient controls
+        void setCharging(size_t patient, bool isCharging);
+        void setBolusActive(size_t patient, bool active);
+        void setIOB(size_t patient, float insulinOnBoard);
+        // A dose given now: adds to IOB and drains the reservoir, as Home does
+        void recordInsulinDose(size_t patient, InsulinUnits units);
+
+        // Advance every patient by simulated time
+        void runSeconds(long long seconds);
+        void runMinutes(long long minutes) { runSeconds(minutes * 60); }
+        void runDays(int days) { runSeconds(static_cast<long long>(days) * 24 * 60 * 60); }
+        long long getElapsedSeconds() const { return elapsedSeconds; }
+
+        // Per-patient state
+        float getGlucoseLevel(size_t patient) const { return glucose[patient]; }
+        float getBatteryLevel(size_t patient) const { return battery[patient]; }
+        float getIOB(size_t patient) const { return iob[patient]; }
+        int getInsulinDoseRemaining(size_t patient) const { return static_cast<int>(reservoir[patient].getWhole()); }
+
+        // Raw arrays for bulk analysis
+        const float* glucoseData() const { return glucose.data(); }
+        const float* batteryData() const { return battery.data(); }
+        const float* iobData() const { return iob.data(); }
+
+        // Cohort-wide alert counts (same thresholds as Home)
+        size_t countLowBattery() const;
+        size_t countCriticalBattery() const;
+        size_t countLowInsulin() const;
+
+    private:
+        // Apply `seconds` glucose steps, then one minute tick if requested
+        void stepBlock(int seconds, bool minuteTick);
+
+        long long elapsedSeconds;
+
+        // Dynamic state
+        std::vector<float> glucose;
+        std::vector<float> iob;
+        std::vector<float> battery;
+        std::vector<InsulinUnits> reservoir;
+        std::vector<uint32_t> chargingMask; // all bits set when charging
+        std::vector<uint32_t> activeMask;   // all bits set when a bolus is active
+
+        // Profile parameters
+        std::vector<float> targetGlucose;
+};
+
+#endif // COHORTSIMULATOR_H
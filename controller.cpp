@@ -0,0 +1,194 @@
+#include "controller.h"
+#include "insulinOnBoard.h"
+#include <algorithm>
+#include <cmath>
+
+// Glucose rate of change in mg/dL per minute, from the previous sample
+static float glucoseTrend(const ControllerInput& input, float lastGlucose, double lastMinutes, bool hasLast) {
+    if (!hasLast || input.minutes <= lastMinutes) {
+        return 0.0f;
+    }
+    float trend = static_cast<float>((input.glucose - lastGlucose) / (input.minutes - lastMinutes));
+    // A single noisy sample should not look like a crash or a spike
+    return std::max(-4.0f, std::min(4.0f, trend));
+}
+
+PidController::PidController(float kp, float ki, float kd)
+    : kp(kp), ki(ki), kd(kd) {
+    reset();
+}
+
+void PidController::reset() {
+    integral = 0.0f;
+    lastGlucose = 0.0f;
+    lastMinutes = 0.0;
+    hasLast = false;
+}
+
+ControllerCommand PidController::decide(const ControllerInput& input) {
+    float error = input.glucose - input.targetGlucose;
+    float trend = glucoseTrend(input, lastGlucose, lastMinutes, hasLast);
+    float dt = hasLast ? static_cast<float>(input.minutes - lastMinutes) : 0.0f;
+
+    float maxRate = input.basalRate * MAX_BASAL_MULTIPLE;
+    float unclamped = input.basalRate + kp * error + ki * integral + kd * trend;
+
+    // Conditional integration: only accumulate while it can still move the output
+    bool saturatedHigh = unclamped >= maxRate && error > 0.0f;
+    bool saturatedLow = unclamped <= 0.0f && error < 0.0f;
+    if (!saturatedHigh && !saturatedLow) {
+        integral = std::max(-MAX_INTEGRAL, std::min(MAX_INTEGRAL, integral + error * dt));
+    }
+
+    lastGlucose = input.glucose;
+    lastMinutes = input.minutes;
+    hasLast = true;
+
+    ControllerCommand command;
+    command.basalRate = std::max(0.0f, std::min(maxRate, input.basalRate + kp * error + ki * integral + kd * trend));
+    return command;
+}
+
+RuleBasedController::RuleBasedController() {
+    reset();
+}
+
+void RuleBasedController::reset() {
+    lastGlucose = 0.0f;
+    lastMinutes = 0.0;
+    lastCorrection = -CORRECTION_INTERVAL;
+    hasLast = false;
+}
+
+ControllerCommand RuleBasedController::decide(const ControllerInput& input) {
+    float trend = glucoseTrend(input, lastGlucose, lastMinutes, hasLast);
+    float predicted = input.glucose + trend * PREDICTION_MINUTES;
+    lastGlucose = input.glucose;
+    lastMinutes = input.minutes;
+    hasLast = true;
+
+    ControllerCommand command;
+    if (predicted < SUSPEND_PREDICTED || input.glucose < SUSPEND_PREDICTED) {
+        command.basalRate = 0.0f;
+        return command;
+    }
+
+    if (input.glucose > VERY_HIGH_GLUCOSE) {
+        command.basalRate = input.basalRate * 2.0f;
+    } else if (input.glucose > HIGH_GLUCOSE) {
+        command.basalRate = input.basalRate * 1.5f;
+    } else if (input.glucose < input.targetGlucose && trend < 0.0f) {
+        command.basalRate = input.basalRate * 0.5f;
+    }
+
+    // Automatic correction, net of insulin already on board
+    if (input.glucose > CORRECTION_GLUCOSE && input.correctionFactor > 0.0f
+            && input.minutes - lastCorrection >= CORRECTION_INTERVAL) {
+        float needed = (input.glucose - input.targetGlucose) / input.correctionFactor - input.insulinOnBoard;
+        if (needed > 0.0f) {
+            command.bolusUnits = needed * CORRECTION_FRACTION;
+            lastCorrection = input.minutes;
+        }
+    }
+    return command;
+}
+
+MpcController::MpcController(int horizonSteps, int controlMoves, float moveWeight, int iterations)
+    : horizon(std::max(1, horizonSteps)), moves(std::max(1, std::min(controlMoves, horizonSteps))),
+      moveWeight(moveWeight), iterations(std::max(1, iterations)), cachedCorrectionFactor(-1.0f) {
+    // Fraction of a dose that has acted k steps after delivery
+    effect.assign(horizon + 1, 0.0);
+    int knotsPerStep = static_cast<int>(STEP_MINUTES) / InsulinCurves::KNOT_MINUTES;
+    for (int k = 0; k <= horizon; ++k) {
+        int knot = std::min(k * knotsPerStep, InsulinCurves::SEGMENTS);
+        effect[k] = 1.0 - InsulinCurves::EXPONENTIAL_TABLE[knot];
+    }
+    reset();
+}
+
+void MpcController::reset() {
+    lastGlucose = 0.0f;
+    lastMinutes = 0.0;
+    hasLast = false;
+}
+
+// dynamics[k * moves + m]: glucose change at step k+1 per unit/hour of basal
+// deviation held during move m. Moves are blocked evenly over the horizon
+// and the last one is held to the end.
+void MpcController::buildResponse(float correctionFactor) {
+    cachedCorrectionFactor = correctionFactor;
+    dynamics.assign(static_cast<size_t>(horizon) * moves, 0.0);
+
+    int block = (horizon + moves - 1) / moves;
+    double unitsPerStep = STEP_MINUTES / 60.0;
+    for (int k = 1; k <= horizon; ++k) {
+        for (int j = 0; j < k; ++j) {
+            int m = std::min(j / block, moves - 1);
+            dynamics[static_cast<size_t>(k - 1) * moves + m] -= correctionFactor * unitsPerStep * effect[k - j];
+        }
+    }
+}
+
+ControllerCommand MpcController::decide(const ControllerInput& input) {
+    if (input.correctionFactor != cachedCorrectionFactor) {
+        buildResponse(input.correctionFactor);
+    }
+
+    float trend = glucoseTrend(input, lastGlucose, lastMinutes, hasLast);
+    lastGlucose = input.glucose;
+    lastMinutes = input.minutes;
+    hasLast = true;
+
+    // Free response: trend decaying away, minus the remaining action of
+    // insulin on board (treated as a fresh dose, which acts latest)
+    std::vector<double> freeResponse(horizon);
+    for (int k = 1; k <= horizon; ++k) {
+        double t = k * STEP_MINUTES;
+        double drift = trend * TREND_MINUTES * (1.0 - std::exp(-t / TREND_MINUTES));
+        freeResponse[k - 1] = input.glucose + drift - input.correctionFactor * input.insulinOnBoard * effect[k];
+    }
+
+    double lower = -input.basalRate;
+    double upper = input.basalRate * (MAX_BASAL_MULTIPLE - 1.0f);
+
+    // Lows cost more than highs of the same size
+    const double lowWeight = 4.0;
+
+    // Step size from a bound on the gradient's Lipschitz constant
+    double frobenius = 0.0;
+    for (double a : dynamics) {
+        frobenius += a * a;
+    }
+    double stepSize = 1.0 / (2.0 * (lowWeight * frobenius + moveWeight));
+
+    std::vector<double> u(moves, 0.0);
+    std::vector<double> residual(horizon);
+    std::vector<double> gradient(moves);
+    for (int it = 0; it < iterations; ++it) {
+        for (int k = 0; k < horizon; ++k) {
+            const double* row = &dynamics[static_cast<size_t>(k) * moves];
+            double g = freeResponse[k];
+            for (int m = 0; m < moves; ++m) {
+                g += row[m] * u[m];
+            }
+            double error = g - input.targetGlucose;
+            residual[k] = error < 0.0 ? lowWeight * error : error;
+        }
+        for (int m = 0; m < moves; ++m) {
+            gradient[m] = 2.0 * moveWeight * u[m];
+        }
+        for (int k = 0; k < horizon; ++k) {
+            const double* row = &dynamics[static_cast<size_t>(k) * moves];
+            for (int m = 0; m < moves; ++m) {
+                gradient[m] += 2.0 * row[m] * residual[k];
+            }
+        }
+        for (int m = 0; m < moves; ++m) {
+            u[m] = std::max(lower, std::min(upper, u[m] - stepSize * gradient[m]));
+        }
+    }
+
+    ControllerCommand command;
+    command.basalRate = static_cast<float>(input.basalRate + u[0]);
+    return command;
+}
@@ -0,0 +1,124 @@
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include <vector>
+
+// What a closed-loop controller sees at each CGM sample. Units follow
+// Profile: glucose in mg/dL, insulin in units, rates in units/hour.
+struct ControllerInput {
+    double minutes;          // simulated time since engine start
+    float glucose;
+    float insulinOnBoard;
+    float basalRate;         // profile basal
+    float correctionFactor;  // mg/dL per unit
+    float carbRatio;
+    float targetGlucose;
+};
+
+// What the controller asks the pump to do until the next sample
+struct ControllerCommand {
+    float basalRate = -1.0f; // temporary basal; negative = profile basal
+    float bolusUnits = 0.0f; // correction bolus to start now
+};
+
+// Automated insulin delivery algorithm. The pump calls decide() once per
+// CGM sample and applies the command; controllers keep whatever history
+// they need between calls and must not touch the pump themselves.
+class Controller {
+    public:
+        virtual ~Controller() {}
+
+        virtual const char* getName() const = 0;
+        // Forget history; called when the controller is attached to a pump
+        virtual void reset() {}
+        virtual ControllerCommand decide(const ControllerInput& input) = 0;
+
+        // Maximum temporary basal any controller may request, as a multiple of profile basal
+        static constexpr float MAX_BASAL_MULTIPLE = 4.0f;
+};
+
+// PID on glucose error around the profile target, output as a temporary
+// basal. The integral is clamped and frozen while the output saturates so
+// it cannot wind up during long highs or suspends.
+class PidController : public Controller {
+    public:
+        PidController(float kp = 0.02f, float ki = 0.0002f, float kd = 0.1f);
+
+        const char* getName() const override { return "PID"; }
+        void reset() override;
+        ControllerCommand decide(const ControllerInput& input) override;
+
+    private:
+        float kp; // units/hour per mg/dL
+        float ki; // units/hour per mg/dL*min
+        float kd; // units/hour per mg/dL/min
+        float integral;
+        float lastGlucose;
+        double lastMinutes;
+        bool hasLast;
+
+        const float MAX_INTEGRAL = 5000.0f; // mg/dL*min
+};
+
+// Threshold rules in the style of commercial hybrid closed loops: suspend
+// on a predicted low, scale basal up when high, and give an automatic
+// correction when high with little insulin on board.
+class RuleBasedController : public Controller {
+    public:
+        RuleBasedController();
+
+        const char* getName() const override { return "Rule-based"; }
+        void reset() override;
+        ControllerCommand decide(const ControllerInput& input) override;
+
+    private:
+        float lastGlucose;
+        double lastMinutes;
+        double lastCorrection;
+        bool hasLast;
+
+        const float SUSPEND_PREDICTED = 80.0f;  // predicted glucose in 30 minutes
+        const float HIGH_GLUCOSE = 160.0f;
+        const float VERY_HIGH_GLUCOSE = 180.0f;
+        const float CORRECTION_GLUCOSE = 180.0f;
+        const float CORRECTION_FRACTION = 0.6f; // of the computed correction
+        const double CORRECTION_INTERVAL = 60.0; // minutes between corrections
+        const float PREDICTION_MINUTES = 30.0f;
+};
+
+// Linear model predictive control. Glucose over the prediction horizon is
+// modelled as the free response (current trend plus the effect of insulin
+// already on board) plus the effect of basal deviations, each acting
+// through the insulin action curve. A box-constrained quadratic program
+// over the control moves is solved by projected gradient descent, and only
+// the first move is applied.
+class MpcController : public Controller {
+    public:
+        MpcController(int horizonSteps = 36, int controlMoves = 6, float moveWeight = 400.0f, int iterations = 200);
+
+        const char* getName() const override { return "MPC"; }
+        void reset() override;
+        ControllerCommand decide(const ControllerInput& input) override;
+
+    private:
+        // Glucose drop per unit delivered at step 0, at each later step
+        void buildResponse(float correctionFactor);
+
+        int horizon;
+        int moves;
+        float moveWeight;
+        int iterations;
+
+        std::vector<double> effect;   // cumulative action of one unit, per step
+        std::vector<double> dynamics; // horizon x moves step-response matrix
+        float cachedCorrectionFactor;
+
+        float lastGlucose;
+        double lastMinutes;
+        bool hasLast;
+
+        const double STEP_MINUTES = 5.0;
+        const double TREND_MINUTES = 30.0; // the current trend is assumed to fade over this
+};
+
+#endif // CONTROLLER_H
@@ -0,0 +1,171 @@
+#include "controllerBenchmark.h"
+#include "patientSimulation.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// Wraps the controller under test, timing each decision and keeping the
+// CGM trace it was given
+class TimedController : public Controller {
+    public:
+        explicit TimedController(Controller& inner) : inner(inner) {}
+
+        const char* getName() const override { return inner.getName(); }
+        void reset() override { inner.reset(); }
+
+        ControllerCommand decide(const ControllerInput& input) override {
+            auto start = std::chrono::steady_clock::now();
+            ControllerCommand command = inner.decide(input);
+            auto end = std::chrono::steady_clock::now();
+
+            nanoseconds.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+            glucose.push_back(input.glucose);
+            return command;
+        }
+
+        std::vector<double> nanoseconds;
+        std::vector<float> glucose;
+
+    private:
+        Controller& inner;
+};
+
+}
+
+std::vector<ControllerScenario> ControllerBenchmark::standardScenarios() {
+    std::vector<ControllerScenario> scenarios;
+
+    ControllerScenario fasting;
+    fasting.name = "Fasting from high";
+    fasting.initialGlucose = 220.0f;
+    scenarios.push_back(fasting);
+
+    ControllerScenario low;
+    low.name = "Starting low";
+    low.initialGlucose = 65.0f;
+    scenarios.push_back(low);
+
+    ControllerScenario meals;
+    meals.name = "Three meals";
+    meals.meals = {{7 * 60, 45.0f}, {12 * 60, 60.0f}, {18 * 60 + 30, 75.0f}};
+    scenarios.push_back(meals);
+
+    ControllerScenario large;
+    large.name = "Large dinner and snack";
+    large.meals = {{7 * 60, 40.0f}, {19 * 60, 120.0f}, {22 * 60 + 30, 30.0f}};
+    scenarios.push_back(large);
+
+    ControllerScenario resistant;
+    resistant.name = "Meals, insulin resistant";
+    resistant.basalRate = 1.6f;
+    resistant.correctionFactor = 30.0f;
+    resistant.carbRatio = 6.0f;
+    resistant.meals = meals.meals;
+    resistant.days = 2;
+    scenarios.push_back(resistant);
+
+    return scenarios;
+}
+
+ControllerMetrics ControllerBenchmark::runScenario(Controller& controller, const ControllerScenario& scenario) {
+    ControllerMetrics metrics;
+    metrics.controller = controller.getName();
+    metrics.scenario = scenario.name;
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    PatientSimulation sim;
+    std::string errorMsg;
+    if (!sim.setupProfile(scenario.name, scenario.basalRate, scenario.correctionFactor,
+                          scenario.carbRatio, scenario.targetGlucose, errorMsg)) {
+        return metrics;
+    }
+
+    TimedController timed(controller);
+    Pump& pump = sim.getPump();
+    pump.setCurrentGlucoseLevel(scenario.initialGlucose);
+    pump.startInsulinDelivery();
+    pump.setController(&timed);
+
+    // Run from meal to meal; the controller runs inside the engine on CGM samples
+    SimulationEngine& engine = sim.getEngine();
+    std::vector<ScenarioMeal> meals = scenario.meals;
+    std::sort(meals.begin(), meals.end(), [](const ScenarioMeal& a, const ScenarioMeal& b) {
+        return a.minuteOfDay < b.minuteOfDay;
+    });
+    for (int day = 0; day < scenario.days; ++day) {
+        long long dayStart = static_cast<long long>(day) * 24 * 60;
+        for (const ScenarioMeal& meal : meals) {
+            engine.advance((dayStart + meal.minuteOfDay) * 60 - engine.getElapsedSeconds());
+            pump.getGlucoseModel()->addCarbs(meal.carbs);
+        }
+    }
+    engine.advance(static_cast<long long>(scenario.days) * SimulationEngine::SECONDS_PER_DAY - engine.getElapsedSeconds());
+    pump.setController(nullptr);
+
+    auto wallEnd = std::chrono::steady_clock::now();
+    metrics.wallSeconds = std::chrono::duration<double>(wallEnd - wallStart).count();
+
+    // Clinical metrics over the CGM trace
+    const std::vector<float>& trace = timed.glucose;
+    metrics.samples = trace.size();
+    if (trace.empty()) {
+        return metrics;
+    }
+    size_t inRange = 0, below = 0, above = 0;
+    double sum = 0.0;
+    bool wasLow = false;
+    metrics.minGlucose = trace.front();
+    metrics.maxGlucose = trace.front();
+    for (float g : trace) {
+        sum += g;
+        metrics.minGlucose = std::min<double>(metrics.minGlucose, g);
+        metrics.maxGlucose = std::max<double>(metrics.maxGlucose, g);
+        bool isLow = g < LOW_GLUCOSE;
+        if (isLow) {
+            ++below;
+            if (!wasLow) ++metrics.hypoEvents;
+        } else if (g > HIGH_GLUCOSE) {
+            ++above;
+        } else {
+            ++inRange;
+        }
+        wasLow = isLow;
+    }
+    double n = static_cast<double>(trace.size());
+    metrics.meanGlucose = sum / n;
+    metrics.timeInRange = 100.0 * inRange / n;
+    metrics.timeBelowRange = 100.0 * below / n;
+    metrics.timeAboveRange = 100.0 * above / n;
+
+    // Compute cost per control step
+    std::vector<double> latency = timed.nanoseconds;
+    metrics.decisions = latency.size();
+    double total = 0.0;
+    for (double ns : latency) {
+        total += ns;
+    }
+    std::sort(latency.begin(), latency.end());
+    metrics.totalDecisionSeconds = total * 1e-9;
+    metrics.meanDecisionMicros = total / latency.size() * 1e-3;
+    metrics.p95DecisionMicros = latency[(latency.size() * 95) / 100] * 1e-3;
+    metrics.maxDecisionMicros = latency.back() * 1e-3;
+    metrics.valid = true;
+    return metrics;
+}
+
+std::vector<ControllerMetrics> ControllerBenchmark::run(const std::vector<ControllerFactory>& controllers,
+                                                        const std::vector<ControllerScenario>& scenarios) {
+    std::vector<ControllerMetrics> results;
+    for (const ControllerFactory& factory : controllers) {
+        for (const ControllerScenario& scenario : scenarios) {
+            // A fresh controller per scenario so no history leaks between runs
+            std::unique_ptr<Controller> controller = factory();
+            if (controller) {
+                results.push_back(runScenario(*controller, scenario));
+            }
+        }
+    }
+    return results;
+}
@@ -0,0 +1,69 @@
+#ifndef CONTROLLERBENCHMARK_H
+#define CONTROLLERBENCHMARK_H
+
+#include "controller.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ScenarioMeal {
+    int minuteOfDay;
+    float carbs; // unannounced; the controller only sees the glucose rise
+};
+
+// One standard test day (or several) for a virtual patient
+struct ControllerScenario {
+    std::string name;
+    int days = 1;
+    float initialGlucose = 120.0f;
+    float basalRate = 1.0f;
+    float correctionFactor = 50.0f;
+    float carbRatio = 10.0f;
+    float targetGlucose = 110.0f;
+    std::vector<ScenarioMeal> meals; // repeated every day
+};
+
+// Clinical outcome and compute cost of one controller on one scenario.
+// Glucose statistics are taken over the CGM samples the controller saw.
+struct ControllerMetrics {
+    std::string controller;
+    std::string scenario;
+    bool valid = false;
+
+    size_t samples = 0;
+    double meanGlucose = 0.0;
+    double minGlucose = 0.0;
+    double maxGlucose = 0.0;
+    double timeInRange = 0.0;    // percent of samples in 70-180 mg/dL
+    double timeBelowRange = 0.0; // percent below 70
+    double timeAboveRange = 0.0; // percent above 180
+    int hypoEvents = 0;          // separate excursions below 70
+
+    // Wall-clock cost of Controller::decide() alone, per control step
+    size_t decisions = 0;
+    double meanDecisionMicros = 0.0;
+    double p95DecisionMicros = 0.0;
+    double maxDecisionMicros = 0.0;
+    double totalDecisionSeconds = 0.0;
+    double wallSeconds = 0.0;    // whole scenario, simulation included
+};
+
+// Runs controllers across scenarios, one headless PatientSimulation per
+// run. Runs are sequential so decision latencies are not disturbed by
+// other simulations competing for the core.
+class ControllerBenchmark {
+    public:
+        typedef std::function<std::unique_ptr<Controller>()> ControllerFactory;
+
+        static std::vector<ControllerScenario> standardScenarios();
+
+        static ControllerMetrics runScenario(Controller& controller, const ControllerScenario& scenario);
+        static std::vector<ControllerMetrics> run(const std::vector<ControllerFactory>& controllers,
+                                                  const std::vector<ControllerScenario>& scenarios);
+
+        static const int LOW_GLUCOSE = 70;
+        static const int HIGH_GLUCOSE = 180;
+};
+
+#endif // CONTROLLERBENCHMARK_H
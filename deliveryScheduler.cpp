@@ -0,0 +1,265 @@
+#include "deliveryScheduler.h"
+#include "bolus.h"
+#include <algorithm>
+#include <cstdint>
+#include "snapshot.h"
+
+DeliveryScheduler::DeliveryScheduler() : nextId(1), history(nullptr) {}
+
+// Whole pulses in an amount, rounded down so a plan never exceeds its dose
+static int pulsesOf(InsulinUnits units) {
+    return units > InsulinUnits() ? static_cast<int>(units.getTicks() / DeliveryScheduler::PULSE.getTicks()) : 0;
+}
+
+InsulinUnits DeliveryScheduler::plannedUnits(InsulinUnits immediateUnits, InsulinUnits extendedUnits) {
+    return PULSE * (pulsesOf(immediateUnits) + pulsesOf(extendedUnits));
+}
+
+int DeliveryScheduler::add(const Bolus* source, InsulinUnits immediateUnits, InsulinUnits extendedUnits,
+                           int extendedSeconds, uint32_t entry) {
+    DeliveryPlan plan;
+    plan.source = source;
+    plan.state = ACTIVE;
+    plan.immediatePulses = pulsesOf(immediateUnits);
+    int extendedPulses = pulsesOf(extendedUnits);
+    plan.totalPulses = plan.immediatePulses + extendedPulses;
+    plan.deliveredPulses = 0;
+    plan.extendedInterval = (extendedPulses > 0) ? std::max<long long>(extendedSeconds / extendedPulses, 1) : 1;
+    plan.waiting = false;
+    plan.entry = entry;
+
+    if (plan.totalPulses == 0) {
+        finish(plan, BolusHistory::Completed);
+        return 0;
+    }
+
+    int id = nextId++;
+    mirrorSource(plan);
+    plans[id] = plan;
+    wakeups.push_back(id);
+    return id;
+}
+
+void DeliveryScheduler::finish(const DeliveryPlan& plan, BolusHistory::State state) {
+    if (history && plan.entry != BolusHistory::NO_ENTRY) {
+        history->finish(plan.entry, state);
+    }
+}
+
+void DeliveryScheduler::mirrorSource(DeliveryPlan& plan) const {
+    if (!plan.source) {
+        return;
+    }
+    if (plan.source->isCanceled()) {
+        plan.state = CANCELED;
+    } else if (plan.source->isPaused()) {
+        plan.state = PAUSED;
+    } else {
+        plan.state = ACTIVE;
+    }
+}
+
+long long DeliveryScheduler::deliverPulse(int id, long long now, bool deliveryEnabled, InsulinUnits& units) {
+    units = InsulinUnits();
+    auto it = plans.find(id);
+    if (it == plans.end()) {
+        return -1;
+    }
+
+    DeliveryPlan& plan = it->second;
+    mirrorSource(plan);
+    if (plan.state == CANCELED) {
+        finish(plan, BolusHistory::Canceled);
+        plans.erase(it);
+        return -1;
+    }
+    if (plan.state == PAUSED || !deliveryEnabled) {
+        plan.waiting = true;
+        return -1;
+    }
+
+    units = PULSE;
+    ++plan.deliveredPulses;
+    if (history && plan.entry != BolusHistory::NO_ENTRY) {
+        history->recordPulse(plan.entry, units, now);
+    }
+    if (plan.deliveredPulses >= plan.totalPulses) {
+        finish(plan, BolusHistory::Completed);
+        plans.erase(it);
+        return -1;
+    }
+
+    long long interval = (plan.deliveredPulses < plan.immediatePulses)
+                             ? IMMEDIATE_PULSE_INTERVAL_SECONDS
+                             : plan.extendedInterval;
+    return now + interval;
+}
+
+void DeliveryScheduler::sync(bool deliveryEnabled) {
+    for (auto it = plans.begin(); it != plans.end();) {
+        DeliveryPlan& plan = it->second;
+        mirrorSource(plan);
+        if (plan.state == CANCELED) {
+            finish(plan, BolusHistory::Canceled);
+            it = plans.erase(it);
+            continue;
+        }
+        if (plan.waiting && plan.state == ACTIVE && deliveryEnabled) {
+            plan.waiting = false;
+            wakeups.push_back(it->first);
+        }
+        ++it;
+    }
+}
+
+std::vector<int> DeliveryScheduler::takeWakeups() {
+    std::vector<int> due;
+    due.swap(wakeups);
+    return due;
+}
+
+void DeliveryScheduler::detach(const Bolus* source) {
+    if (!source) {
+        return;
+    }
+    for (auto it = plans.begin(); it != plans.end();) {
+        DeliveryPlan& plan = it->second;
+        if (plan.source != source) {
+            ++it;
+            continue;
+        }
+        // A paused plan can still be resumed through its history entry
+        mirrorSource(plan);
+        plan.source = nullptr;
+        if (plan.state == CANCELED) {
+            finish(plan, BolusHistory::Canceled);
+            it = plans.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool DeliveryScheduler::hasPlans(const Bolus* source) const {
+    for (const auto& entry : plans) {
+        if (entry.second.source == source) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const Bolus* DeliveryScheduler::sourceOf(uint32_t entry) const {
+    for (const auto& plan : plans) {
+        if (plan.second.entry == entry) {
+            return plan.second.source;
+        }
+    }
+    return nullptr;
+}
+
+bool DeliveryScheduler::isInFlight(uint32_t entry) const {
+    for (const auto& plan : plans) {
+        if (plan.second.entry == entry) {
+            return true;
+        }
+    }
+    return false;
+}
+
+DeliveryScheduler::DeliveryPlan* DeliveryScheduler::detachedPlan(uint32_t entry) {
+    for (auto& plan : plans) {
+        if (plan.second.entry == entry) {
+            return plan.second.source ? nullptr : &plan.second;
+        }
+    }
+    return nullptr;
+}
+
+bool DeliveryScheduler::pauseEntry(uint32_t entry) {
+    DeliveryPlan* plan = detachedPlan(entry);
+    if (!plan || plan->state != ACTIVE) {
+        return false;
+    }
+    plan->state = PAUSED;
+    return true;
+}
+
+bool DeliveryScheduler::resumeEntry(uint32_t entry) {
+    DeliveryPlan* plan = detachedPlan(entry);
+    if (!plan || plan->state != PAUSED) {
+        return false;
+    }
+    plan->state = ACTIVE;
+    return true;
+}
+
+bool DeliveryScheduler::cancelEntry(uint32_t entry) {
+    DeliveryPlan* plan = detachedPlan(entry);
+    if (!plan || plan->state == CANCELED) {
+        return false;
+    }
+    plan->state = CANCELED;
+    return true;
+}
+
+void DeliveryScheduler::cancelAll() {
+    for (const auto& entry : plans) {
+        finish(entry.second, BolusHistory::Canceled);
+    }
+    plans.clear();
+    wakeups.clear();
+}
+
+InsulinUnits DeliveryScheduler::getRemainingUnits() const {
+    int64_t pulses = 0;
+    for (const auto& entry : plans) {
+        pulses += entry.second.totalPulses - entry.second.deliveredPulses;
+    }
+    return PULSE * pulses;
+}
+
+void DeliveryScheduler::saveState(SnapshotWriter& out, const std::vector<Bolus*>& sources) const {
+    out.write(nextId);
+    out.writeVector(wakeups);
+    out.write(static_cast<uint64_t>(plans.size()));
+    for (const auto& entry : plans) {
+        const DeliveryPlan& plan = entry.second;
+        auto source = std::find(sources.begin(), sources.end(), plan.source);
+        out.write(entry.first);
+        out.write(static_cast<int32_t>(plan.source && source != sources.end() ? source - sources.begin() : -1));
+        out.write(plan.state);
+        out.write(plan.immediatePulses);
+        out.write(plan.totalPulses);
+        out.write(plan.deliveredPulses);
+        out.write(plan.extendedInterval);
+        out.write(plan.waiting);
+        out.write(plan.entry);
+    }
+}
+
+bool DeliveryScheduler::restoreState(SnapshotReader& in, const std::vector<Bolus*>& sources) {
+    plans.clear();
+    in.read(nextId);
+    in.readVector(wakeups);
+
+    uint64_t count = 0;
+    in.read(count);
+    for (uint64_t i = 0; i < count && in.isValid(); ++i) {
+        int id = 0;
+        int32_t source = -1;
+        DeliveryPlan plan;
+        in.read(id);
+        in.read(source);
+        in.read(plan.state);
+        in.read(plan.immediatePulses);
+        in.read(plan.totalPulses);
+        in.read(plan.deliveredPulses);
+        in.read(plan.extendedInterval);
+        in.read(plan.waiting);
+        in.read(plan.entry);
+        plan.source = (source >= 0 && static_cast<size_t>(source) < sources.size()) ? sources[source] : nullptr;
+        plans[id] = plan;
+    }
+    return in.isValid();
+}
@@ -0,0 +1,101 @@
+#ifndef DELIVERYSCHEDULER_H
+#define DELIVERYSCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "bolusHistory.h"
+#include "bolusRules.h"
+#include "units.h"
+
+class Bolus;
+class SnapshotWriter;
+class SnapshotReader;
+
+// Splits boluses into pump-resolution pulses and hands them out one at a
+// time. The scheduler does not tick: SimulationEngine schedules an event
+// for each plan's next pulse, so nothing runs between pulses. Several plans
+// can be in flight at once; each one mirrors the pause/resume/cancel state
+// of the Bolus it came from, or once detached from it is controlled by its
+// BolusHistory entry, and reports its progress to that entry.
+class DeliveryScheduler {
+    public:
+        DeliveryScheduler();
+
+        // Where plan progress is recorded; not owned
+        void setHistory(BolusHistory* h) { history = h; }
+
+        // Queue a delivery; immediate units go first, then the extended part
+        // is spread evenly over extendedSeconds. Each part is rounded down
+        // to whole pulses. Returns the plan id, or 0 if there is nothing to
+        // deliver (the entry is then already finished).
+        int add(const Bolus* source, InsulinUnits immediateUnits, InsulinUnits extendedUnits, int extendedSeconds,
+                uint32_t entry = BolusHistory::NO_ENTRY);
+        // Units a dose comes to once rounded to whole pulses
+        static InsulinUnits plannedUnits(InsulinUnits immediateUnits, InsulinUnits extendedUnits);
+
+        // Deliver the plan's next pulse at `now`. Sets `units` to what was
+        // delivered and returns the time of the following pulse, or -1 when
+        // the plan has finished, was canceled, or is waiting to be resumed.
+        long long deliverPulse(int id, long long now, bool deliveryEnabled, InsulinUnits& units);
+
+        // Re-read bolus states; plans that can continue are queued as wakeups
+        void sync(bool deliveryEnabled);
+        // Plans that need a pulse scheduled at the current time
+        std::vector<int> takeWakeups();
+
+        // The bolus is going away; its plans keep running on their own state
+        void detach(const Bolus* source);
+        bool hasPlans(const Bolus* source) const;
+        // The Bolus the plan for history entry `entry` mirrors; null when it
+        // is detached or no such plan is in flight
+        const Bolus* sourceOf(uint32_t entry) const;
+        bool isInFlight(uint32_t entry) const;
+        // Control a detached plan by its history entry. Returns false if
+        // there is no such plan, it still mirrors a Bolus, or it is already
+        // in that state; sync() picks up the change.
+        bool pauseEntry(uint32_t entry);
+        bool resumeEntry(uint32_t entry);
+        bool cancelEntry(uint32_t entry);
+        void cancelAll();
+
+        // Snapshot support; plan sources are saved as positions in `sources`
+        void saveState(SnapshotWriter& out, const std::vector<Bolus*>& sources) const;
+        bool restoreState(SnapshotReader& in, const std::vector<Bolus*>& sources);
+
+        size_t getActiveCount() const { return plans.size(); }
+        InsulinUnits getRemainingUnits() const;
+
+        static constexpr InsulinUnits PULSE = BolusRules::PULSE; // pump resolution
+        static const int IMMEDIATE_PULSE_INTERVAL_SECONDS = 2; // about 1.5 U/min
+
+    private:
+        enum PlanState {
+            ACTIVE,
+            PAUSED,
+            CANCELED
+        };
+
+        struct DeliveryPlan {
+            const Bolus* source;
+            PlanState state;
+            int immediatePulses;
+            int totalPulses;
+            int deliveredPulses;
+            long long extendedInterval;
+            bool waiting; // a pulse came due while paused or suspended
+            uint32_t entry;
+        };
+
+        void mirrorSource(DeliveryPlan& plan) const;
+        DeliveryPlan* detachedPlan(uint32_t entry);
+        void finish(const DeliveryPlan& plan, BolusHistory::State state);
+
+        std::unordered_map<int, DeliveryPlan> plans;
+        std::vector<int> wakeups;
+        int nextId;
+        BolusHistory* history;
+};
+
+#endif // DELIVERYSCHEDULER_H
@@ -0,0 +1,159 @@
+#include "eventLog.h"
+#include <QFile>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+static const char EVENT_MAGIC[4] = {'I', 'P', 'E', 'V'};
+
+EventLogWriter::EventLogWriter() : file(nullptr), sequence(0) {}
+
+EventLogWriter::~EventLogWriter() {
+    close();
+}
+
+bool EventLogWriter::open(const std::string& path) {
+    close();
+
+    std::error_code error;
+    uintmax_t bytes = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+    if (error) {
+        return false;
+    }
+
+    if (bytes > 0) {
+        // Continue an existing file if it is ours
+        EventFileHeader header;
+        FILE* existing = fopen(path.c_str(), "rb");
+        bool valid = existing && fread(&header, sizeof(header), 1, existing) == 1
+                && std::memcmp(header.magic, EVENT_MAGIC, sizeof(EVENT_MAGIC)) == 0
+                && header.version == FORMAT_VERSION && header.recordSize == sizeof(EventRecord);
+        if (existing) {
+            fclose(existing);
+        }
+        if (!valid) {
+            return false;
+        }
+
+        // Cut off a record torn by a crash so appends stay aligned
+        uintmax_t records = (bytes - sizeof(EventFileHeader)) / sizeof(EventRecord);
+        uintmax_t whole = sizeof(EventFileHeader) + records * sizeof(EventRecord);
+        if (whole != bytes) {
+            std::filesystem::resize_file(path, whole, error);
+            if (error) {
+                return false;
+            }
+        }
+        sequence = static_cast<uint32_t>(records);
+        file = fopen(path.c_str(), "ab");
+    } else {
+        file = fopen(path.c_str(), "wb");
+        if (file) {
+            EventFileHeader header;
+            std::memcpy(header.magic, EVENT_MAGIC, sizeof(EVENT_MAGIC));
+            header.version = FORMAT_VERSION;
+            header.recordSize = sizeof(EventRecord);
+            header.reserved = 0;
+            fwrite(&header, sizeof(header), 1, file);
+        }
+        sequence = 0;
+    }
+
+    buffer.reserve(BUFFER_RECORDS);
+    return file != nullptr;
+}
+
+void EventLogWriter::close() {
+    if (!file) {
+        return;
+    }
+    flush();
+    fclose(file);
+    file = nullptr;
+}
+
+void EventLogWriter::append(int64_t timestamp, LogCategory category, LogEventCode code, double value) {
+    if (!file) {
+        return;
+    }
+    EventRecord record;
+    record.timestamp = timestamp;
+    record.code = static_cast<uint16_t>(code);
+    record.category = static_cast<uint8_t>(category);
+    record.reserved = 0;
+    record.sequence = sequence++;
+    record.value = value;
+    buffer.push_back(record);
+
+    if (buffer.size() >= BUFFER_RECORDS) {
+        flush();
+    }
+}
+
+bool EventLogWriter::flush() {
+    if (!file) {
+        return false;
+    }
+    bool ok = true;
+    if (!buffer.empty()) {
+        ok = fwrite(buffer.data(), sizeof(EventRecord), buffer.size(), file) == buffer.size();
+        buffer.clear();
+    }
+    return fflush(file) == 0 && ok;
+}
+
+EventLogReader::EventLogReader() : file(nullptr), mapping(nullptr), records(nullptr), count(0) {}
+
+EventLogReader::~EventLogReader() {
+    close();
+}
+
+bool EventLogReader::open(const std::string& path) {
+    close();
+
+    file = new QFile(QString::fromStdString(path));
+    if (!file->open(QIODevice::ReadOnly) || file->size() < static_cast<qint64>(sizeof(EventFileHeader))) {
+        close();
+        return false;
+    }
+
+    qint64 bytes = file->size();
+    mapping = file->map(0, bytes);
+    if (!mapping) {
+        close();
+        return false;
+    }
+
+    EventFileHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, EVENT_MAGIC, sizeof(EVENT_MAGIC)) != 0
+            || header.version != EventLogWriter::FORMAT_VERSION || header.recordSize != sizeof(EventRecord)) {
+        close();
+        return false;
+    }
+
+    // The header keeps records 8-byte aligned in the page-aligned mapping; a
+    // torn trailing record is ignored
+    records = reinterpret_cast<const EventRecord*>(mapping + sizeof(EventFileHeader));
+    count = static_cast<size_t>(bytes - sizeof(EventFileHeader)) / sizeof(EventRecord);
+    return true;
+}
+
+void EventLogReader::close() {
+    if (file) {
+        if (mapping) {
+            file->unmap(const_cast<unsigned char*>(mapping));
+        }
+        delete file;
+    }
+    file = nullptr;
+    mapping = nullptr;
+    records = nullptr;
+    count = 0;
+}
+
+const EventRecord* EventLogReader::lowerBound(int64_t timestamp) const {
+    return std::lower_bound(begin(), end(), timestamp, [](const EventRecord& r, int64_t t) {
+        return r.timestamp < t;
+    });
+}
@@ -0,0 +1,147 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class QFile;
+
+// What subsystem an event came from; mirrors the [Tag] prefixes of the text log
+enum class LogCategory : uint8_t {
+    System,
+    Pump,
+    Bolus,
+    Alert,
+    Profile,
+    Controller
+};
+
+// Every event the pump records. Values are stored in files, so only append.
+enum class LogEventCode : uint16_t {
+    PowerOn,
+    PowerOff,
+    ChargingStarted,
+    ChargingStopped,
+    EmergencyShutdown,
+    DeliveryStarted,
+    DeliveryStopped,
+    DeliveryResumed,
+    BolusRejected,
+    BolusCalculated,          // value = units
+    BolusConfirmed,           // value = units
+    ExtendedBolusStarted,     // value = minutes
+    QuickBolusDelivered,      // value = units
+    BolusPaused,
+    BolusResumed,
+    BolusCanceled,
+    ProfileCreated,
+    ProfileSwitched,
+    ProfileSwitchFailed,
+    CgmAlert,
+    OcclusionAlert,
+    LowBattery,               // value = percent
+    CriticalBattery,          // value = percent
+    LowInsulin,               // value = units remaining
+    ControllerEnabled,
+    ControllerDisabled,
+    ControllerCorrection      // value = units
+};
+
+// One fixed-size event as stored on disk
+struct EventRecord {
+    int64_t timestamp;   // milliseconds since the Unix epoch
+    uint16_t code;       // LogEventCode
+    uint8_t category;    // LogCategory
+    uint8_t reserved;
+    uint32_t sequence;   // order within the file
+    double value;        // numeric payload; meaning depends on the code
+};
+static_assert(sizeof(EventRecord) == 24, "EventRecord is an on-disk format");
+
+// Layout of an event file: one header, then packed records, appended only.
+// Integers are little-endian (the native order of every supported target).
+struct EventFileHeader {
+    char magic[4];       // "IPEV"
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+};
+static_assert(sizeof(EventFileHeader) == 16, "EventFileHeader is an on-disk format");
+
+// Appends records to an event file through a user-space buffer. Opening an
+// existing file continues it; a torn record left by a crash is cut off.
+class EventLogWriter {
+    public:
+        EventLogWriter();
+        ~EventLogWriter();
+
+        EventLogWriter(const EventLogWriter&) = delete;
+        EventLogWriter& operator=(const EventLogWriter&) = delete;
+
+        bool open(const std::string& path);
+        void close();
+        bool isOpen() const { return file != nullptr; }
+
+        void append(int64_t timestamp, LogCategory category, LogEventCode code, double value);
+        bool flush();
+
+        uint32_t getRecordCount() const { return sequence; }
+
+        static const uint32_t FORMAT_VERSION = 1;
+
+    private:
+        FILE* file;
+        std::vector<EventRecord> buffer;
+        uint32_t sequence;
+
+        const size_t BUFFER_RECORDS = 4096; // about 96 KB per write
+};
+
+// Memory-maps an event file and exposes the records in place, so a scan
+// over hundreds of millions of events is a linear walk over the page cache
+// with no parsing or copying.
+class EventLogReader {
+    public:
+        EventLogReader();
+        ~EventLogReader();
+
+        EventLogReader(const EventLogReader&) = delete;
+        EventLogReader& operator=(const EventLogReader&) = delete;
+
+        bool open(const std::string& path);
+        void close();
+
+        size_t size() const { return count; }
+        const EventRecord& operator[](size_t i) const { return records[i]; }
+        const EventRecord* begin() const { return records; }
+        const EventRecord* end() const { return records + count; }
+
+        // First record at or after `timestamp`, for files written by one run
+        // (timestamps never decrease within a run)
+        const EventRecord* lowerBound(int64_t timestamp) const;
+
+        // Visit every record matching the category (and code, unless negative)
+        template <class Visitor>
+        size_t scan(LogCategory category, int code, Visitor visit) const {
+            size_t matched = 0;
+            const uint8_t c = static_cast<uint8_t>(category);
+            for (const EventRecord* r = begin(); r != end(); ++r) {
+                if (r->category == c && (code < 0 || r->code == code)) {
+                    visit(*r);
+                    ++matched;
+                }
+            }
+            return matched;
+        }
+
+    private:
+        QFile* file;
+        const unsigned char* mapping;
+        const EventRecord* records;
+        size_t count;
+};
+
+#endif // EVENTLOG_H
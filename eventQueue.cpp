@@ -0,0 +1,77 @@
+#include "eventQueue.h"
+#include "snapshot.h"
+
+EventQueue::EventQueue() : nextId(1) {}
+
+EventQueue::EventId EventQueue::schedule(long long time, SimEventType type, int payload) {
+    SimEvent event;
+    event.time = time;
+    event.id = nextId++;
+    event.type = type;
+    event.payload = payload;
+    heap.push(event);
+    live.insert(event.id);
+    return event.id;
+}
+
+void EventQueue::cancel(EventId id) {
+    if (live.erase(id) > 0) {
+        cancelled.insert(id);
+    }
+}
+
+bool EventQueue::popNext(long long until, SimEvent& event) {
+    while (!heap.empty()) {
+        const SimEvent& top = heap.top();
+        auto it = cancelled.find(top.id);
+        if (it != cancelled.end()) {
+            cancelled.erase(it);
+            heap.pop();
+            continue;
+        }
+        if (top.time > until) {
+            return false;
+        }
+        event = top;
+        heap.pop();
+        live.erase(event.id);
+        return true;
+    }
+    return false;
+}
+
+void EventQueue::clear() {
+    heap = std::priority_queue<SimEvent, std::vector<SimEvent>, Later>();
+    live.clear();
+    cancelled.clear();
+}
+
+void EventQueue::saveState(SnapshotWriter& out) const {
+    // Copy the heap and keep only live events
+    std::priority_queue<SimEvent, std::vector<SimEvent>, Later> copy = heap;
+    std::vector<SimEvent> pending;
+    pending.reserve(live.size());
+    while (!copy.empty()) {
+        if (live.count(copy.top().id)) {
+            pending.push_back(copy.top());
+        }
+        copy.pop();
+    }
+    out.write(nextId);
+    out.writeVector(pending);
+}
+
+bool EventQueue::restoreState(SnapshotReader& in) {
+    std::vector<SimEvent> pending;
+    in.read(nextId);
+    in.readVector(pending);
+    if (!in.isValid()) {
+        return false;
+    }
+    clear();
+    for (const SimEvent& event : pending) {
+        heap.push(event);
+        live.insert(event.id);
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#include <cstddef>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+class SnapshotWriter;
+class SnapshotReader;
+
+// Kinds of scheduled simulation events. Events are plain data (no
+// callbacks) so a queue can be inspected, copied and saved.
+enum class SimEventType {
+    BatteryThreshold, // battery crosses the low or critical level
+    AlertReminder,    // re-raise standing alerts while a condition persists
+    BolusPulse,       // next pulse of a delivery plan (payload = plan id)
+    CgmSample,        // sensor reading handed to the closed-loop controller
+    BasalPulse        // the next basal pulse comes due at the current rate
+};
+
+struct SimEvent {
+    long long time;             // simulated seconds since engine start
+    unsigned long long id;      // also breaks ties in scheduling order
+    SimEventType type;
+    int payload;
+};
+
+// Min-heap of pending events ordered by (time, id). Cancelled events are
+// dropped lazily when they reach the front.
+class EventQueue {
+    public:
+        typedef unsigned long long EventId;
+
+        EventQueue();
+
+        EventId schedule(long long time, SimEventType type, int payload = 0);
+        void cancel(EventId id);
+
+        // Pop the earliest live event at or before `until`
+        bool popNext(long long until, SimEvent& event);
+
+        bool isEmpty() const { return live.empty(); }
+        size_t size() const { return live.size(); }
+        void clear();
+
+        // Snapshot support; event ids are preserved
+        void saveState(SnapshotWriter& out) const;
+        bool restoreState(SnapshotReader& in);
+
+    private:
+        struct Later {
+            bool operator()(const SimEvent& a, const SimEvent& b) const {
+                return (a.time != b.time) ? a.time > b.time : a.id > b.id;
+            }
+        };
+
+        std::priority_queue<SimEvent, std::vector<SimEvent>, Later> heap;
+        std::unordered_set<EventId> live;      // scheduled, not yet popped or cancelled
+        std::unordered_set<EventId> cancelled; // still in the heap, to be skipped
+        EventId nextId;
+};
+
+#endif // EVENTQUEUE_H
@@ -0,0 +1,145 @@
+#include "glucoseModel.h"
+#include <algorithm>
+#include "homeRules.h"
+#include "snapshot.h"
+
+BergmanMinimalModel::BergmanMinimalModel()
+    : basalGlucose(120.0), basalInsulin(0.0), restingRate(0.0) {
+    // Tolerances are per compartment since their scales differ widely
+    integrator.setRelativeTolerance(1e-4);
+    integrator.setAbsoluteTolerance(G, 0.01);
+    integrator.setAbsoluteTolerance(X, 1e-7);
+    integrator.setAbsoluteTolerance(I, 1e-3);
+    integrator.setAbsoluteTolerance(S1, 1e-4);
+    integrator.setAbsoluteTolerance(S2, 1e-4);
+    integrator.setAbsoluteTolerance(Q1, 1e-3);
+    integrator.setAbsoluteTolerance(Q2, 1e-3);
+    reset(static_cast<float>(basalGlucose));
+}
+
+// Plasma insulin that a constant delivery rate settles at
+double BergmanMinimalModel::steadyInsulin(double unitsPerHour) const {
+    return (unitsPerHour / 60.0) * 1000.0 / (V_I * N_CLEAR);
+}
+
+void BergmanMinimalModel::reset(float glucose) {
+    double u = restingRate;
+    state[G] = glucose;
+    state[X] = 0.0;
+    state[I] = basalInsulin;
+    state[S1] = u * T_MAX_I;
+    state[S2] = u * T_MAX_I;
+    state[Q1] = 0.0;
+    state[Q2] = 0.0;
+}
+
+void BergmanMinimalModel::setGlucose(float glucose) {
+    state[G] = glucose;
+}
+
+// The depots and plasma insulin move by the change in their steady levels,
+// so a patient at rest stays at rest under the new basal rate (no start-up
+// dip while the depots fill) and bolus insulin already absorbing is kept
+void BergmanMinimalModel::setEquilibrium(float glucose, float unitsPerHour) {
+    double rate = (unitsPerHour > 0.0f) ? unitsPerHour / 60.0 : 0.0;
+    double insulin = steadyInsulin(unitsPerHour);
+    state[S1] = std::max(0.0, state[S1] + (rate - restingRate) * T_MAX_I);
+    state[S2] = std::max(0.0, state[S2] + (rate - restingRate) * T_MAX_I);
+    state[I] = std::max(0.0, state[I] + insulin - basalInsulin);
+
+    basalGlucose = glucose;
+    basalInsulin = insulin;
+    restingRate = rate;
+}
+
+void BergmanMinimalModel::addInsulin(float units) {
+    if (units > 0.0f) state[S1] += units;
+}
+
+void BergmanMinimalModel::addCarbs(float grams) {
+    if (grams > 0.0f) state[Q1] += grams;
+}
+
+void BergmanMinimalModel::derivatives(const State& y, State& dy) const {
+    double insulinAppearance = y[S2] / T_MAX_I * 1000.0 / V_I; // mU/L/min
+    double carbAppearance = CARB_BIOAVAILABILITY * y[Q2] / T_MAX_G * 1000.0 / V_G; // mg/dL/min
+
+    dy[G] = -(P1 + y[X]) * y[G] + P1 * basalGlucose + carbAppearance;
+    dy[X] = -P2 * y[X] + P3 * (y[I] - basalInsulin);
+    dy[I] = -N_CLEAR * y[I] + insulinAppearance;
+    dy[S1] = -y[S1] / T_MAX_I;
+    dy[S2] = (y[S1] - y[S2]) / T_MAX_I;
+    dy[Q1] = -y[Q1] / T_MAX_G;
+    dy[Q2] = (y[Q1] - y[Q2]) / T_MAX_G;
+}
+
+void BergmanMinimalModel::advance(double minutes) {
+    integrator.integrate(state, minutes, [this](const State& y, State& dy) {
+        derivatives(y, dy);
+    });
+    if (state[G] < 0.0) {
+        state[G] = 0.0;
+    }
+}
+
+float BergmanMinimalModel::getGlucose() const {
+    return static_cast<float>(state[G]);
+}
+
+void BergmanMinimalModel::saveState(SnapshotWriter& out) const {
+    out.write(SNAPSHOT_TAG);
+    out.write(state);
+    out.write(basalGlucose);
+    out.write(basalInsulin);
+    out.write(restingRate);
+    out.write(integrator.getLastStep());
+    out.write(integrator.getStats());
+}
+
+bool BergmanMinimalModel::restoreState(SnapshotReader& in) {
+    char tag = 0;
+    if (!in.read(tag) || tag != SNAPSHOT_TAG) {
+        return false;
+    }
+    double lastStep = 0.0;
+    OdeIntegrator<STATE_SIZE>::Stats stats;
+    in.read(state);
+    in.read(basalGlucose);
+    in.read(basalInsulin);
+    in.read(restingRate);
+    in.read(lastStep);
+    in.read(stats);
+    if (!in.isValid()) {
+        return false;
+    }
+    integrator.restore(lastStep, stats);
+    return true;
+}
+
+TargetNudgeModel::TargetNudgeModel() : glucose(120.0f), target(120.0f), pendingSeconds(0.0) {}
+
+void TargetNudgeModel::advance(double minutes) {
+    pendingSeconds += minutes * 60.0;
+    while (pendingSeconds >= 1.0) {
+        glucose = HomeRules::glucoseStep(glucose, target);
+        pendingSeconds -= 1.0;
+    }
+}
+
+void TargetNudgeModel::saveState(SnapshotWriter& out) const {
+    out.write(SNAPSHOT_TAG);
+    out.write(glucose);
+    out.write(target);
+    out.write(pendingSeconds);
+}
+
+bool TargetNudgeModel::restoreState(SnapshotReader& in) {
+    char tag = 0;
+    if (!in.read(tag) || tag != SNAPSHOT_TAG) {
+        return false;
+    }
+    in.read(glucose);
+    in.read(target);
+    in.read(pendingSeconds);
+    return in.isValid();
+}
@@ -0,0 +1,121 @@
+#ifndef GLUCOSEMODEL_H
+#define GLUCOSEMODEL_H
+
+#include "odeIntegrator.h"
+
+class SnapshotWriter;
+class SnapshotReader;
+
+// Patient physiology driven by the pump. Insulin and carbs arrive as
+// discrete doses; the pump delivers basal insulin as pulses too. Units
+// follow Profile: glucose in mg/dL, insulin in units, time in minutes.
+class GlucoseModel {
+    public:
+        virtual ~GlucoseModel() {}
+
+        // Start from a given glucose with every compartment at rest
+        virtual void reset(float glucose) = 0;
+        // Overwrite the current glucose (e.g. a fingerstick entry)
+        virtual void setGlucose(float glucose) = 0;
+        // Glucose and basal rate the patient rests at when nothing else happens;
+        // the insulin already delivered is brought in line with the new rate
+        virtual void setEquilibrium(float glucose, float basalRate) = 0;
+
+        virtual void addInsulin(float units) = 0;
+        virtual void addCarbs(float grams) = 0;
+
+        virtual void advance(double minutes) = 0;
+        virtual float getGlucose() const = 0;
+
+        // Integrator work done so far, for profiling long runs
+        virtual long long getStepCount() const { return 0; }
+
+        // Snapshot support; restore fails if the snapshot is of another model
+        virtual void saveState(SnapshotWriter& out) const = 0;
+        virtual bool restoreState(SnapshotReader& in) = 0;
+};
+
+// Bergman minimal model with two-compartment subcutaneous insulin and gut
+// absorption, integrated with an adaptive step that stretches to hours
+// when the patient is quiescent.
+class BergmanMinimalModel : public GlucoseModel {
+    public:
+        BergmanMinimalModel();
+
+        void reset(float glucose) override;
+        void setGlucose(float glucose) override;
+        void setEquilibrium(float glucose, float basalRate) override;
+
+        void addInsulin(float units) override;
+        void addCarbs(float grams) override;
+
+        void advance(double minutes) override;
+        float getGlucose() const override;
+
+        long long getStepCount() const override { return integrator.getStepCount(); }
+
+        void saveState(SnapshotWriter& out) const override;
+        bool restoreState(SnapshotReader& in) override;
+
+    private:
+        // State layout
+        enum { G, X, I, S1, S2, Q1, Q2, STATE_SIZE };
+        typedef OdeIntegrator<STATE_SIZE>::State State;
+
+        void derivatives(const State& y, State& dy) const;
+        double steadyInsulin(double unitsPerHour) const;
+
+        class CountingIntegrator : public OdeIntegrator<STATE_SIZE> {
+            public:
+                long long getStepCount() const { return getStats().acceptedSteps; }
+        };
+
+        static constexpr char SNAPSHOT_TAG = 'B';
+
+        State state;
+        CountingIntegrator integrator;
+
+        double basalGlucose;    // Gb, mg/dL
+        double basalInsulin;    // Ib, mU/L at the equilibrium basal rate
+        double restingRate;     // equilibrium basal rate, U/min; seeds the depots on reset
+
+        // Model parameters (typical adult values)
+        const double P1 = 0.028;      // glucose effectiveness, 1/min
+        const double P2 = 0.025;      // remote insulin decay, 1/min
+        const double P3 = 1.0e-5;     // insulin sensitivity, L/(mU*min^2)
+        const double N_CLEAR = 0.09;  // plasma insulin clearance, 1/min
+        const double V_I = 12.0;      // insulin distribution volume, L
+        const double V_G = 117.0;     // glucose distribution volume, dL
+        const double T_MAX_I = 55.0;  // time to peak subcutaneous absorption, min
+        const double T_MAX_G = 40.0;  // time to peak gut absorption, min
+        const double CARB_BIOAVAILABILITY = 0.8;
+};
+
+// The original behaviour: glucose moves 0.1 toward the equilibrium glucose
+// every simulated second, ignoring insulin and carbs.
+class TargetNudgeModel : public GlucoseModel {
+    public:
+        TargetNudgeModel();
+
+        void reset(float glucose) override { this->glucose = glucose; pendingSeconds = 0.0; }
+        void setGlucose(float glucose) override { this->glucose = glucose; }
+        void setEquilibrium(float glucose, float) override { target = glucose; }
+
+        void addInsulin(float) override {}
+        void addCarbs(float) override {}
+
+        void advance(double minutes) override;
+        float getGlucose() const override { return glucose; }
+
+        void saveState(SnapshotWriter& out) const override;
+        bool restoreState(SnapshotReader& in) override;
+
+    private:
+        static constexpr char SNAPSHOT_TAG = 'N';
+
+        float glucose;
+        float target;
+        double pendingSeconds; // fractional seconds carried between calls
+};
+
+#endif // GLUCOSEMODEL_H
@@ -1,6 +1,7 @@
 #include "home.h"
 #include "profile.h"
-#include <QDebug>
+#include "trace.h"
+#include "snapshot.h"
 
 Home::Home(QObject *parent)
     : QObject(parent),
@@ -8,63 +9,56 @@ Home::Home(QObject *parent)
       charging(false),
       blocked(false),
       batteryLevel(100.0f),
-      insulinDoseRemaining(300),
-      iob(0.0f),
-      updateTimer(nullptr),
-      glucoseLevel()
+      reservoir(InsulinUnits::fromWhole(HomeRules::RESERVOIR_CAPACITY)),
+      glucose()
 {
-    initializeTimer();
+    // Home no longer owns a timer; it is advanced by SimulationEngine
 }
 
 Home::~Home()
 {
-    if (updateTimer) {
-        updateTimer->stop();
-        delete updateTimer;
-    }
 }
 
-void Home::initializeTimer()
+// Wall-clock entry point, kept for callers that drive Home directly
+void Home::onTimerTick()
 {
-    updateTimer = new QTimer(this);
-    connect(updateTimer, &QTimer::timeout, this, &Home::onTimerTick);
-    updateTimer->start(60000); // update every minute
-    qDebug() << "Timer initialized for background updates";
+    tick(QDateTime::currentDateTime());
 }
 
-void Home::onTimerTick()
+void Home::tick(const QDateTime& now)
+{
+    advanceMinutes(1, now);
+    raiseAlerts();
+}
+
+void Home::advanceMinutes(long long minutes, const QDateTime& now)
 {
     // Update time
-    time =  QDateTime::currentDateTime();
+    time = now;
 
     // Handle battery drain and charging
-    if (charging && batteryLevel < 100.0f) {
-        setBatteryLevel(batteryLevel + CHARGE_RATE);
-    } else if (!charging && batteryLevel > 0.0f) {
-        // Background battery drain
-        setBatteryLevel(batteryLevel - PASSIVE_DRAIN_RATE);
-    }
+    batteryLevel = HomeRules::batteryAfter(batteryLevel, charging, minutes);
 
+    // Decay IOB over time along the insulin action curve
+    insulinOnBoard.advance(static_cast<double>(minutes));
+}
+
+void Home::raiseAlerts()
+{
     // Check for alerts
     checkBatteryAlert();
     checkInsulinRemainingAlert();
 
     // Auto-shutdown if battery is critically low
     if (isPowerCritical() && !charging) {
-        qDebug() << "Critical battery level reached. Auto shutdown initiated.";
+        TRACE(Warning, Home, "Critical battery level reached. Auto shutdown initiated.");
         emit powerShutDown();
     }
-
-    // Decay IOB over time
-    if (iob > 0.0f) {
-        // Reduce IOB by some amount each minute
-        updateIOB(iob - 0.01f);
-    }
 }
 
 float Home::getBatteryLevel() { return batteryLevel; }
 bool Home::getCharging() { return charging; }
-int Home::getInsulinDoseRemaining() { return insulinDoseRemaining; }
+int Home::getInsulinDoseRemaining() { return static_cast<int>(reservoir.getWhole()); }
 
 bool Home::isPowerCritical() const
 {
@@ -90,32 +84,32 @@ void Home::usePower()
 void Home::chargePower()
 {
    charging = true;
-   qDebug() << "Charging started";
+   TRACE(Info, Home, "Charging started");
 }
 
 void Home::stopCharging()
 {
     charging = false;
-    qDebug() << "Charging stopped";
+    TRACE(Info, Home, "Charging stopped");
 }
 
 void Home::checkBatteryAlert()
 {
     if (batteryLevel <= CRITICAL_BATTERY_THRESHOLD) {
         emit criticalBatteryWarning(batteryLevel);
-        qDebug() << "CRITICAL BATTERY WARNING: " << batteryLevel << "% remaining";
+        TRACE(Warning, Home, "CRITICAL BATTERY WARNING: " << batteryLevel << "% remaining");
     }
     else if (batteryLevel < LOW_BATTERY_THRESHOLD) {
         emit lowBatteryWarning(batteryLevel);
-        qDebug() << "Low battery warning: " << batteryLevel << "% remaining";
+        TRACE(Warning, Home, "Low battery warning: " << batteryLevel << "% remaining");
     }
 }
 
 void Home::checkInsulinRemainingAlert()
 {
-    if(insulinDoseRemaining < LOW_INSULIN_THRESHOLD) {
-        emit insulinLowWarning(insulinDoseRemaining);
-        qDebug() << "Low insulin warning: " << insulinDoseRemaining << " units remaining";
+    if(reservoir < LOW_INSULIN_THRESHOLD) {
+        emit insulinLowWarning(getInsulinDoseRemaining());
+        TRACE(Warning, Home, "Low insulin warning: " << reservoir.toFloat() << " units remaining");
     }
 }
 
@@ -123,35 +117,57 @@ void Home::checkOcclusion()
 {
     if(blocked == true){
         emit occlusionDetected();
-        qDebug() << "Occlusion detected!";
+        TRACE(Warning, Home, "Occlusion detected!");
     }
 }
 
 void Home::setBatteryLevel(float battery)
 {
     // To ensure battery level stays within valid range
-    if (battery > 100.0f) {
-        batteryLevel = 100.0f;
-    } else if (battery < 0.0f) {
-        batteryLevel = 0.0f;
-    } else {
-        batteryLevel = battery;
-    }
+    batteryLevel = HomeRules::clampBattery(battery);
 }
 
 
-void Home::setInsulinRemaining(int amount)
+void Home::setReservoir(InsulinUnits amount)
 {
     // Ensure insulin amount is never negative
-    insulinDoseRemaining = (amount < 0) ? 0 : amount;
+    reservoir = (amount < InsulinUnits()) ? InsulinUnits() : amount;
+}
+
+void Home::recordInsulinDose(InsulinUnits units)
+{
+    insulinOnBoard.addDose(units.toFloat());
+
+    // The reservoir is counted in ticks, so it drains by exactly what was given
+    setReservoir(reservoir - units);
 }
 
-void Home::updateIOB(float amount)
+void Home::setGlucoseLevel(GlucoseMgdl g){
+    glucose = g;
+}
+
+void Home::saveState(SnapshotWriter& out) const
 {
-    // Ensure IOB is never negative
-    iob = (amount < 0.0f) ? 0.0f : amount;
+    out.write(static_cast<int64_t>(time.toMSecsSinceEpoch()));
+    out.write(powerOff);
+    out.write(charging);
+    out.write(blocked);
+    out.write(batteryLevel);
+    out.write(reservoir);
+    out.write(glucose);
+    insulinOnBoard.saveState(out);
 }
 
-void Home::setGlucoseLevel(float g){
-    glucoseLevel = g;
+bool Home::restoreState(SnapshotReader& in)
+{
+    int64_t msecs = 0;
+    in.read(msecs);
+    time = QDateTime::fromMSecsSinceEpoch(msecs);
+    in.read(powerOff);
+    in.read(charging);
+    in.read(blocked);
+    in.read(batteryLevel);
+    in.read(reservoir);
+    in.read(glucose);
+    return insulinOnBoard.restoreState(in);
 }
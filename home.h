@@ -2,10 +2,15 @@
 #define HOME_H
 
 #include "profile.h"
+#include "homeRules.h"
+#include "insulinOnBoard.h"
+#include "units.h"
 
 #include <QObject>
 #include <QDateTime>
-#include <QTimer>
+
+class SnapshotWriter;
+class SnapshotReader;
 
 class Home : public QObject
 {
@@ -23,15 +28,24 @@ public:
     bool isPowerCritical() const; // check if battery is critically low
 
     //insulin management
-    int getInsulinDoseRemaining();
-    float getIOB() const { return iob; } // getter for IOB
-    void updateIOB(float amount); // update IOB
+    int getInsulinDoseRemaining(); // whole units left in the reservoir
+    InsulinUnits getReservoir() const { return reservoir; }
+    float getIOB() const { return insulinOnBoard.getIOB(); } // getter for IOB
+    void recordInsulinDose(InsulinUnits units); // every delivered dose feeds IOB and drains the reservoir
+    const InsulinOnBoard& getInsulinOnBoard() const { return insulinOnBoard; }
+    InsulinOnBoard& getInsulinOnBoard() { return insulinOnBoard; }
     void adjustGlucoseLevel(float targetGlucose);
-    float getGlucoseLevel(){return glucoseLevel;}
-    void setGlucoseLevel(float g);
+    float getGlucoseLevel(){return glucose.toFloat();}
+    GlucoseMgdl getGlucose() const { return glucose; }
+    void setGlucoseLevel(GlucoseMgdl g);
 
     // Profile management
     void selectProfile(Profile *profile);
+    Profile* getSelectedProfile() const { return currentProfile; }
+
+    // Snapshot support; the selected profile is re-linked by the caller
+    void saveState(SnapshotWriter& out) const;
+    bool restoreState(SnapshotReader& in);
 
     // Power management
     void usePower();
@@ -43,6 +57,15 @@ public:
     void checkInsulinRemainingAlert();
     void checkOcclusion();
 
+    // Advance the background state by one minute of (real or simulated) time
+    void tick(const QDateTime& now);
+    // Apply several minute ticks at once without raising alerts
+    void advanceMinutes(long long minutes, const QDateTime& now);
+    // Emit any standing battery/insulin alerts and shut down if critical
+    void raiseAlerts();
+    bool isBatteryLow() const { return batteryLevel < LOW_BATTERY_THRESHOLD; }
+    bool isInsulinLow() const { return reservoir < LOW_INSULIN_THRESHOLD; }
+
 
 signals:
 
@@ -58,26 +81,23 @@ public slots:
 
 private:
     void setBatteryLevel(float battery);
-    void setInsulinRemaining(int amount); // setter for insulin
-    void initializeTimer(); // set up the timer
+    void setReservoir(InsulinUnits amount); // setter for insulin
 
     Profile *currentProfile = nullptr;
     bool powerOff;
     bool charging;
     bool blocked;
     float batteryLevel;
-    int insulinDoseRemaining;
-    float iob;
-    float glucoseLevel;
-    QTimer *updateTimer;
-
-    // Constants
-    const float CRITICAL_BATTERY_THRESHOLD = 5.0f;
-    const float LOW_BATTERY_THRESHOLD = 20.0f;
-    const float LOW_INSULIN_THRESHOLD = 50;
-    const float PASSIVE_DRAIN_RATE = 0.01f; // Battery drain per timer tick
-    const float ACTIVE_DRAIN_RATE = 0.1f;   // Battery drain per active operation
-    const float CHARGE_RATE = 0.2f;         // Battery charge rate when charging
+    InsulinUnits reservoir;
+    InsulinOnBoard insulinOnBoard;
+    GlucoseMgdl glucose;
+
+    // Constants (shared with CohortSimulator through HomeRules)
+    const float CRITICAL_BATTERY_THRESHOLD = HomeRules::CRITICAL_BATTERY_THRESHOLD;
+    const float LOW_BATTERY_THRESHOLD = HomeRules::LOW_BATTERY_THRESHOLD;
+    const InsulinUnits LOW_INSULIN_THRESHOLD = InsulinUnits::fromWhole(HomeRules::LOW_INSULIN_THRESHOLD);
+    const float ACTIVE_DRAIN_RATE = HomeRules::ACTIVE_DRAIN_RATE;
+    const float CHARGE_RATE = HomeRules::CHARGE_RATE;
 };
 
 #endif
@@ -0,0 +1,70 @@
+#ifndef HOMERULES_H
+#define HOMERULES_H
+
+// Battery, reservoir and alert rules shared by Home (one patient) and
+// CohortSimulator (many patients). The fixed IOB decay and the glucose
+// nudge are the cohort's cheap stand-ins: Home follows InsulinOnBoard's
+// action curves and its GlucoseModel (TargetNudgeModel uses the nudge).
+namespace HomeRules {
+
+    // Battery thresholds and rates
+    constexpr float CRITICAL_BATTERY_THRESHOLD = 5.0f;
+    constexpr float LOW_BATTERY_THRESHOLD = 20.0f;
+    constexpr float PASSIVE_DRAIN_RATE = 0.01f; // Battery drain per minute tick
+    constexpr float ACTIVE_DRAIN_RATE = 0.1f;   // Battery drain per active operation
+    constexpr float CHARGE_RATE = 0.2f;         // Battery charge rate when charging
+    constexpr float MAX_BATTERY = 100.0f;
+
+    // Insulin
+    constexpr int LOW_INSULIN_THRESHOLD = 50;
+    constexpr int RESERVOIR_CAPACITY = 300;
+    constexpr float IOB_DECAY_PER_MINUTE = 0.01f;
+
+    // Glucose moves this much toward target per simulated second
+    constexpr float GLUCOSE_STEP = 0.1f;
+
+    inline float clampBattery(float battery) {
+        if (battery > MAX_BATTERY) return MAX_BATTERY;
+        if (battery < 0.0f) return 0.0f;
+        return battery;
+    }
+
+    // Battery level after one minute tick
+    inline float batteryTick(float battery, bool charging) {
+        if (charging && battery < MAX_BATTERY) {
+            return clampBattery(battery + CHARGE_RATE);
+        } else if (!charging && battery > 0.0f) {
+            return clampBattery(battery - PASSIVE_DRAIN_RATE);
+        }
+        return battery;
+    }
+
+    // IOB after one minute tick
+    inline float iobTick(float iob) {
+        if (iob > 0.0f) {
+            float next = iob - IOB_DECAY_PER_MINUTE;
+            return (next < 0.0f) ? 0.0f : next;
+        }
+        return iob;
+    }
+
+    // Battery level after `minutes` ticks, in closed form
+    inline float batteryAfter(float battery, bool charging, long long minutes) {
+        if (minutes <= 0) return battery;
+        if (charging && battery < MAX_BATTERY) {
+            return clampBattery(battery + CHARGE_RATE * minutes);
+        } else if (!charging && battery > 0.0f) {
+            return clampBattery(battery - PASSIVE_DRAIN_RATE * minutes);
+        }
+        return battery;
+    }
+
+    // Glucose after one simulated second of nudging toward target
+    inline float glucoseStep(float glucose, float target) {
+        if (target > glucose) return glucose + GLUCOSE_STEP;
+        if (target < glucose) return glucose - GLUCOSE_STEP;
+        return glucose;
+    }
+}
+
+#endif // HOMERULES_H
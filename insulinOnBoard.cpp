@@ -0,0 +1,180 @@
+#include "insulinOnBoard.h"
+#include <limits>
+#include <vector>
+#include "snapshot.h"
+
+using namespace InsulinCurves;
+
+InsulinOnBoard::InsulinOnBoard(InsulinCurve curve)
+    : curve(curve), table(nullptr), base(0), now(0.0), c0(0.0), c1(0.0),
+      nextCrossing(std::numeric_limits<double>::infinity()), migrations(0) {
+    boundary.fill(0);
+    setCurve(curve);
+}
+
+void InsulinOnBoard::setCurve(InsulinCurve newCurve) {
+    curve = newCurve;
+    table = (curve == InsulinCurve::Exponential) ? &EXPONENTIAL_TABLE : &BILINEAR_TABLE;
+    rebuild();
+}
+
+double InsulinOnBoard::slope(int segment) const {
+    return ((*table)[segment + 1] - (*table)[segment]) / KNOT_MINUTES;
+}
+
+double InsulinOnBoard::intercept(int segment) const {
+    return (*table)[segment] - slope(segment) * segment * KNOT_MINUTES;
+}
+
+// units * f(now - time) = units * (intercept - slope * time) + units * slope * now
+void InsulinOnBoard::addToSegment(const Dose& dose, int segment, double sign) {
+    if (segment >= SEGMENTS) {
+        return; // expired doses contribute nothing
+    }
+    double m = slope(segment);
+    c0 += sign * dose.units * (intercept(segment) - m * dose.time);
+    c1 += sign * dose.units * m;
+}
+
+void InsulinOnBoard::addDose(float units) {
+    if (units <= 0.0f) {
+        return;
+    }
+    Dose dose;
+    dose.time = now;
+    dose.units = units;
+    doses.push_back(dose);
+    addToSegment(dose, 0, 1.0);
+
+    if (dose.time + KNOT_MINUTES < nextCrossing) {
+        nextCrossing = dose.time + KNOT_MINUTES;
+    }
+}
+
+void InsulinOnBoard::advance(double minutes) {
+    advanceTo(now + minutes);
+}
+
+void InsulinOnBoard::advanceTo(double minutes) {
+    if (minutes <= now) {
+        return;
+    }
+    now = minutes;
+
+    // Nothing changes segment until the next knot crossing
+    if (now >= nextCrossing) {
+        migrate();
+    }
+}
+
+// Move doses across every knot they have passed; boundaries are walked from
+// the youngest so a dose can cross several knots in one call
+void InsulinOnBoard::migrate() {
+    size_t end = base + doses.size();
+    for (int j = 1; j <= SEGMENTS; ++j) {
+        size_t& b = boundary[j];
+        if (b < base) b = base;
+        double knotAge = static_cast<double>(j) * KNOT_MINUTES;
+        while (b < end && now - doses[b - base].time >= knotAge) {
+            const Dose& dose = doses[b - base];
+            addToSegment(dose, j - 1, -1.0);
+            addToSegment(dose, j, 1.0);
+            ++b;
+            ++migrations;
+        }
+    }
+
+    // Drop doses that have passed the last knot
+    while (base < boundary[SEGMENTS]) {
+        doses.pop_front();
+        ++base;
+    }
+
+    if (doses.empty() || migrations >= REBUILD_INTERVAL) {
+        rebuild();
+    } else {
+        updateNextCrossing();
+    }
+}
+
+// Exact recomputation of the coefficients from the stored doses
+void InsulinOnBoard::rebuild() {
+    c0 = 0.0;
+    c1 = 0.0;
+    migrations = 0;
+    size_t end = base + doses.size();
+    for (int j = SEGMENTS; j >= 1; --j) {
+        if (boundary[j] < base) boundary[j] = base;
+        if (boundary[j] > end) boundary[j] = end;
+    }
+    // Segment j holds doses in [boundary[j+1], boundary[j])
+    for (int j = 0; j < SEGMENTS; ++j) {
+        size_t from = boundary[j + 1];
+        size_t to = (j == 0) ? end : boundary[j];
+        for (size_t i = from; i < to; ++i) {
+            addToSegment(doses[i - base], j, 1.0);
+        }
+    }
+    updateNextCrossing();
+}
+
+void InsulinOnBoard::updateNextCrossing() {
+    nextCrossing = std::numeric_limits<double>::infinity();
+    size_t end = base + doses.size();
+    for (int j = 1; j <= SEGMENTS; ++j) {
+        size_t b = (boundary[j] < base) ? base : boundary[j];
+        if (b < end) {
+            double t = doses[b - base].time + static_cast<double>(j) * KNOT_MINUTES;
+            if (t < nextCrossing) nextCrossing = t;
+        }
+    }
+}
+
+float InsulinOnBoard::getIOB() const {
+    double value = c0 + c1 * now;
+    return (value > 0.0) ? static_cast<float>(value) : 0.0f;
+}
+
+void InsulinOnBoard::clear() {
+    doses.clear();
+    base = 0;
+    boundary.fill(0);
+    rebuild();
+}
+
+void InsulinOnBoard::saveState(SnapshotWriter& out) const {
+    out.write(curve);
+    out.write(now);
+    std::vector<Dose> active(doses.begin(), doses.end());
+    out.writeVector(active);
+}
+
+bool InsulinOnBoard::restoreState(SnapshotReader& in) {
+    InsulinCurve savedCurve = InsulinCurve::Exponential;
+    std::vector<Dose> active;
+    in.read(savedCurve);
+    in.read(now);
+    in.readVector(active);
+    if (!in.isValid()) {
+        return false;
+    }
+
+    doses.assign(active.begin(), active.end());
+    base = 0;
+
+    // Recompute which segment every dose is in; doses are oldest first, so
+    // the boundary for an older knot never lies past a younger one
+    size_t b = 0;
+    for (int j = SEGMENTS; j >= 1; --j) {
+        double knotAge = static_cast<double>(j) * KNOT_MINUTES;
+        while (b < doses.size() && now - doses[b].time >= knotAge) {
+            ++b;
+        }
+        boundary[j] = b;
+    }
+
+    curve = savedCurve;
+    table = (curve == InsulinCurve::Exponential) ? &EXPONENTIAL_TABLE : &BILINEAR_TABLE;
+    rebuild();
+    return true;
+}
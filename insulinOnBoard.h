@@ -0,0 +1,145 @@
+#ifndef INSULINONBOARD_H
+#define INSULINONBOARD_H
+
+#include <array>
+#include <deque>
+#include <cstddef>
+
+class SnapshotWriter;
+class SnapshotReader;
+
+// Insulin action curves for rapid-acting insulin
+enum class InsulinCurve {
+    Exponential, // Loop-style exponential model
+    Bilinear     // Walsh-style triangular activity
+};
+
+namespace InsulinCurves {
+    constexpr double DURATION_MINUTES = 360.0; // duration of insulin action
+    constexpr double PEAK_MINUTES = 75.0;      // time of peak activity
+    constexpr int KNOT_MINUTES = 5;            // table resolution
+    constexpr int SEGMENTS = static_cast<int>(DURATION_MINUTES) / KNOT_MINUTES;
+
+    typedef std::array<double, SEGMENTS + 1> Table;
+
+    // exp() usable in constant expressions: halve into series range, square back
+    constexpr double constExp(double x) {
+        int halvings = 0;
+        while (x > 0.5 || x < -0.5) {
+            x /= 2.0;
+            ++halvings;
+        }
+        double term = 1.0;
+        double sum = 1.0;
+        for (int n = 1; n < 20; ++n) {
+            term *= x / n;
+            sum += term;
+        }
+        while (halvings-- > 0) {
+            sum *= sum;
+        }
+        return sum;
+    }
+
+    // Fraction of a dose still on board `t` minutes after delivery
+    constexpr double exponentialIOB(double t) {
+        const double td = DURATION_MINUTES;
+        const double tp = PEAK_MINUTES;
+        const double tau = tp * (1.0 - tp / td) / (1.0 - 2.0 * tp / td);
+        const double a = 2.0 * tau / td;
+        const double s = 1.0 / (1.0 - a + (1.0 + a) * constExp(-td / tau));
+        if (t <= 0.0) return 1.0;
+        if (t >= td) return 0.0;
+        return 1.0 - s * (1.0 - a) * ((t * t / (tau * td * (1.0 - a)) - t / tau - 1.0) * constExp(-t / tau) + 1.0);
+    }
+
+    constexpr double bilinearIOB(double t) {
+        const double td = DURATION_MINUTES;
+        const double tp = PEAK_MINUTES;
+        const double peak = 2.0 / td; // activity at the peak, so the total area is 1
+        if (t <= 0.0) return 1.0;
+        if (t >= td) return 0.0;
+        if (t <= tp) {
+            return 1.0 - peak * t * t / (2.0 * tp);
+        }
+        double tail = td - t;
+        return 1.0 - (peak * tp / 2.0 + peak * ((td - tp) * (td - tp) - tail * tail) / (2.0 * (td - tp)));
+    }
+
+    constexpr Table makeTable(InsulinCurve curve) {
+        Table table{};
+        for (int i = 0; i <= SEGMENTS; ++i) {
+            double t = static_cast<double>(i) * KNOT_MINUTES;
+            table[i] = (curve == InsulinCurve::Exponential) ? exponentialIOB(t) : bilinearIOB(t);
+        }
+        table[SEGMENTS] = 0.0;
+        return table;
+    }
+
+    // Generated at compile time
+    constexpr Table EXPONENTIAL_TABLE = makeTable(InsulinCurve::Exponential);
+    constexpr Table BILINEAR_TABLE = makeTable(InsulinCurve::Bilinear);
+}
+
+// Tracks every delivered dose and reports insulin on board. The action
+// curve is piecewise linear between table knots, so the IOB of all doses
+// in one segment is an affine function of time; the engine keeps the sum of
+// those functions as two running coefficients (IOB = c0 + c1 * now) and only
+// touches a dose when it crosses a knot. Each dose crosses a fixed number of
+// knots in its lifetime, so updates are O(1) amortized regardless of how
+// many doses are on board, and reading the IOB is O(1).
+class InsulinOnBoard {
+    public:
+        explicit InsulinOnBoard(InsulinCurve curve = InsulinCurve::Exponential);
+
+        void setCurve(InsulinCurve curve);
+        InsulinCurve getCurve() const { return curve; }
+
+        // Record a dose delivered at the current time
+        void addDose(float units);
+        // Move the clock forward
+        void advance(double minutes);
+        void advanceTo(double minutes);
+        double getTime() const { return now; }
+
+        float getIOB() const;
+        size_t getActiveDoseCount() const { return doses.size(); }
+        void clear();
+
+        // Snapshot support; coefficients are rebuilt exactly on restore
+        void saveState(SnapshotWriter& out) const;
+        bool restoreState(SnapshotReader& in);
+
+    private:
+        struct Dose {
+            double time;
+            double units;
+        };
+
+        // Coefficients of segment j's linear piece: f(age) = slope * (age - j*knot) + f_j
+        double intercept(int segment) const;
+        double slope(int segment) const;
+        void addToSegment(const Dose& dose, int segment, double sign);
+        void migrate();
+        void rebuild();
+        void updateNextCrossing();
+
+        InsulinCurve curve;
+        const InsulinCurves::Table* table;
+
+        std::deque<Dose> doses;  // oldest first
+        size_t base;             // absolute index of doses.front()
+        // boundary[j]: absolute index of the first dose younger than j knots
+        std::array<size_t, InsulinCurves::SEGMENTS + 1> boundary;
+
+        double now;
+        double c0;
+        double c1;
+        double nextCrossing;     // earliest time any dose reaches its next knot
+        unsigned migrations;     // since the last exact rebuild
+
+        // Periodically recompute the coefficients exactly to bound rounding drift
+        const unsigned REBUILD_INTERVAL = 4096;
+};
+
+#endif // INSULINONBOARD_H
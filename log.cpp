@@ -1,74 +1,416 @@
 #include "log.h"
-#include <ctime>
-#include <iomanip>
-#include <sstream>
+#include "logRingBuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
+#include "snapshot.h"
 
 // Constructor
-Log::Log() : output("") {
+Log::Log() : output(""), formatted(0), segmentStart(0), savedSegments(0), savedBytes(0), mode(SYNCHRONOUS), consoleEcho(true), stopping(false), writerIdle(false),
+             produced(0), consumed(0), stampTime(static_cast<time_t>(-1)), eventTime(-1), eventLogOpen(false) {
     // Initialize the log with a header
-    updateTime();
-    output += " - Log initialized\n";
+    store(now(), LogFormat::Text, LogArgs("Log initialized"));
+}
+
+Log::~Log() {
+    // Drain and stop the writer thread
+    setMode(SYNCHRONOUS);
 }
 
 // Append text to the log with a timestamp
-void Log::appendText(string s) {
-    updateTime();
-    output += " - " + s + "\n";
-    
+void Log::appendText(const string& s) {
+    record(LogFormat::Text, LogArgs(s));
+}
+
+void Log::record(LogFormat format, const LogArgs& args) {
+    const LogFormatSpec& spec = LogFormats::spec(format);
+    if (spec.hasEvent && eventLogOpen.load(std::memory_order_relaxed)) {
+        logEvent(spec.category, spec.event, args.count > 0 ? args.numbers[0] : 0.0);
+    }
+
+    time_t when = now();
+    if (mode == ASYNCHRONOUS) {
+        // Hand off to the writer; if it has fallen a whole ring behind, wait for it
+        while (!ring->tryPush(when, format, args)) {
+            wake.notify_one();
+            std::this_thread::yield();
+        }
+        produced.fetch_add(1, std::memory_order_release);
+        // Only the first producer to find the writer asleep pays for the wakeup
+        if (writerIdle.load(std::memory_order_relaxed) && writerIdle.exchange(false)) {
+            wake.notify_one();
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(outputLock);
+        store(when, format, args);
+    }
+
     // Also print to console for debugging
-    std::cout << "[LOG] " << s << std::endl;
+    if (consoleEcho) {
+        echo(format, args);
+    }
+}
+
+// Caller holds outputLock
+void Log::store(time_t when, LogFormat format, const LogArgs& args) {
+    DeferredLogEntry entry;
+    entry.time = when;
+    entry.format = format;
+    entry.args = args;
+    entries.append(entry);
+    rotate();
+}
+
+void Log::rotate() {
+    // Entries whose segment has been compressed are no longer needed
+    uint64_t sealedEnd = archive.collect();
+    if (sealedEnd > entries.begin()) {
+        entries.dropBefore(sealedEnd);
+        output.clear();
+        formatted = sealedEnd;
+    }
+
+    uint64_t end = entries.end();
+    if (!rotation.enabled || end == segmentStart) {
+        return;
+    }
+    uint64_t count = end - segmentStart;
+    bool full = (rotation.maxSegmentEntries > 0 && count >= rotation.maxSegmentEntries) || count >= MAX_SEGMENT_ENTRIES;
+    bool old = rotation.maxSegmentSeconds > 0
+            && entries.at(end - 1).time - entries.at(segmentStart).time >= rotation.maxSegmentSeconds;
+    if (full || old) {
+        // Keep the store from outgrowing the compressor
+        archive.waitIdle(MAX_PENDING_SEGMENTS - 1);
+        archive.seal(entries, segmentStart, end);
+        segmentStart = end;
+    }
+}
+
+void Log::setRotation(const LogRotation& r) {
+    flush();
+    std::lock_guard<std::mutex> guard(outputLock);
+    rotation = r;
+    archive.configure(r);
+}
+
+LogRotation Log::getRotation() const {
+    std::lock_guard<std::mutex> guard(outputLock);
+    return rotation;
+}
+
+time_t Log::now() const {
+    long long simulated = eventTime.load(std::memory_order_relaxed);
+    return simulated >= 0 ? static_cast<time_t>(simulated / 1000) : time(0);
+}
+
+void Log::echo(LogFormat format, const LogArgs& args) {
+    string line = "[LOG] ";
+    LogFormats::format(format, args.numbers, args.text, line);
+    std::cout << line << std::endl;
+}
+
+void Log::materialize() const {
+    uint64_t end = entries.end();
+    for (uint64_t pos = std::max(formatted, entries.begin()); pos < end; ++pos) {
+        const DeferredLogEntry& entry = entries.at(pos);
+        output += timestamp(entry.time);
+        output += " - ";
+        LogFormats::format(entry.format, entry.args.numbers, entry.args.text, output);
+        output += '\n';
+    }
+    formatted = end;
 }
 
 // Update the time in the log
 void Log::updateTime() {
-    // Get current time
-    time_t now = time(0);
-    tm* localTime = localtime(&now);
-    
-    // Format time as [HH:MM:SS]
-    std::stringstream ss;
-    ss << "[" << std::setfill('0') << std::setw(2) << localTime->tm_hour << ":"
-       << std::setfill('0') << std::setw(2) << localTime->tm_min << ":"
-       << std::setfill('0') << std::setw(2) << localTime->tm_sec << "]";
-    
-    // Add to output
-    output += ss.str();
+    std::lock_guard<std::mutex> guard(outputLock);
+    materialize();
+    output += timestamp(now());
+}
+
+// Format time as [HH:MM:SS]; caller holds outputLock
+const string& Log::timestamp(time_t when) const {
+    if (when != stampTime) {
+        stamp.clear();
+        LogStore::formatTime(when, stamp);
+        stampTime = when;
+    }
+    return stamp;
+}
+
+void Log::setMode(Mode m) {
+    if (m == mode) {
+        return;
+    }
+
+    if (m == ASYNCHRONOUS) {
+        if (!ring) {
+            ring.reset(new LogRingBuffer(RING_CAPACITY));
+        }
+        stopping = false;
+        mode = ASYNCHRONOUS;
+        writer = std::thread(&Log::writerLoop, this);
+        return;
+    }
+
+    // The writer drains the ring before it exits
+    stopping = true;
+    wake.notify_one();
+    writer.join();
+    mode = SYNCHRONOUS;
+}
+
+void Log::flush() const {
+    if (mode != ASYNCHRONOUS) {
+        return;
+    }
+    unsigned long long target = produced.load(std::memory_order_acquire);
+    wake.notify_one();
+    std::unique_lock<std::mutex> lock(outputLock);
+    drained.wait(lock, [this, target] { return consumed >= target; });
+}
+
+// Background writer: drain the ring in batches, append under the lock and
+// print outside it, then sleep until producers wake it up again
+void Log::writerLoop() {
+    DeferredLogEntry entry;
+    string console;
+
+    for (;;) {
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> guard(outputLock);
+            while (count < WRITER_BATCH && ring->tryPop(entry)) {
+                entries.append(entry);
+                rotate();
+                if (consoleEcho) {
+                    console += "[LOG] ";
+                    LogFormats::format(entry.format, entry.args.numbers, entry.args.text, console);
+                    console += '\n';
+                }
+                ++count;
+            }
+            consumed += count;
+        }
+
+        if (count > 0) {
+            drained.notify_all();
+            if (!console.empty()) {
+                std::cout << console << std::flush;
+                console.clear();
+            }
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeLock);
+        writerIdle = true;
+        wake.wait_for(lock, std::chrono::milliseconds(WRITER_IDLE_MS));
+        writerIdle = false;
+    }
+}
+
+bool Log::openEventLog(const string& path) {
+    std::lock_guard<std::mutex> guard(eventLock);
+    eventLogOpen = eventWriter.open(path);
+    return eventLogOpen;
+}
+
+void Log::closeEventLog() {
+    std::lock_guard<std::mutex> guard(eventLock);
+    eventLogOpen = false;
+    eventWriter.close();
+}
+
+void Log::logEvent(LogCategory category, LogEventCode code, double value) {
+    long long when = eventTime.load(std::memory_order_relaxed);
+    if (when < 0) {
+        when = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    std::lock_guard<std::mutex> guard(eventLock);
+    eventWriter.append(when, category, code, value);
+}
+
+bool Log::flushEvents() {
+    std::lock_guard<std::mutex> guard(eventLock);
+    return eventWriter.flush();
 }
 
 // Get the full log content
 string Log::getFullLog() const {
-    return output;
+    flush();
+    std::lock_guard<std::mutex> guard(outputLock);
+    string full;
+    for (size_t i = 0; i < archive.segmentCount(); ++i) {
+        archive.text(i, full);
+    }
+    materialize();
+    full += output;
+    return full;
+}
+
+LogHistory Log::getHistory() const {
+    std::lock_guard<std::mutex> guard(outputLock);
+    LogHistory history;
+    archivedRows(-1, history);
+    history.live = entries.all();
+    return history;
+}
+
+LogHistory Log::getHistory(LogCategory category) const {
+    std::lock_guard<std::mutex> guard(outputLock);
+    LogHistory history;
+    archivedRows(static_cast<int>(category), history);
+    history.live = entries.category(category);
+    return history;
+}
+
+// Caller holds outputLock, so no segment is collected or dropped meanwhile
+void Log::archivedRows(int category, LogHistory& history) const {
+    history.generation = archive.generation();
+    history.firstSegment = archive.firstSegment();
+    history.segmentRows.resize(archive.segmentCount());
+    for (size_t i = 0; i < archive.segmentCount(); ++i) {
+        const LogSegment& segment = archive.segment(i);
+        uint32_t rows = 0;
+        for (int c = 0; c < LogFormats::CATEGORY_COUNT; ++c) {
+            if (category < 0 || category == c) {
+                rows += segment.counts[c];
+            }
+        }
+        history.segmentRows[i] = rows;
+    }
+}
+
+LogView Log::getLogEntries() const {
+    flush();
+    return entries.all();
+}
+
+LogView Log::query(time_t from, time_t to) const {
+    flush();
+    return entries.between(from, to);
+}
+
+LogView Log::query(LogCategory category) const {
+    flush();
+    return entries.category(category);
 }
 
-// Get the list of log entries
-vector<string> Log::getLogEntries() const {
-    return logEntries;
+LogView Log::query(LogCategory category, time_t from, time_t to) const {
+    flush();
+    return entries.category(category, from, to);
+}
+
+LogView Log::lastEntries(LogCategory category, size_t count) const {
+    flush();
+    return entries.lastOf(category, count);
 }
 
 // Clear the log
 void Log::clearLog() {
+    flush();
+    std::lock_guard<std::mutex> guard(outputLock);
+    archive.clear();
+    entries.clear();
     output = "";
-    logEntries.clear();
+    formatted = entries.end();
+    segmentStart = entries.end();
+    savedFile.clear();
 
     // Reinitialize
-    updateTime();
-    string initMessage = " - Log cleared and reinitialized\n";
-    output += initMessage;
-    logEntries.push_back(initMessage);
+    store(now(), LogFormat::Text, LogArgs("Log cleared and reinitialized"));
 }
 
 // Save the log to a file
 bool Log::saveToFile(const string& filename) {
+    flush();
+    std::lock_guard<std::mutex> guard(outputLock);
+    materialize();
     try {
-        std::ofstream logFile(filename);
-        if (logFile.is_open()) {
-            logFile << output;
-            logFile.close();
-            return true;
+        // Continue the previous save if the file is still as we left it and
+        // no unsaved segment has been dropped from the archive since
+        std::error_code error;
+        uint64_t endSegment = archive.firstSegment() + archive.segmentCount();
+        bool resume = filename == savedFile && savedSegments >= archive.firstSegment() && savedSegments <= endSegment
+                && std::filesystem::exists(filename, error) && std::filesystem::file_size(filename, error) >= savedBytes;
+        if (resume) {
+            std::filesystem::resize_file(filename, savedBytes, error);
+            resume = !error;
         }
-        return false;
+        if (!resume) {
+            savedSegments = archive.firstSegment();
+            savedBytes = 0;
+        }
+
+        std::ofstream logFile(filename, resume ? std::ios::app : std::ios::trunc);
+        if (!logFile.is_open()) {
+            savedFile.clear();
+            return false;
+        }
+        string text;
+        for (; savedSegments < endSegment; ++savedSegments) {
+            text.clear();
+            archive.text(static_cast<size_t>(savedSegments - archive.firstSegment()), text);
+            logFile << text;
+            savedBytes += text.size();
+        }
+        // The live tail is rewritten by the next save
+        logFile << output;
+        logFile.close();
+        savedFile = logFile ? filename : string();
+        return !savedFile.empty();
     } catch (...) {
+        savedFile.clear();
         return false;
     }
-}
\ No newline at end of file
+}
+
+void Log::saveState(SnapshotWriter& out) const {
+    flush();
+    std::lock_guard<std::mutex> guard(outputLock);
+    materialize();
+    archive.saveState(out);
+    out.writeString(output);
+    out.write(static_cast<uint64_t>(entries.end() - entries.begin()));
+    for (uint64_t pos = entries.begin(); pos < entries.end(); ++pos) {
+        const DeferredLogEntry& entry = entries.at(pos);
+        out.write(static_cast<int64_t>(entry.time));
+        out.write(entry.format);
+        out.write(entry.args.numbers);
+        out.writeString(entry.args.text);
+    }
+}
+
+bool Log::restoreState(SnapshotReader& in) {
+    flush();
+    std::lock_guard<std::mutex> guard(outputLock);
+    archive.restoreState(in);
+    entries.clear();
+    in.readString(output);
+    uint64_t count = 0;
+    in.read(count);
+    for (uint64_t i = 0; i < count && in.isValid(); ++i) {
+        int64_t time = 0;
+        DeferredLogEntry entry;
+        in.read(time);
+        in.read(entry.format);
+        in.read(entry.args.numbers);
+        in.readString(entry.args.text);
+        entry.time = static_cast<time_t>(time);
+        entry.args.count = LogFormats::MAX_NUMBERS;
+        entries.restore(entry);
+    }
+    formatted = entries.end();
+    segmentStart = entries.begin();
+    savedFile.clear();
+    return in.isValid();
+}
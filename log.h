@@ -4,25 +4,167 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "eventLog.h"
+#include "logArchive.h"
+#include "logFormat.h"
+#include "logStore.h"
 
 using namespace std;
 
+class SnapshotWriter;
+class SnapshotReader;
+class LogRingBuffer;
+
+// Where a log's entries are right now: row counts of the archived segments
+// and a view of the live ones, taken together so no entry is in both
+struct LogHistory {
+    unsigned long long generation = 0; // changes when the log is cleared or restored
+    uint64_t firstSegment = 0;         // archive number of segmentRows[0]
+    std::vector<uint32_t> segmentRows; // matching entries per archived segment
+    LogView live;
+};
+
 class Log {
+    public:
+        // SYNCHRONOUS stores each call on the caller's thread. ASYNCHRONOUS
+        // only copies it into a lock-free ring buffer; a background writer
+        // thread stores it and does the console echo.
+        enum Mode {SYNCHRONOUS, ASYNCHRONOUS};
+
     private:
-        string output;
+        // Text is only built when the log is read: calls are kept in the
+        // store as format id + raw arguments and formatted into `output` on
+        // demand. The store also indexes them for queries.
+        mutable string output;
+        LogStore entries;
+        mutable uint64_t formatted; // store position `output` is complete up to
+
+        // Older entries are sealed into compressed segments and dropped from
+        // the store, so only the live segment stays uncompressed in memory
+        LogRotation rotation;
+        LogArchive archive;
+        uint64_t segmentStart;      // first store position not yet sealed
+
+        // What the last saveToFile() wrote, so the next one only appends
+        string savedFile;
+        uint64_t savedSegments;     // archive segment number the next save starts at
+        uint64_t savedBytes;        // file size after the saved segments
+
+        Mode mode;
+        std::atomic<bool> consoleEcho;
+        std::unique_ptr<LogRingBuffer> ring;
+        std::thread writer;
+        std::atomic<bool> stopping;
+        std::atomic<bool> writerIdle;
+        std::atomic<unsigned long long> produced; // records pushed to the ring
+        unsigned long long consumed;              // records written; guarded by outputLock
+
+        mutable std::mutex outputLock;
+        mutable std::condition_variable drained;
+        mutable std::mutex wakeLock;
+        mutable std::condition_variable wake;
+
+        // The local time is only converted (with localtime_r, never the shared
+        // localtime() buffer) and formatted again when the second changes
+        mutable time_t stampTime;
+        mutable string stamp;
+
+        void store(time_t when, LogFormat format, const LogArgs& args);
+        // Seal and drop segments; caller holds outputLock
+        void rotate();
+        // Simulated time once the engine drives the log, otherwise wall clock
+        time_t now() const;
+        void echo(LogFormat format, const LogArgs& args);
+        // Format everything pending into `output`; caller holds outputLock
+        void materialize() const;
+        const string& timestamp(time_t when) const;
+        void writerLoop();
+        // Archived part of a history, for one category or (negative) all
+        void archivedRows(int category, LogHistory& history) const;
+
+        // Typed binary events, alongside the text
+        EventLogWriter eventWriter;
+        std::mutex eventLock;
+        std::atomic<long long> eventTime; // msecs since epoch; negative = wall clock
+        std::atomic<bool> eventLogOpen;
+
+        const size_t RING_CAPACITY = 8192;
+        const size_t WRITER_BATCH = 256;
+        const int WRITER_IDLE_MS = 5;
+        // Sealed segments may wait this many deep for compression
+        const size_t MAX_PENDING_SEGMENTS = 4;
+        const uint64_t MAX_SEGMENT_ENTRIES = ChunkedRing<DeferredLogEntry>::CAPACITY / 8;
+
     public:
         Log();
+        ~Log();
+
+        Log(const Log&) = delete;
+        Log& operator=(const Log&) = delete;
+
+        void appendText(const string& s);
+
+        // Log a predefined message; arguments are captured, not formatted.
+        // Messages with a typed event also go to the binary event log.
+        template <class... Args>
+        void write(LogFormat format, const Args&... args) { record(format, LogArgs(args...)); }
+        void record(LogFormat format, const LogArgs& args);
 
-        void appendText(string s);
         void updateTime();
-        vector<string> logEntries;
+
+        // Switch modes while no other thread is logging
+        void setMode(Mode m);
+        Mode getMode() const { return mode; }
+        // Wait until every message appended so far has been written
+        void flush() const;
+        // Echo each entry to std::cout (on by default)
+        void setConsoleEcho(bool echo) { consoleEcho = echo; }
+        // Segment size and age limits, and where sealed segments go
+        void setRotation(const LogRotation& r);
+        LogRotation getRotation() const;
+
+        // Structured binary events. Timestamps follow the simulated clock
+        // once the engine sets it, otherwise the wall clock.
+        bool openEventLog(const string& path);
+        void closeEventLog();
+        void logEvent(LogCategory category, LogEventCode code, double value = 0.0);
+        bool flushEvents();
+        void setEventTime(long long msecsSinceEpoch) { eventTime.store(msecsSinceEpoch, std::memory_order_relaxed); }
+
+        // Indexed queries. Each returns a view over the stored entries (no
+        // copies) after waiting for pending asynchronous writes. Entries that
+        // have been rotated into compressed segments are not included.
+        LogView getLogEntries() const;
+        LogView query(time_t from, time_t to) const;
+        LogView query(LogCategory category) const;
+        LogView query(LogCategory category, time_t from, time_t to) const;
+        LogView lastEntries(LogCategory category, size_t count) const;
+        // Direct store access without waiting: readers may miss entries the
+        // asynchronous writer has not stored yet (e.g. a live view)
+        const LogStore& getStore() const { return entries; }
+        // Archived and live entries for a viewer, also without waiting;
+        // archived entries are read back with getArchive().unpack()
+        LogHistory getHistory() const;
+        LogHistory getHistory(LogCategory category) const;
+        const LogArchive& getArchive() const { return archive; }
 
         //control log
+        // Sealed segments plus the live text
         string getFullLog() const;
         void clearLog();
+        // Saving to the same file again only appends segments sealed since
+        // the last save and rewrites the live tail
         bool saveToFile(const string& filename);
-        vector<string> getLogEntries() const;
+
+        // Snapshot support
+        void saveState(SnapshotWriter& out) const;
+        bool restoreState(SnapshotReader& in);
 };
 
 #endif // LOG_H
-
@@ -0,0 +1,333 @@
+#include "logArchive.h"
+#include "logStore.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <utility>
+
+// One background thread compresses sealed segments for every log in the
+// process, in the order they were sealed
+class LogCompressor {
+    public:
+        struct Job {
+            LogArchive* archive;
+            const LogStore* store;
+            LogSegment segment;
+            int level;
+            std::string path;
+        };
+
+        static LogCompressor& instance() {
+            static LogCompressor compressor;
+            return compressor;
+        }
+
+        void submit(Job&& job) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!worker.joinable()) {
+                worker = std::thread(&LogCompressor::run, this);
+            }
+            jobs.push_back(std::move(job));
+            wake.notify_one();
+        }
+
+        ~LogCompressor() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_one();
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+
+    private:
+        LogCompressor() : stopping(false) {}
+
+        void run() {
+            for (;;) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    wake.wait(guard, [this] { return stopping || !jobs.empty(); });
+                    if (jobs.empty()) {
+                        return;
+                    }
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                job.archive->compress(*job.store, job.segment, job.level, job.path);
+            }
+        }
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::deque<Job> jobs;
+        std::thread worker;
+        bool stopping;
+};
+
+LogArchive::LogArchive() : dropped(0), memoryBytes(0), compressionLevel(1), memoryLimit(LogRotation().maxMemoryBytes), sequence(0), clears(0), pending(0) {
+    std::random_device random;
+    fileId = (static_cast<unsigned long long>(random()) << 32) | random();
+}
+
+LogArchive::~LogArchive() {
+    // The compression thread may still be reading our store
+    waitIdle();
+}
+
+void LogArchive::configure(const LogRotation& rotation) {
+    directory = rotation.directory;
+    compressionLevel = rotation.compressionLevel;
+    memoryLimit = rotation.maxMemoryBytes;
+    std::lock_guard<std::mutex> guard(lock);
+    trim();
+}
+
+void LogArchive::seal(const LogStore& store, uint64_t first, uint64_t last) {
+    LogCompressor::Job job;
+    job.archive = this;
+    job.store = &store;
+    job.segment.first = first;
+    job.segment.last = last;
+    job.segment.firstTime = store.at(first).time;
+    job.segment.lastTime = store.at(last - 1).time;
+    job.segment.textBytes = 0;
+    std::fill(job.segment.counts, job.segment.counts + LogFormats::CATEGORY_COUNT, 0u);
+    job.level = compressionLevel;
+    if (!directory.empty()) {
+        char name[64];
+        snprintf(name, sizeof(name), "/log-%016llx-%06llu.qz", fileId, sequence);
+        job.path = directory + name;
+    }
+    ++sequence;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        ++pending;
+    }
+    LogCompressor::instance().submit(std::move(job));
+}
+
+void LogArchive::compress(const LogStore& store, LogSegment& segment, int level, const std::string& path) {
+    std::string text;
+    std::string index;
+    std::string stamp;
+    time_t stampTime = static_cast<time_t>(-1);
+    for (uint64_t pos = segment.first; pos < segment.last; ++pos) {
+        const DeferredLogEntry& entry = store.at(pos);
+        if (entry.time != stampTime) {
+            stamp.clear();
+            LogStore::formatTime(entry.time, stamp);
+            stampTime = entry.time;
+        }
+        size_t start = text.size();
+        text += stamp;
+        text += " - ";
+        LogFormats::format(entry.format, entry.args.numbers, entry.args.text, text);
+        text += '\n';
+
+        // A message may span lines, so the viewer finds entries by length
+        LogCategory category = LogFormats::categoryOf(entry);
+        uint32_t length = static_cast<uint32_t>(text.size() - start);
+        index += static_cast<char>(category);
+        for (int shift = 0; shift < 32; shift += 8) {
+            index += static_cast<char>((length >> shift) & 0xff);
+        }
+        ++segment.counts[static_cast<int>(category)];
+    }
+    segment.textBytes = text.size();
+    segment.compressed = qCompress(reinterpret_cast<const uchar*>(text.data()), static_cast<int>(text.size()), level);
+    segment.index = qCompress(reinterpret_cast<const uchar*>(index.data()), static_cast<int>(index.size()), level);
+
+    if (!path.empty()) {
+        // Spill to disk; on failure the segment simply stays in memory
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file) {
+            size_t size = static_cast<size_t>(segment.compressed.size());
+            bool written = fwrite(segment.compressed.constData(), 1, size, file) == size;
+            if (fclose(file) == 0 && written) {
+                segment.path = path;
+                segment.compressed.clear();
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    finished.push_back(std::move(segment));
+    --pending;
+    idle.notify_all();
+}
+
+uint64_t LogArchive::collect() {
+    std::lock_guard<std::mutex> guard(lock);
+    uint64_t end = 0;
+    while (!finished.empty()) {
+        end = finished.front().last;
+        memoryBytes += static_cast<size_t>(finished.front().compressed.size() + finished.front().index.size());
+        segments.push_back(std::move(finished.front()));
+        finished.pop_front();
+    }
+    trim();
+    return end;
+}
+
+void LogArchive::trim() {
+    while (memoryLimit > 0 && memoryBytes > memoryLimit && !segments.empty()) {
+        memoryBytes -= static_cast<size_t>(segments.front().compressed.size() + segments.front().index.size());
+        segments.pop_front();
+        ++dropped;
+    }
+}
+
+void LogArchive::waitIdle(size_t backlog) {
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [this, backlog] { return pending <= backlog; });
+}
+
+void LogArchive::clear() {
+    // Spilled files are left on disk
+    waitIdle();
+    std::lock_guard<std::mutex> guard(lock);
+    finished.clear();
+    segments.clear();
+    dropped = 0;
+    memoryBytes = 0;
+    ++clears;
+}
+
+bool LogArchive::packed(const LogSegment& segment, QByteArray& out) {
+    if (segment.path.empty()) {
+        out = segment.compressed;
+        return true;
+    }
+    FILE* file = fopen(segment.path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::string bytes;
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.append(buffer, n);
+    }
+    fclose(file);
+    out = QByteArray(bytes.data(), static_cast<int>(bytes.size()));
+    return true;
+}
+
+bool LogArchive::text(size_t i, std::string& out) const {
+    QByteArray compressed;
+    if (!packed(segments[i], compressed)) {
+        return false;
+    }
+    QByteArray plain = qUncompress(compressed);
+    if (static_cast<size_t>(plain.size()) != segments[i].textBytes) {
+        return false;
+    }
+    out.append(plain.constData(), static_cast<size_t>(plain.size()));
+    return true;
+}
+
+bool LogArchive::unpack(uint64_t number, LogSegmentRows& out) const {
+    LogSegment segment;
+    {
+        // Copy under the lock (the byte arrays are shared, not copied) and
+        // decompress outside it, so the writer is not held up
+        std::lock_guard<std::mutex> guard(lock);
+        if (number < dropped || number - dropped >= segments.size()) {
+            return false;
+        }
+        segment = segments[static_cast<size_t>(number - dropped)];
+    }
+
+    QByteArray compressed;
+    if (!packed(segment, compressed)) {
+        return false;
+    }
+    QByteArray plain = qUncompress(compressed);
+    QByteArray index = qUncompress(segment.index);
+    if (static_cast<size_t>(plain.size()) != segment.textBytes || index.size() % 5 != 0) {
+        return false;
+    }
+
+    out.text.assign(plain.constData(), static_cast<size_t>(plain.size()));
+    out.categories.clear();
+    out.offsets.assign(1, 0);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(index.constData());
+    for (int i = 0; i < index.size(); i += 5) {
+        uint32_t length = bytes[i + 1] | (bytes[i + 2] << 8) | (bytes[i + 3] << 16) | (uint32_t(bytes[i + 4]) << 24);
+        out.categories.push_back(static_cast<LogCategory>(bytes[i]));
+        out.offsets.push_back(out.offsets.back() + length);
+    }
+    return out.offsets.back() == out.text.size();
+}
+
+// Segments are saved with their compressed bytes, even spilled ones, so a
+// restored log does not depend on (or write over) another log's files
+void LogArchive::saveState(SnapshotWriter& out) const {
+    out.write(static_cast<uint64_t>(segments.size()));
+    for (size_t i = 0; i < segments.size(); ++i) {
+        const LogSegment& segment = segments[i];
+        QByteArray compressed;
+        QByteArray index = segment.index;
+        uint64_t textBytes = segment.textBytes;
+        if (!packed(segment, compressed)) {
+            // Lost file: keep the segment as empty text
+            compressed = qCompress(reinterpret_cast<const uchar*>(""), 0, compressionLevel);
+            index = compressed;
+            textBytes = 0;
+        }
+        out.write(static_cast<int64_t>(segment.firstTime));
+        out.write(static_cast<int64_t>(segment.lastTime));
+        out.write(textBytes);
+        out.writeString(std::string(compressed.constData(), static_cast<size_t>(compressed.size())));
+        out.writeString(std::string(index.constData(), static_cast<size_t>(index.size())));
+    }
+}
+
+bool LogArchive::restoreState(SnapshotReader& in) {
+    clear();
+    uint64_t count = 0;
+    in.read(count);
+    for (uint64_t i = 0; i < count && in.isValid(); ++i) {
+        int64_t firstTime = 0;
+        int64_t lastTime = 0;
+        uint64_t textBytes = 0;
+        std::string packed;
+        std::string index;
+        in.read(firstTime);
+        in.read(lastTime);
+        in.read(textBytes);
+        in.readString(packed);
+        in.readString(index);
+
+        LogSegment segment;
+        segment.first = 0;
+        segment.last = 0;
+        segment.firstTime = static_cast<time_t>(firstTime);
+        segment.lastTime = static_cast<time_t>(lastTime);
+        segment.textBytes = static_cast<size_t>(textBytes);
+        segment.compressed = QByteArray(packed.data(), static_cast<int>(packed.size()));
+        segment.index = QByteArray(index.data(), static_cast<int>(index.size()));
+        std::fill(segment.counts, segment.counts + LogFormats::CATEGORY_COUNT, 0u);
+        QByteArray entries = qUncompress(segment.index);
+        for (int e = 0; e + 5 <= entries.size(); e += 5) {
+            unsigned category = static_cast<unsigned char>(entries.constData()[e]);
+            if (category < static_cast<unsigned>(LogFormats::CATEGORY_COUNT)) {
+                ++segment.counts[category];
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        memoryBytes += packed.size() + index.size();
+        segments.push_back(std::move(segment));
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    trim();
+    return in.isValid();
+}
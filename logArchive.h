@@ -0,0 +1,120 @@
+#ifndef LOGARCHIVE_H
+#define LOGARCHIVE_H
+
+#include <QByteArray>
+#include <cstddef>
+#include <cstdint>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "logFormat.h"
+
+class LogStore;
+class SnapshotWriter;
+class SnapshotReader;
+
+// When the live part of a log is sealed into a segment. A limit of 0 is off.
+struct LogRotation {
+    bool enabled = true;
+    size_t maxSegmentEntries = 16384;
+    long long maxSegmentSeconds = 24 * 60 * 60;
+    // Sealed segments are written here and dropped from memory; with no
+    // directory they stay in memory, compressed
+    std::string directory;
+    int compressionLevel = 1;
+    // Compressed bytes kept in memory; past this the oldest segments are
+    // dropped from the archive
+    size_t maxMemoryBytes = 64 * 1024 * 1024;
+};
+
+// One sealed run of log entries, kept as compressed text
+struct LogSegment {
+    uint64_t first;      // store positions [first, last) when sealed
+    uint64_t last;
+    time_t firstTime;
+    time_t lastTime;
+    size_t textBytes;    // uncompressed size
+    QByteArray compressed; // empty once spilled to `path`
+    std::string path;
+    QByteArray index;    // per entry: category byte and 32-bit line length, compressed
+    uint32_t counts[LogFormats::CATEGORY_COUNT]; // entries per category
+};
+
+// One archived segment unpacked for reading single entries
+struct LogSegmentRows {
+    std::string text;
+    std::vector<LogCategory> categories; // per entry
+    std::vector<uint32_t> offsets;       // where each entry's line starts, plus the end
+};
+
+// Sealed segments of one log. Sealing hands a run of store entries to a
+// shared background thread that formats and compresses them; the entries
+// must stay in the store until collect() reports the segment finished.
+class LogArchive {
+    public:
+        LogArchive();
+        ~LogArchive();
+
+        LogArchive(const LogArchive&) = delete;
+        LogArchive& operator=(const LogArchive&) = delete;
+
+        void configure(const LogRotation& rotation);
+
+        // Queue store positions [first, last) for compression
+        void seal(const LogStore& store, uint64_t first, uint64_t last);
+        // Take finished segments in order; returns the store position the
+        // newly archived entries end at, or 0 if none finished
+        uint64_t collect();
+        // Wait until at most `backlog` sealed segments are still uncompressed
+        void waitIdle(size_t backlog = 0);
+        void clear();
+
+        // Segments are numbered from the first one sealed; the oldest are
+        // dropped once memory is over the limit
+        uint64_t firstSegment() const { return dropped; }
+        size_t segmentCount() const { return segments.size(); }
+        const LogSegment& segment(size_t i) const { return segments[i]; }
+        // Decompressed text of segment i, appended to `out`
+        bool text(size_t i, std::string& out) const;
+        // Entries of segment `number` (counted like firstSegment()); unlike
+        // the calls above this may be used off the writer's thread
+        bool unpack(uint64_t number, LogSegmentRows& out) const;
+        // Changes whenever the archive is cleared or restored
+        unsigned long long generation() const { return clears; }
+
+        void saveState(SnapshotWriter& out) const;
+        bool restoreState(SnapshotReader& in);
+
+    private:
+        friend class LogCompressor;
+
+        // Compressed bytes of a segment, from memory or its file
+        static bool packed(const LogSegment& segment, QByteArray& out);
+        // Runs on the compression thread
+        void compress(const LogStore& store, LogSegment& segment, int level, const std::string& path);
+        // Drop the oldest segments until memory is under the limit; caller
+        // holds `lock`
+        void trim();
+
+        // Collected segments; changed only by the log's writer, under `lock`
+        std::deque<LogSegment> segments;
+        uint64_t dropped;            // segments dropped from the front so far
+        size_t memoryBytes;          // compressed bytes held in `segments`
+        std::string directory;
+        int compressionLevel;
+        size_t memoryLimit;
+        unsigned long long fileId;   // keeps spilled file names unique per log
+        unsigned long long sequence;
+        unsigned long long clears;
+
+        // Shared with the compression thread
+        mutable std::mutex lock;
+        std::condition_variable idle;
+        std::deque<LogSegment> finished;
+        size_t pending;
+};
+
+#endif // LOGARCHIVE_H
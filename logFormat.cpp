@@ -0,0 +1,148 @@
+#include "logFormat.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+LogFormatSpec textOnly(const char* pattern) {
+    return {pattern, false, LogFormats::categoryOf(pattern), LogEventCode::PowerOn};
+}
+
+LogFormatSpec withEvent(const char* pattern, LogCategory category, LogEventCode event) {
+    return {pattern, true, category, event};
+}
+
+struct FormatTable {
+    LogFormatSpec specs[static_cast<int>(LogFormat::Count)];
+
+    FormatTable() {
+        set(LogFormat::Text, textOnly("%s"));
+        set(LogFormat::PowerOn, withEvent("Pump powered on.", LogCategory::System, LogEventCode::PowerOn));
+        set(LogFormat::PowerOff, withEvent("Pump powered off.", LogCategory::System, LogEventCode::PowerOff));
+        set(LogFormat::ChargingStarted, withEvent("[System] Charging started", LogCategory::System, LogEventCode::ChargingStarted));
+        set(LogFormat::ChargingStopped, withEvent("[System] Charging stopped", LogCategory::System, LogEventCode::ChargingStopped));
+        set(LogFormat::ChargeNow, textOnly("[System] Please connect charger immediately to prevent shutdown"));
+        set(LogFormat::EmergencyShutdown, withEvent("[System] Emergency shutdown initiated due to critical battery level",
+                                                    LogCategory::System, LogEventCode::EmergencyShutdown));
+        set(LogFormat::CgmAlert, withEvent("[Alert] CGM Alert triggered!", LogCategory::Alert, LogEventCode::CgmAlert));
+        set(LogFormat::OcclusionAlert, withEvent("[Alert] Occlusion Alert triggered! Insulin delivery stopped.",
+                                                 LogCategory::Alert, LogEventCode::OcclusionAlert));
+        set(LogFormat::LowBattery, withEvent("[Alert] Low battery warning: %g%% remaining", LogCategory::Alert, LogEventCode::LowBattery));
+        set(LogFormat::CriticalBattery, withEvent("[Alert] CRITICAL BATTERY WARNING: %g%% remaining",
+                                                  LogCategory::Alert, LogEventCode::CriticalBattery));
+        set(LogFormat::LowInsulin, withEvent("[Alert] Low insulin warning: %d units remaining", LogCategory::Alert, LogEventCode::LowInsulin));
+        set(LogFormat::DeliveryStarted, withEvent("[Pump] Insulin delivery started.", LogCategory::Pump, LogEventCode::DeliveryStarted));
+        set(LogFormat::DeliveryStopped, withEvent("[Pump] Insulin delivery stopped.", LogCategory::Pump, LogEventCode::DeliveryStopped));
+        set(LogFormat::DeliveryResumed, withEvent("[Pump] Insulin delivery resumed.", LogCategory::Pump, LogEventCode::DeliveryResumed));
+        set(LogFormat::BolusRejectedInactive, withEvent("[Bolus] Cannot deliver bolus: insulin delivery not active.",
+                                                        LogCategory::Bolus, LogEventCode::BolusRejected));
+        set(LogFormat::BolusRejectedNoProfile, withEvent("[Bolus] Cannot deliver bolus: no active profile selected.",
+                                                         LogCategory::Bolus, LogEventCode::BolusRejected));
+        set(LogFormat::BolusCalculated, withEvent("[Bolus] Calculated bolus dose: %f units", LogCategory::Bolus, LogEventCode::BolusCalculated));
+        set(LogFormat::BolusConfirmed, withEvent("[Bolus] Bolus delivery confirmed: %f units", LogCategory::Bolus, LogEventCode::BolusConfirmed));
+        set(LogFormat::ExtendedBolusRejected, withEvent("[Bolus] Cannot deliver extended bolus: insulin delivery not active or no profile selected.",
+                                                        LogCategory::Bolus, LogEventCode::BolusRejected));
+        set(LogFormat::ExtendedBolusStarted, withEvent("[Bolus] Extended bolus started for %d minutes",
+                                                       LogCategory::Bolus, LogEventCode::ExtendedBolusStarted));
+        set(LogFormat::QuickBolusRejected, withEvent("[Bolus] Cannot deliver quick bolus: insulin delivery not active or no profile selected.",
+                                                     LogCategory::Bolus, LogEventCode::BolusRejected));
+        set(LogFormat::QuickBolusDelivered, withEvent("[Bolus] Quick bolus delivered", LogCategory::Bolus, LogEventCode::QuickBolusDelivered));
+        set(LogFormat::PauseNoBolus, textOnly("[Bolus] No active bolus to pause."));
+        set(LogFormat::BolusPaused, withEvent("[Bolus] Bolus delivery paused.", LogCategory::Bolus, LogEventCode::BolusPaused));
+        set(LogFormat::BolusAlreadyPaused, textOnly("[Bolus] Bolus is already paused."));
+        set(LogFormat::PauseCanceled, textOnly("[Bolus] Cannot pause: Bolus has been canceled."));
+        set(LogFormat::ResumeNoBolus, textOnly("[Bolus] No bolus to resume."));
+        set(LogFormat::ResumeInactive, textOnly("[Bolus] Cannot resume bolus: insulin delivery not active."));
+        set(LogFormat::BolusResumed, withEvent("[Bolus] Bolus delivery resumed.", LogCategory::Bolus, LogEventCode::BolusResumed));
+        set(LogFormat::BolusAlreadyActive, textOnly("[Bolus] Bolus is already active."));
+        set(LogFormat::ResumeCanceled, textOnly("[Bolus] Cannot resume: Bolus has been canceled."));
+        set(LogFormat::CancelNoBolus, textOnly("[Bolus] No active bolus to cancel."));
+        set(LogFormat::BolusCanceled, withEvent("[Bolus] Bolus delivery canceled.", LogCategory::Bolus, LogEventCode::BolusCanceled));
+        set(LogFormat::BolusAlreadyCanceled, textOnly("[Bolus] Bolus is already canceled."));
+        set(LogFormat::ProfileCreated, withEvent("[Profile] Created new profile: %s", LogCategory::Profile, LogEventCode::ProfileCreated));
+        set(LogFormat::ProfileSwitched, withEvent("[Profile] Switched to profile: %s", LogCategory::Profile, LogEventCode::ProfileSwitched));
+        set(LogFormat::ProfileSwitchFailed, withEvent("[Profile] Failed to switch to profile: %s",
+                                                      LogCategory::Profile, LogEventCode::ProfileSwitchFailed));
+        set(LogFormat::ControllerEnabled, withEvent("[Controller] Closed loop enabled: %s",
+                                                    LogCategory::Controller, LogEventCode::ControllerEnabled));
+        set(LogFormat::ControllerDisabled, withEvent("[Controller] Closed loop disabled.",
+                                                     LogCategory::Controller, LogEventCode::ControllerDisabled));
+        set(LogFormat::ControllerCorrection, withEvent("[Controller] Automatic correction: %f units",
+                                                       LogCategory::Controller, LogEventCode::ControllerCorrection));
+    }
+
+    void set(LogFormat format, const LogFormatSpec& spec) {
+        specs[static_cast<int>(format)] = spec;
+    }
+};
+
+const FormatTable& table() {
+    static const FormatTable instance;
+    return instance;
+}
+
+}
+
+const LogFormatSpec& LogFormats::spec(LogFormat format) {
+    return table().specs[static_cast<int>(format)];
+}
+
+LogCategory LogFormats::categoryOf(const char* text) {
+    static const struct {
+        const char* prefix;
+        LogCategory category;
+    } prefixes[] = {
+        {"[Alert]", LogCategory::Alert},
+        {"[Bolus]", LogCategory::Bolus},
+        {"[Pump]", LogCategory::Pump},
+        {"[Profile]", LogCategory::Profile},
+        {"[Controller]", LogCategory::Controller},
+    };
+    if (text[0] == '[') {
+        for (const auto& p : prefixes) {
+            if (std::strncmp(text, p.prefix, std::strlen(p.prefix)) == 0) {
+                return p.category;
+            }
+        }
+    }
+    return LogCategory::System;
+}
+
+LogCategory LogFormats::categoryOf(const DeferredLogEntry& entry) {
+    return entry.format == LogFormat::Text ? categoryOf(entry.args.text.c_str()) : spec(entry.format).category;
+}
+
+void LogFormats::format(LogFormat format, const double* numbers, const std::string& text, std::string& out) {
+    const char* p = spec(format).pattern;
+    int next = 0;
+    char buffer[64];
+
+    for (; *p; ++p) {
+        if (*p != '%' || p[1] == '\0') {
+            out += *p;
+            continue;
+        }
+        ++p;
+        double value = (*p != 's' && *p != '%' && next < MAX_NUMBERS) ? numbers[next++] : 0.0;
+        switch (*p) {
+        case 'f':
+            snprintf(buffer, sizeof(buffer), "%f", value);
+            out += buffer;
+            break;
+        case 'g':
+            snprintf(buffer, sizeof(buffer), "%g", value);
+            out += buffer;
+            break;
+        case 'd':
+            snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+            out += buffer;
+            break;
+        case 's':
+            out += text;
+            break;
+        default:
+            out += *p;
+            break;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef LOGFORMAT_H
+#define LOGFORMAT_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include "eventLog.h"
+
+// Every message the pump logs. A log call stores only this id and its raw
+// arguments; the text is produced from the pattern when the log is read.
+enum class LogFormat : uint16_t {
+    Text,                   // free text, stored as given
+    PowerOn,
+    PowerOff,
+    ChargingStarted,
+    ChargingStopped,
+    ChargeNow,
+    EmergencyShutdown,
+    CgmAlert,
+    OcclusionAlert,
+    LowBattery,
+    CriticalBattery,
+    LowInsulin,
+    DeliveryStarted,
+    DeliveryStopped,
+    DeliveryResumed,
+    BolusRejectedInactive,
+    BolusRejectedNoProfile,
+    BolusCalculated,
+    BolusConfirmed,
+    ExtendedBolusRejected,
+    ExtendedBolusStarted,
+    QuickBolusRejected,
+    QuickBolusDelivered,
+    PauseNoBolus,
+    BolusPaused,
+    BolusAlreadyPaused,
+    PauseCanceled,
+    ResumeNoBolus,
+    ResumeInactive,
+    BolusResumed,
+    BolusAlreadyActive,
+    ResumeCanceled,
+    CancelNoBolus,
+    BolusCanceled,
+    BolusAlreadyCanceled,
+    ProfileCreated,
+    ProfileSwitched,
+    ProfileSwitchFailed,
+    ControllerEnabled,
+    ControllerDisabled,
+    ControllerCorrection,
+    Count
+};
+
+// Pattern placeholders take the arguments in order: %f prints a number like
+// std::to_string, %g like QString::arg, %d as an integer, %s the text
+// argument; %% is a literal percent sign. Every format has a category (from
+// its [Tag]); formats that correspond to a typed event also go to the binary
+// event log, with the first number as its value.
+struct LogFormatSpec {
+    const char* pattern;
+    bool hasEvent;
+    LogCategory category;
+    LogEventCode event;
+};
+
+struct DeferredLogEntry;
+
+namespace LogFormats {
+    const int MAX_NUMBERS = 3;
+    const int CATEGORY_COUNT = static_cast<int>(LogCategory::Controller) + 1;
+
+    // Indexed by LogFormat
+    const LogFormatSpec& spec(LogFormat format);
+
+    // Category from a "[Tag] ..." prefix; untagged text is System
+    LogCategory categoryOf(const char* text);
+    LogCategory categoryOf(const DeferredLogEntry& entry);
+
+    // Append the message text (without timestamp) to `out`
+    void format(LogFormat format, const double* numbers, const std::string& text, std::string& out);
+}
+
+// Raw arguments captured by a log call: up to MAX_NUMBERS numbers and one string
+struct LogArgs {
+    double numbers[LogFormats::MAX_NUMBERS] = {0.0, 0.0, 0.0};
+    int count = 0;
+    std::string text;
+
+    LogArgs() {}
+
+    template <class... Args>
+    explicit LogArgs(const Args&... args) {
+        int unused[] = {0, (add(args), 0)...};
+        (void)unused;
+    }
+
+    void add(const std::string& s) { text = s; }
+    void add(const char* s) { text = s; }
+    template <class T>
+    void add(T value) {
+        if (count < LogFormats::MAX_NUMBERS) {
+            numbers[count++] = static_cast<double>(value);
+        }
+    }
+};
+
+// One log call as stored until it is read
+struct DeferredLogEntry {
+    time_t time = 0;
+    LogFormat format = LogFormat::Text;
+    LogArgs args;
+};
+
+#endif // LOGFORMAT_H
@@ -0,0 +1,88 @@
+#include "logRingBuffer.h"
+#include <cstring>
+
+LogRingBuffer::LogRingBuffer(size_t capacity) : enqueuePos(0), dequeuePos(0) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    mask = size - 1;
+
+    cells.reset(new Cell[size]);
+    for (size_t i = 0; i < size; ++i) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+        cells[i].record.overflow = nullptr;
+    }
+}
+
+LogRingBuffer::~LogRingBuffer() {
+    // Free heap text of anything never consumed
+    DeferredLogEntry entry;
+    while (tryPop(entry)) {
+    }
+}
+
+bool LogRingBuffer::tryPush(time_t timestamp, LogFormat format, const LogArgs& args) {
+    Cell* cell;
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &cells[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            // Slot is free for this lap; claim it
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // the consumer has not freed this slot yet
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    Record& record = cell->record;
+    const std::string& text = args.text;
+    record.timestamp = timestamp;
+    record.format = format;
+    std::memcpy(record.numbers, args.numbers, sizeof(record.numbers));
+    if (text.size() <= INLINE_TEXT) {
+        record.length = static_cast<uint32_t>(text.size());
+        std::memcpy(record.text, text.data(), text.size());
+        record.overflow = nullptr;
+    } else {
+        record.length = 0;
+        record.overflow = new std::string(text);
+    }
+
+    // Publish to the consumer
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool LogRingBuffer::tryPop(DeferredLogEntry& entry) {
+    Cell* cell = &cells[dequeuePos & mask];
+    size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    if (sequence != dequeuePos + 1) {
+        return false; // empty, or the producer has not finished writing
+    }
+
+    Record& record = cell->record;
+    std::string& text = entry.args.text;
+    entry.time = record.timestamp;
+    entry.format = record.format;
+    std::memcpy(entry.args.numbers, record.numbers, sizeof(record.numbers));
+    entry.args.count = LogFormats::MAX_NUMBERS;
+    if (record.overflow) {
+        text.swap(*record.overflow);
+        delete record.overflow;
+        record.overflow = nullptr;
+    } else {
+        text.assign(record.text, record.length);
+    }
+
+    // Hand the slot back to producers for the next lap
+    cell->sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+    ++dequeuePos;
+    return true;
+}
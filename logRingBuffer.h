@@ -0,0 +1,59 @@
+#ifndef LOGRINGBUFFER_H
+#define LOGRINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include "logFormat.h"
+
+// Bounded lock-free multi-producer, single-consumer queue of log records.
+// Every slot carries a sequence number (Vyukov's bounded queue): producers
+// claim a slot with one CAS on the enqueue position and publish it by
+// bumping the slot's sequence, so they never wait on each other or on the
+// consumer. Records are fixed size and hold a log call's format id and raw
+// arguments; the rare text argument that does not fit inline is moved to
+// the heap and freed by the consumer.
+class LogRingBuffer {
+    public:
+        explicit LogRingBuffer(size_t capacity = 4096); // rounded up to a power of two
+        ~LogRingBuffer();
+
+        LogRingBuffer(const LogRingBuffer&) = delete;
+        LogRingBuffer& operator=(const LogRingBuffer&) = delete;
+
+        // Any thread. Returns false without side effects when the buffer is full.
+        bool tryPush(time_t timestamp, LogFormat format, const LogArgs& args);
+        // Consumer thread only
+        bool tryPop(DeferredLogEntry& entry);
+
+        size_t getCapacity() const { return mask + 1; }
+
+        static const size_t INLINE_TEXT = 200; // with the sequence, a slot is four cache lines
+
+    private:
+        struct Record {
+            time_t timestamp;
+            std::string* overflow; // owned by the record when the text is too long
+            double numbers[LogFormats::MAX_NUMBERS];
+            uint32_t length;
+            LogFormat format;
+            char text[INLINE_TEXT];
+        };
+
+        struct alignas(64) Cell {
+            std::atomic<size_t> sequence;
+            Record record;
+        };
+
+        std::unique_ptr<Cell[]> cells;
+        size_t mask;
+
+        // Producers and the consumer work on separate cache lines
+        alignas(64) std::atomic<size_t> enqueuePos;
+        alignas(64) size_t dequeuePos;
+};
+
+#endif // LOGRINGBUFFER_H
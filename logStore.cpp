@@ -0,0 +1,163 @@
+#include "logStore.h"
+#include <cstdio>
+
+const DeferredLogEntry& LogView::operator[](size_t i) const {
+    return store->at(position(i));
+}
+
+uint64_t LogView::position(size_t i) const {
+    return index ? (*index)[from + i] : from + i;
+}
+
+bool LogView::isStored(size_t i) const {
+    if (index && from + i < index->begin()) {
+        return false;
+    }
+    return position(i) >= store->begin();
+}
+
+std::string LogView::text(size_t i) const {
+    std::string out;
+    LogStore::formatEntry((*this)[i], out);
+    return out;
+}
+
+LogStore::LogStore() : latest(0) {}
+
+void LogStore::append(const DeferredLogEntry& entry) {
+    // Keep times monotonic so range lookups can binary search
+    DeferredLogEntry clamped = entry;
+    if (clamped.time < latest) {
+        clamped.time = latest;
+    }
+    restore(clamped);
+}
+
+void LogStore::restore(const DeferredLogEntry& entry) {
+    uint64_t position = entries.end();
+    DeferredLogEntry& slot = entries.append();
+    slot = entry;
+    if (slot.time > latest) {
+        latest = slot.time;
+    }
+    entries.publish();
+
+    ChunkedRing<uint64_t>& index = byCategory[static_cast<int>(LogFormats::categoryOf(entry))];
+    index.append() = position;
+    index.publish();
+}
+
+void LogStore::clear() {
+    latest = 0;
+    entries.clear();
+    for (auto& index : byCategory) {
+        index.clear();
+    }
+}
+
+void LogStore::dropBefore(uint64_t position) {
+    entries.dropBefore(position);
+    for (auto& index : byCategory) {
+        index.dropBefore(firstLive(index));
+    }
+}
+
+void LogStore::formatTime(time_t when, std::string& out) {
+    // Entries are also formatted off the writer thread, so no shared localtime() buffer
+    tm localTime;
+#ifdef _WIN32
+    localtime_s(&localTime, &when);
+#else
+    localtime_r(&when, &localTime);
+#endif
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "[%02d:%02d:%02d]", localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+    out += buffer;
+}
+
+void LogStore::formatEntry(const DeferredLogEntry& entry, std::string& out) {
+    formatTime(entry.time, out);
+    out += " - ";
+    LogFormats::format(entry.format, entry.args.numbers, entry.args.text, out);
+}
+
+LogView LogStore::all() const {
+    return LogView(this, nullptr, entries.begin(), entries.end());
+}
+
+LogView LogStore::last(size_t count) const {
+    uint64_t end = entries.end();
+    uint64_t begin = entries.begin();
+    return LogView(this, nullptr, (end - begin > count) ? end - count : begin, end);
+}
+
+LogView LogStore::between(time_t from, time_t to) const {
+    uint64_t lo = lowerBound(from);
+    uint64_t hi = lowerBound(to);
+    return LogView(this, nullptr, lo, hi < lo ? lo : hi);
+}
+
+LogView LogStore::category(LogCategory c) const {
+    const ChunkedRing<uint64_t>& index = byCategory[static_cast<int>(c)];
+    return LogView(this, &index, firstLive(index), index.end());
+}
+
+LogView LogStore::category(LogCategory c, time_t from, time_t to) const {
+    const ChunkedRing<uint64_t>& index = byCategory[static_cast<int>(c)];
+    uint64_t begin = firstLive(index);
+    uint64_t end = index.end();
+    uint64_t lo = lowerBound(index, begin, end, from);
+    uint64_t hi = lowerBound(index, lo, end, to);
+    return LogView(this, &index, lo, hi);
+}
+
+LogView LogStore::lastOf(LogCategory c, size_t count) const {
+    const ChunkedRing<uint64_t>& index = byCategory[static_cast<int>(c)];
+    uint64_t begin = firstLive(index);
+    uint64_t end = index.end();
+    return LogView(this, &index, (end - begin > count) ? end - count : begin, end);
+}
+
+// First entry position with time >= t
+uint64_t LogStore::lowerBound(time_t t) const {
+    uint64_t lo = entries.begin();
+    uint64_t hi = entries.end();
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (entries[mid].time < t) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// First index position in [lo, hi) whose entry has time >= t
+uint64_t LogStore::lowerBound(const ChunkedRing<uint64_t>& index, uint64_t lo, uint64_t hi, time_t t) const {
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (entries[index[mid]].time < t) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// First index position that still refers to a live entry
+uint64_t LogStore::firstLive(const ChunkedRing<uint64_t>& index) const {
+    uint64_t oldest = entries.begin();
+    uint64_t lo = index.begin();
+    uint64_t hi = index.end();
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (index[mid] < oldest) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
@@ -0,0 +1,208 @@
+#ifndef LOGSTORE_H
+#define LOGSTORE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include "logFormat.h"
+
+// Append-only ring of values addressed by absolute position. Storage is a
+// two-level table of fixed blocks that never move once allocated, so one
+// writer can keep appending while readers access earlier positions without
+// a lock. When the ring is full the oldest block is recycled. Blocks that
+// fall wholly behind the front are freed on the next drop, not this one, so
+// a reader that saw a position live can still finish reading it.
+template <class T>
+class ChunkedRing {
+    public:
+        static const unsigned LEAF_BITS = 10;
+        static const unsigned MID_BITS = 7;
+        static const unsigned TOP_BITS = 7;
+        static const uint64_t LEAF_SIZE = uint64_t(1) << LEAF_BITS;
+        static const uint64_t CAPACITY = uint64_t(1) << (LEAF_BITS + MID_BITS + TOP_BITS);
+
+        ChunkedRing() : first(0), last(0), released(0) {
+            for (auto& mid : top) {
+                mid.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        ~ChunkedRing() {
+            for (auto& midSlot : top) {
+                std::atomic<T*>* mid = midSlot.load(std::memory_order_relaxed);
+                if (!mid) {
+                    continue;
+                }
+                for (uint64_t i = 0; i < (uint64_t(1) << MID_BITS); ++i) {
+                    delete[] mid[i].load(std::memory_order_relaxed);
+                }
+                delete[] mid;
+            }
+        }
+
+        ChunkedRing(const ChunkedRing&) = delete;
+        ChunkedRing& operator=(const ChunkedRing&) = delete;
+
+        // Live positions are [begin(), end())
+        uint64_t begin() const { return first.load(std::memory_order_acquire); }
+        uint64_t end() const { return last.load(std::memory_order_acquire); }
+        uint64_t size() const { return end() - begin(); }
+
+        const T& operator[](uint64_t pos) const {
+            uint64_t slot = pos & (CAPACITY - 1);
+            std::atomic<T*>* mid = top[slot >> (LEAF_BITS + MID_BITS)].load(std::memory_order_acquire);
+            T* leaf = mid[(slot >> LEAF_BITS) & ((uint64_t(1) << MID_BITS) - 1)].load(std::memory_order_acquire);
+            return leaf[slot & (LEAF_SIZE - 1)];
+        }
+
+        // Writer only
+        T& append() {
+            uint64_t pos = last.load(std::memory_order_relaxed);
+            if (pos - first.load(std::memory_order_relaxed) == CAPACITY) {
+                // Full: give up the oldest block, whose storage is reused
+                first.store(first.load(std::memory_order_relaxed) + LEAF_SIZE, std::memory_order_release);
+                released = std::max(released, first.load(std::memory_order_relaxed));
+            }
+            return leafFor(pos)[pos & (LEAF_SIZE - 1)];
+        }
+        void publish() { last.store(last.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+        // Drop everything before `pos` (writer only)
+        void dropBefore(uint64_t pos) {
+            uint64_t front = first.load(std::memory_order_relaxed);
+            if (pos > front && pos <= last.load(std::memory_order_relaxed)) {
+                releaseBefore(front);
+                first.store(pos, std::memory_order_release);
+            }
+        }
+        void clear() {
+            releaseBefore(first.load(std::memory_order_relaxed));
+            first.store(last.load(std::memory_order_relaxed), std::memory_order_release);
+        }
+
+    private:
+        // Free the blocks wholly before `pos`, unless a live position has
+        // wrapped onto their storage
+        void releaseBefore(uint64_t pos) {
+            uint64_t end = last.load(std::memory_order_relaxed);
+            for (uint64_t block = released & ~(LEAF_SIZE - 1); block + LEAF_SIZE <= pos; block += LEAF_SIZE) {
+                uint64_t slot = block & (CAPACITY - 1);
+                std::atomic<T*>* mid = top[slot >> (LEAF_BITS + MID_BITS)].load(std::memory_order_relaxed);
+                if (!mid || block + CAPACITY < end) {
+                    continue;
+                }
+                std::atomic<T*>& leafSlot = mid[(slot >> LEAF_BITS) & ((uint64_t(1) << MID_BITS) - 1)];
+                delete[] leafSlot.load(std::memory_order_relaxed);
+                leafSlot.store(nullptr, std::memory_order_release);
+            }
+            released = std::max(released, pos & ~(LEAF_SIZE - 1));
+        }
+
+        T* leafFor(uint64_t pos) {
+            uint64_t slot = pos & (CAPACITY - 1);
+            std::atomic<T*>* mid = top[slot >> (LEAF_BITS + MID_BITS)].load(std::memory_order_relaxed);
+            if (!mid) {
+                mid = new std::atomic<T*>[uint64_t(1) << MID_BITS];
+                for (uint64_t i = 0; i < (uint64_t(1) << MID_BITS); ++i) {
+                    mid[i].store(nullptr, std::memory_order_relaxed);
+                }
+                top[slot >> (LEAF_BITS + MID_BITS)].store(mid, std::memory_order_release);
+            }
+            std::atomic<T*>& leafSlot = mid[(slot >> LEAF_BITS) & ((uint64_t(1) << MID_BITS) - 1)];
+            T* leaf = leafSlot.load(std::memory_order_relaxed);
+            if (!leaf) {
+                leaf = new T[LEAF_SIZE];
+                leafSlot.store(leaf, std::memory_order_release);
+            }
+            return leaf;
+        }
+
+        std::atomic<std::atomic<T*>*> top[uint64_t(1) << TOP_BITS];
+        std::atomic<uint64_t> first;
+        std::atomic<uint64_t> last;
+        uint64_t released;  // blocks before this have been freed or recycled; writer only
+};
+
+class LogStore;
+
+// A read-only range of log entries: either a contiguous run of the store,
+// or a run of one category's index. Views refer to entries in place and
+// stay valid while the log grows, until those entries are cleared or
+// rotated out.
+class LogView {
+    public:
+        LogView() : store(nullptr), index(nullptr), from(0), to(0) {}
+        LogView(const LogStore* store, const ChunkedRing<uint64_t>* index, uint64_t from, uint64_t to)
+            : store(store), index(index), from(from), to(to) {}
+
+        size_t size() const { return static_cast<size_t>(to - from); }
+        bool empty() const { return from == to; }
+
+        const DeferredLogEntry& operator[](size_t i) const;
+        // Store position of the i-th entry
+        uint64_t position(size_t i) const;
+        // Whether the i-th entry is still in the store; a view kept while the
+        // log grows can outlive entries rotated out since
+        bool isStored(size_t i) const;
+        // "[HH:MM:SS] - message" text of the i-th entry
+        std::string text(size_t i) const;
+
+        // Bounds in the store or index, and another range of the same
+        uint64_t first() const { return from; }
+        uint64_t last() const { return to; }
+        LogView range(uint64_t first, uint64_t last) const { return LogView(store, index, first, last); }
+
+    private:
+        const LogStore* store;
+        const ChunkedRing<uint64_t>* index; // null for a contiguous run
+        uint64_t from;
+        uint64_t to;
+};
+
+// Log entries plus a per-category index of their positions. Entry times
+// never decrease (later entries are clamped to the latest time), so every
+// time-range lookup is a binary search over the entries or over one
+// category's index.
+class LogStore {
+    public:
+        LogStore();
+
+        // Writer only
+        void append(const DeferredLogEntry& entry);
+        // Append a saved entry with its own time; saved entries are already
+        // in order, so they are not clamped to what was logged before
+        void restore(const DeferredLogEntry& entry);
+        // Drop every entry and forget the latest time
+        void clear();
+        void dropBefore(uint64_t position);
+
+        uint64_t begin() const { return entries.begin(); }
+        uint64_t end() const { return entries.end(); }
+        const DeferredLogEntry& at(uint64_t position) const { return entries[position]; }
+
+        LogView all() const;
+        LogView between(time_t from, time_t to) const; // [from, to)
+        LogView category(LogCategory c) const;
+        LogView category(LogCategory c, time_t from, time_t to) const;
+        LogView lastOf(LogCategory c, size_t count) const;
+        LogView last(size_t count) const;
+
+        // "[HH:MM:SS]" and "[HH:MM:SS] - message", appended to `out`
+        static void formatTime(time_t when, std::string& out);
+        static void formatEntry(const DeferredLogEntry& entry, std::string& out);
+
+    private:
+        uint64_t lowerBound(time_t t) const;
+        uint64_t lowerBound(const ChunkedRing<uint64_t>& index, uint64_t lo, uint64_t hi, time_t t) const;
+        uint64_t firstLive(const ChunkedRing<uint64_t>& index) const;
+
+        ChunkedRing<DeferredLogEntry> entries;
+        ChunkedRing<uint64_t> byCategory[LogFormats::CATEGORY_COUNT];
+        time_t latest;
+};
+
+#endif // LOGSTORE_H
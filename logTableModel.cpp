@@ -0,0 +1,219 @@
+#include "logTableModel.h"
+#include <algorithm>
+
+LogTableModel::LogTableModel(const Log* log, QObject *parent)
+    : QAbstractTableModel(parent), log(log), filter(ALL_CATEGORIES), rows(0) {
+    setHistory(currentHistory());
+    rows = static_cast<int>(archivedRowCount() + history.live.size());
+}
+
+const char* LogTableModel::categoryName(LogCategory category) {
+    switch (category) {
+    case LogCategory::System: return "System";
+    case LogCategory::Pump: return "Pump";
+    case LogCategory::Bolus: return "Bolus";
+    case LogCategory::Alert: return "Alert";
+    case LogCategory::Profile: return "Profile";
+    case LogCategory::Controller: return "Controller";
+    }
+    return "";
+}
+
+LogHistory LogTableModel::currentHistory() const {
+    return filter == ALL_CATEGORIES ? log->getHistory() : log->getHistory(static_cast<LogCategory>(filter));
+}
+
+void LogTableModel::setHistory(LogHistory&& next) {
+    history = std::move(next);
+    archivedEnd.resize(history.segmentRows.size());
+    uint64_t total = 0;
+    for (size_t i = 0; i < history.segmentRows.size(); ++i) {
+        total += history.segmentRows[i];
+        archivedEnd[i] = total;
+    }
+}
+
+const LogTableModel::CachedSegment* LogTableModel::cachedSegment(uint64_t number) const {
+    for (auto it = cache.begin(); it != cache.end(); ++it) {
+        if (it->number == number) {
+            if (it != cache.begin()) {
+                CachedSegment used = std::move(*it);
+                cache.erase(it);
+                cache.push_front(std::move(used));
+            }
+            return &cache.front();
+        }
+    }
+
+    CachedSegment segment;
+    segment.number = number;
+    if (!log->getArchive().unpack(number, segment.rows)) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < segment.rows.categories.size(); ++i) {
+        if (filter == ALL_CATEGORIES || static_cast<int>(segment.rows.categories[i]) == filter) {
+            segment.shown.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    cache.push_front(std::move(segment));
+    if (cache.size() > CACHED_SEGMENTS) {
+        cache.pop_back();
+    }
+    return &cache.front();
+}
+
+bool LogTableModel::archivedRow(uint64_t row, std::string& time, LogCategory& category, std::string& message) const {
+    size_t i = static_cast<size_t>(std::upper_bound(archivedEnd.begin(), archivedEnd.end(), row) - archivedEnd.begin());
+    const CachedSegment* segment = cachedSegment(history.firstSegment + i);
+    uint64_t local = row - (i > 0 ? archivedEnd[i - 1] : 0);
+    if (!segment || local >= segment->shown.size()) {
+        return false;
+    }
+
+    // Each entry is "[time] - message\n"
+    uint32_t entry = segment->shown[static_cast<size_t>(local)];
+    const std::string& text = segment->rows.text;
+    size_t start = segment->rows.offsets[entry];
+    size_t end = segment->rows.offsets[entry + 1] - 1;
+    size_t separator = text.find(" - ", start);
+    if (separator == std::string::npos || separator >= end || separator < start + 2) {
+        return false;
+    }
+    time.assign(text, start + 1, separator - start - 2);
+    message.assign(text, separator + 3, end - separator - 3);
+    category = segment->rows.categories[entry];
+    return true;
+}
+
+int LogTableModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : rows;
+}
+
+int LogTableModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant LogTableModel::data(const QModelIndex& index, int role) const {
+    if (role != Qt::DisplayRole || !index.isValid() || index.row() >= rows) {
+        return QVariant();
+    }
+
+    uint64_t row = static_cast<uint64_t>(index.row());
+    uint64_t archived = archivedRowCount();
+    if (row < archived) {
+        std::string time;
+        std::string message;
+        LogCategory category;
+        if (!archivedRow(row, time, category, message)) {
+            return QVariant();
+        }
+        switch (index.column()) {
+        case TimeColumn: return QString::fromStdString(time);
+        case CategoryColumn: return QString(categoryName(category));
+        case MessageColumn: return QString::fromStdString(message);
+        }
+        return QVariant();
+    }
+
+    // Only the rows on screen are ever formatted. A row sealed into the
+    // archive since the last refresh is shown again after the next one.
+    size_t live = static_cast<size_t>(row - archived);
+    if (live >= history.live.size() || !history.live.isStored(live)) {
+        return QVariant();
+    }
+    const DeferredLogEntry& entry = history.live[live];
+    std::string text;
+    switch (index.column()) {
+    case TimeColumn:
+        LogStore::formatTime(entry.time, text);
+        return QString::fromStdString(text.substr(1, text.size() - 2));
+    case CategoryColumn:
+        return QString(categoryName(LogFormats::categoryOf(entry)));
+    case MessageColumn:
+        LogFormats::format(entry.format, entry.args.numbers, entry.args.text, text);
+        return QString::fromStdString(text);
+    }
+    return QVariant();
+}
+
+QVariant LogTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) {
+        return QVariant();
+    }
+    switch (section) {
+    case TimeColumn: return QString("Time");
+    case CategoryColumn: return QString("Category");
+    case MessageColumn: return QString("Message");
+    }
+    return QVariant();
+}
+
+void LogTableModel::setCategoryFilter(int category) {
+    if (category == filter) {
+        return;
+    }
+    beginResetModel();
+    filter = category;
+    cache.clear();
+    setHistory(currentHistory());
+    rows = static_cast<int>(archivedRowCount() + history.live.size());
+    endResetModel();
+}
+
+void LogTableModel::refresh() {
+    LogHistory next = currentHistory();
+    const LogView& view = history.live;
+    bool reset = next.generation != history.generation || next.firstSegment < history.firstSegment
+            || next.firstSegment - history.firstSegment > archivedEnd.size() || next.live.first() < view.first();
+
+    // Rows are only ever dropped from the front (whole segments by the
+    // archive, or live entries the store overwrote without archiving) and
+    // appended at the back; in between, live rows move into the archive
+    // without changing their row number
+    uint64_t archived = archivedRowCount();
+    size_t droppedSegments = reset ? 0 : static_cast<size_t>(next.firstSegment - history.firstSegment);
+    uint64_t droppedArchived = droppedSegments > 0 ? archivedEnd[droppedSegments - 1] : 0;
+    uint64_t nextArchived = 0;
+    for (uint32_t count : next.segmentRows) {
+        nextArchived += count;
+    }
+    uint64_t leftStore = reset ? 0 : std::min(next.live.first(), view.last()) - view.first();
+    uint64_t moved = 0;
+    uint64_t total = nextArchived + next.live.size();
+    if (!reset && nextArchived + droppedArchived >= archived) {
+        moved = std::min(nextArchived + droppedArchived - archived, leftStore);
+    } else {
+        reset = true;
+    }
+    uint64_t dropped = droppedArchived + leftStore - moved;
+    uint64_t kept = static_cast<uint64_t>(rows) - std::min<uint64_t>(dropped, rows);
+    if (reset || dropped > static_cast<uint64_t>(rows) || total < kept) {
+        beginResetModel();
+        cache.clear();
+        setHistory(std::move(next));
+        rows = static_cast<int>(total);
+        endResetModel();
+        return;
+    }
+
+    if (dropped > 0) {
+        beginRemoveRows(QModelIndex(), 0, static_cast<int>(dropped) - 1);
+        setHistory(std::move(next));
+        rows = static_cast<int>(kept);
+        endRemoveRows();
+    } else {
+        setHistory(std::move(next));
+    }
+
+    if (total > kept) {
+        beginInsertRows(QModelIndex(), static_cast<int>(kept), static_cast<int>(total) - 1);
+        rows = static_cast<int>(total);
+        endInsertRows();
+    }
+
+    // Rows now read from the archive may have been blank while in between
+    if (moved > 0) {
+        int first = static_cast<int>(archived - droppedArchived);
+        emit dataChanged(index(first, 0), index(first + static_cast<int>(moved) - 1, ColumnCount - 1));
+    }
+}
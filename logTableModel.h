@@ -0,0 +1,63 @@
+#ifndef LOGTABLEMODEL_H
+#define LOGTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <deque>
+#include "log.h"
+
+// Table over the whole log for a QTableView: archived segments first, then
+// the live store. Live rows refer to stored entries in place (optionally one
+// category's index) and archived rows are read from their segment, which is
+// only decompressed when the view asks for one of its rows, so row count
+// does not affect scrolling. Rows leave the front only when the archive
+// drops its oldest segments.
+class LogTableModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    enum Column {TimeColumn, CategoryColumn, MessageColumn, ColumnCount};
+
+    explicit LogTableModel(const Log* log, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    // Show one category, or everything with ALL_CATEGORIES
+    void setCategoryFilter(int category);
+    int getCategoryFilter() const { return filter; }
+
+    static const int ALL_CATEGORIES = -1;
+    static const char* categoryName(LogCategory category);
+
+public slots:
+    // Pick up entries appended or rotated out since the last refresh
+    void refresh();
+
+private:
+    // A decompressed segment, with the entries the filter shows
+    struct CachedSegment {
+        uint64_t number;
+        LogSegmentRows rows;
+        std::vector<uint32_t> shown;
+    };
+
+    LogHistory currentHistory() const;
+    // Take a new history; rows are recounted by the caller
+    void setHistory(LogHistory&& next);
+    uint64_t archivedRowCount() const { return archivedEnd.empty() ? 0 : archivedEnd.back(); }
+    const CachedSegment* cachedSegment(uint64_t number) const;
+    // Time, category and message of a row; false if it is gone
+    bool archivedRow(uint64_t row, std::string& time, LogCategory& category, std::string& message) const;
+
+    const Log* log;
+    int filter;
+    LogHistory history;
+    std::vector<uint64_t> archivedEnd; // running total of history.segmentRows
+    int rows;                          // as last reported to the view
+
+    static const size_t CACHED_SEGMENTS = 4;
+    mutable std::deque<CachedSegment> cache; // most recently used first
+};
+
+#endif // LOGTABLEMODEL_H
@@ -1,16 +1,34 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include <QDir>
+#include <QMessageBox>
+#include <QStandardPaths>
 
-MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), pump(nullptr), ui(new Ui::MainWindow) {
+MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), pump(nullptr), engine(nullptr), pacer(nullptr), ui(new Ui::MainWindow) {
    ui->setupUi(this);
 
    ProfileManager* pm = new ProfileManager();
+   // Profiles persist between launches
+   QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+   QDir().mkpath(dataDir);
+   string storeError;
+   if (!pm->openStore((dataDir + "/profiles.db").toStdString(), storeError)) {
+       // Profiles still work, but only for this session
+       QMessageBox::warning(this, "Profile Store",
+                            QString::fromStdString(storeError) + ". Profile changes will not be saved.");
+   }
    Home* h = new Home();
    Log* l = new Log();
+   // Keep log formatting and console output off the GUI thread
+   l->setMode(Log::ASYNCHRONOUS);
 
    pump = new Pump(pm, h, l);
 
-   homeWindow = new QHomeWindow(pump, this);
+   // Virtual-clock engine, paced in real time for the GUI
+   engine = new SimulationEngine(pump);
+   pacer = new RealTimePacer(engine, this);
+
+   homeWindow = new QHomeWindow(pump, pacer, this);
    bolusWindow = new QBolusWindow(pump, this);
    logWindow = new QLogWindow(pump, this);
    optionsMenu = new QOptionsMenu(pump, this);
@@ -35,10 +53,16 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), pump(nullptr), ui
    connect(optionsMenu, &QOptionsMenu::navHomeRequested, this, &MainWindow::showHomeWindow);
    connect(optionsMenu, &QOptionsMenu::navPersonalRequested, this, &MainWindow::showPersonalProfiles);
    connect(personalProfiles, &QPersonalProfiles::navHomeRequested, this, &MainWindow::showHomeWindow);
+   connect(optionsMenu, &QOptionsMenu::navLogRequested, this, &MainWindow::showLogWindow);
+   connect(logWindow, &QLogWindow::navHomeRequested, this, &MainWindow::showHomeWindow);
+
+   pacer->start();
 }
 
 MainWindow::~MainWindow() {
+   pacer->stop();
    delete ui;
+   delete engine;
    delete pump;
 }
 
@@ -59,4 +83,8 @@ void MainWindow::showPersonalProfiles() {
    stackedWidget->setCurrentWidget(personalProfiles);
 }
 
+void MainWindow::showLogWindow() {
+   stackedWidget->setCurrentWidget(logWindow);
+}
+
 
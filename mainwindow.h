@@ -25,6 +25,7 @@ private slots:
    void showBolusWindow();
    void showOptionsMenu();
    void showPersonalProfiles();
+   void showLogWindow();
 
 private:
    Ui::MainWindow *ui;
@@ -36,6 +37,8 @@ private:
    QPersonalProfiles *personalProfiles;
 
    Pump *pump;
+   SimulationEngine *engine;
+   RealTimePacer *pacer;
 };
 
 #endif // MAINWINDOW_H
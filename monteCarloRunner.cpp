@@ -0,0 +1,97 @@
+#include "monteCarloRunner.h"
+#include "patientSimulation.h"
+#include "workStealingPool.h"
+#include "homeRules.h"
+#include <chrono>
+#include <random>
+#include <string>
+
+PatientResult MonteCarloRunner::simulatePatient(const MonteCarloConfig& config, size_t patient) {
+    std::mt19937 rng(config.seed + static_cast<unsigned>(patient));
+    auto draw = [&rng](float lo, float hi) {
+        return std::uniform_real_distribution<float>(lo, hi)(rng);
+    };
+
+    float basal = draw(config.minBasalRate, config.maxBasalRate);
+    float cf = draw(config.minCorrectionFactor, config.maxCorrectionFactor);
+    float icr = draw(config.minCarbRatio, config.maxCarbRatio);
+    float target = draw(config.minTargetGlucose, config.maxTargetGlucose);
+    float glucose = draw(config.minInitialGlucose, config.maxInitialGlucose);
+    float carbs = draw(config.minCarbIntake, config.maxCarbIntake);
+
+    PatientResult result;
+    result.initialGlucose = glucose;
+
+    PatientSimulation sim;
+    std::string errorMsg;
+    if (!sim.setupProfile("Patient-" + std::to_string(patient), basal, cf, icr, target, errorMsg)) {
+        return result;
+    }
+
+    Bolus* bolus = sim.startBolus(glucose, carbs);
+    result.bolusDose = bolus->getAppropriateDose();
+
+    // Track glucose at each CGM sample and run the whole stay in one advance,
+    // so the engine jumps straight between events
+    result.minGlucose = glucose;
+    result.maxGlucose = glucose;
+    Home& home = sim.getHome();
+    auto sample = [&result, &home](long long) {
+        float g = home.getGlucoseLevel();
+        if (g < result.minGlucose) result.minGlucose = g;
+        if (g > result.maxGlucose) result.maxGlucose = g;
+    };
+    sim.getEngine().setSampleListener(sample);
+    sim.getEngine().runDays(config.days);
+    sim.getEngine().setSampleListener(nullptr);
+    sample(sim.getEngine().getElapsedSeconds());
+
+    result.finalGlucose = sim.getHome().getGlucoseLevel();
+    result.finalBattery = sim.getHome().getBatteryLevel();
+    result.finalIOB = sim.getHome().getIOB();
+    result.bolusDelivered = sim.getPump().getBolusHistory().deliveredBetween(0, sim.getEngine().getElapsedSeconds() + 1).toFloat();
+    result.valid = true;
+    return result;
+}
+
+MonteCarloReport MonteCarloRunner::run(const MonteCarloConfig& config) {
+    MonteCarloReport report;
+    report.results.resize(config.patients);
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(config.threads);
+        report.threads = pool.getThreadCount();
+
+        PatientResult* out = report.results.data();
+        for (size_t i = 0; i < config.patients; ++i) {
+            pool.submit([&config, out, i] {
+                out[i] = simulatePatient(config, i);
+            });
+        }
+        pool.wait();
+        report.steals = pool.getStealCount();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    report.wallSeconds = std::chrono::duration<double>(end - start).count();
+    if (report.wallSeconds > 0.0) {
+        report.patientDaysPerSecond = (static_cast<double>(config.patients) * config.days) / report.wallSeconds;
+    }
+
+    // Merge after the pool has joined; no synchronisation needed
+    size_t validCount = 0;
+    double glucoseSum = 0.0;
+    for (const PatientResult& r : report.results) {
+        if (!r.valid) continue;
+        ++validCount;
+        glucoseSum += r.finalGlucose;
+        if (r.finalBattery <= HomeRules::CRITICAL_BATTERY_THRESHOLD) {
+            ++report.criticalBatteryCount;
+        }
+    }
+    if (validCount > 0) {
+        report.meanFinalGlucose = glucoseSum / validCount;
+    }
+    return report;
+}
@@ -0,0 +1,56 @@
+#ifndef MONTECARLORUNNER_H
+#define MONTECARLORUNNER_H
+
+#include <vector>
+#include <cstddef>
+
+// Parameter ranges a cohort is sampled from; every patient draws its own
+// values from a generator seeded with (seed + patient index), so results do
+// not depend on the number of threads or on scheduling order.
+struct MonteCarloConfig {
+    size_t patients = 1000;
+    int days = 1;
+    unsigned threads = 0; // 0 = one per core
+    unsigned seed = 1;
+
+    float minBasalRate = 0.5f, maxBasalRate = 2.0f;
+    float minCorrectionFactor = 30.0f, maxCorrectionFactor = 80.0f;
+    float minCarbRatio = 8.0f, maxCarbRatio = 20.0f;
+    float minTargetGlucose = 90.0f, maxTargetGlucose = 130.0f;
+    float minInitialGlucose = 70.0f, maxInitialGlucose = 250.0f;
+    float minCarbIntake = 0.0f, maxCarbIntake = 90.0f;
+};
+
+struct PatientResult {
+    float initialGlucose = 0.0f;
+    float finalGlucose = 0.0f;
+    float minGlucose = 0.0f; // over the five-minute CGM samples
+    float maxGlucose = 0.0f;
+    float bolusDose = 0.0f;
+    float finalBattery = 0.0f;
+    float finalIOB = 0.0f;
+    float bolusDelivered = 0.0f; // units every bolus of the run delivered
+    bool valid = false;
+};
+
+struct MonteCarloReport {
+    std::vector<PatientResult> results; // indexed by patient
+    unsigned threads = 0;
+    size_t steals = 0;
+    double wallSeconds = 0.0;
+    double patientDaysPerSecond = 0.0;
+    double meanFinalGlucose = 0.0;
+    size_t criticalBatteryCount = 0;
+};
+
+// Runs independent PatientSimulation instances across all cores on a
+// WorkStealingPool. Each task writes only its own slot in the result
+// vector, so merging needs no lock.
+class MonteCarloRunner {
+    public:
+        MonteCarloReport run(const MonteCarloConfig& config);
+
+        static PatientResult simulatePatient(const MonteCarloConfig& config, size_t patient);
+};
+
+#endif // MONTECARLORUNNER_H
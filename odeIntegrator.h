@@ -0,0 +1,113 @@
+#ifndef ODEINTEGRATOR_H
+#define ODEINTEGRATOR_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+// Adaptive Bogacki-Shampine 3(2) integrator for small autonomous systems.
+// Three derivative evaluations per accepted step (the last stage is reused
+// as the first stage of the next step), and the step size grows quickly
+// when the error estimate is small, so quiescent stretches cost very few steps.
+template <size_t N>
+class OdeIntegrator {
+    public:
+        typedef std::array<double, N> State;
+
+        struct Stats {
+            long long acceptedSteps = 0;
+            long long rejectedSteps = 0;
+            long long evaluations = 0;
+        };
+
+        OdeIntegrator() : relTol(1e-4), maxStep(240.0), minStep(1e-4), lastStep(1.0) {
+            absTol.fill(1e-6);
+        }
+
+        void setRelativeTolerance(double tol) { relTol = tol; }
+        void setAbsoluteTolerance(size_t i, double tol) { absTol[i] = tol; }
+        void setMaxStep(double h) { maxStep = h; }
+
+        const Stats& getStats() const { return stats; }
+        void resetStats() { stats = Stats(); }
+
+        // Step-size memory carried between calls, for snapshots
+        double getLastStep() const { return lastStep; }
+        void restore(double step, const Stats& savedStats) { lastStep = step; stats = savedStats; }
+
+        // Integrate y over `duration`; deriv(const State&, State&) fills dy/dt
+        template <class Deriv>
+        void integrate(State& y, double duration, Deriv deriv) {
+            if (duration <= 0.0) {
+                return;
+            }
+
+            State k1, k2, k3, k4, tmp, y3;
+            deriv(y, k1);
+            ++stats.evaluations;
+
+            double t = 0.0;
+            double h = (lastStep < maxStep) ? lastStep : maxStep;
+            while (t < duration) {
+                bool lastChunk = false;
+                if (h >= duration - t) {
+                    h = duration - t;
+                    lastChunk = true;
+                }
+
+                for (size_t i = 0; i < N; ++i) tmp[i] = y[i] + 0.5 * h * k1[i];
+                deriv(tmp, k2);
+                for (size_t i = 0; i < N; ++i) tmp[i] = y[i] + 0.75 * h * k2[i];
+                deriv(tmp, k3);
+                for (size_t i = 0; i < N; ++i) {
+                    y3[i] = y[i] + h * (2.0 / 9.0 * k1[i] + 1.0 / 3.0 * k2[i] + 4.0 / 9.0 * k3[i]);
+                }
+                deriv(y3, k4);
+                stats.evaluations += 3;
+
+                // Embedded second-order solution gives the error estimate
+                double errNorm = 0.0;
+                for (size_t i = 0; i < N; ++i) {
+                    double err = h * (-5.0 / 72.0 * k1[i] + 1.0 / 12.0 * k2[i]
+                                      + 1.0 / 9.0 * k3[i] - 1.0 / 8.0 * k4[i]);
+                    double scale = absTol[i] + relTol * std::fabs(y3[i]);
+                    double ratio = std::fabs(err) / scale;
+                    if (ratio > errNorm) errNorm = ratio;
+                }
+
+                if (errNorm <= 1.0 || h <= minStep) {
+                    t = lastChunk ? duration : t + h;
+                    y = y3;
+                    k1 = k4;
+                    ++stats.acceptedSteps;
+                } else {
+                    ++stats.rejectedSteps;
+                    lastChunk = false;
+                }
+
+                // Standard step-size update, limited to [0.2x, 5x]
+                double factor = (errNorm > 0.0) ? 0.9 * std::pow(errNorm, -1.0 / 3.0) : 5.0;
+                if (factor < 0.2) factor = 0.2;
+                if (factor > 5.0) factor = 5.0;
+                double next = h * factor;
+                if (next > maxStep) next = maxStep;
+                if (next < minStep) next = minStep;
+
+                // Don't let a short final chunk shrink the step for the next call
+                if (!lastChunk || next > lastStep) {
+                    lastStep = next;
+                }
+                h = next;
+            }
+        }
+
+    private:
+        std::array<double, N> absTol;
+        double relTol;
+        double maxStep;
+        double minStep;
+        double lastStep;
+        Stats stats;
+};
+
+#endif // ODEINTEGRATOR_H
@@ -0,0 +1,69 @@
+#include "patientSimulation.h"
+#include "snapshot.h"
+
+PatientSimulation::PatientSimulation()
+    : pump(&profileManager, &home, &log), engine(&pump) {
+    // Headless runs keep the log but do not echo every line to the console
+    log.setConsoleEcho(false);
+}
+
+PatientSimulation::~PatientSimulation() {}
+
+bool PatientSimulation::setupProfile(const std::string& mode, float basalRate, float correctionFactor,
+                                     float carbRatio, float targetGlucose, std::string& errorMsg) {
+    if (!profileManager.createProfile(mode, basalRate, correctionFactor, carbRatio, targetGlucose, errorMsg)) {
+        return false;
+    }
+    pump.switchProfile(mode);
+    return pump.getCurrentProfile() != nullptr;
+}
+
+Bolus* PatientSimulation::startBolus(float glucoseLevel, float carbIntake) {
+    Bolus* bolus = pump.createBolus("B001", glucoseLevel, carbIntake);
+    pump.setCurrentGlucoseLevel(glucoseLevel);
+    bolus->calculateFinalBolus();
+
+    pump.startInsulinDelivery();
+    bolus->setActive();
+    return bolus;
+}
+
+std::vector<char> PatientSimulation::snapshot() const {
+    SnapshotWriter out;
+    out.write(SNAPSHOT_MAGIC);
+    out.write(SNAPSHOT_VERSION);
+
+    profileManager.saveState(out);
+    home.saveState(out);
+    log.saveState(out);
+
+    pump.saveState(out);
+    engine.saveState(out);
+    return out.take();
+}
+
+bool PatientSimulation::restore(const std::vector<char>& data) {
+    SnapshotReader in(data);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if (!in.read(magic) || !in.read(version) || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+        return false;
+    }
+
+    if (!profileManager.restoreState(in) || !home.restoreState(in) || !log.restoreState(in)) {
+        return false;
+    }
+
+    if (!pump.restoreState(in) || !engine.restoreState(in)) {
+        return false;
+    }
+    return in.isValid() && in.atEnd();
+}
+
+std::unique_ptr<PatientSimulation> PatientSimulation::fork() const {
+    std::unique_ptr<PatientSimulation> branch(new PatientSimulation());
+    if (!branch->restore(snapshot())) {
+        return nullptr;
+    }
+    return branch;
+}
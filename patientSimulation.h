@@ -0,0 +1,58 @@
+#ifndef PATIENTSIMULATION_H
+#define PATIENTSIMULATION_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "profileManager.h"
+#include "home.h"
+#include "log.h"
+#include "pump.h"
+#include "bolus.h"
+#include "simulationEngine.h"
+
+// One self-contained virtual patient: the same ProfileManager/Home/Log/Pump
+// graph that MainWindow builds, driven headlessly by its own engine.
+// Instances share nothing, so each can run on its own thread.
+class PatientSimulation {
+    public:
+        PatientSimulation();
+        ~PatientSimulation();
+
+        PatientSimulation(const PatientSimulation&) = delete;
+        PatientSimulation& operator=(const PatientSimulation&) = delete;
+
+        // Create a profile and make it the pump's active profile
+        bool setupProfile(const std::string& mode, float basalRate, float correctionFactor,
+                          float carbRatio, float targetGlucose, std::string& errorMsg);
+
+        // Calculate and start a bolus, as the bolus and home windows do; the
+        // pump owns it
+        Bolus* startBolus(float glucoseLevel, float carbIntake);
+
+        // Capture the whole patient (profiles, home, log, pump, active bolus,
+        // engine clock and pending events) as a compact binary blob
+        std::vector<char> snapshot() const;
+        bool restore(const std::vector<char>& data);
+        // A new, independent patient continuing from this one's current state
+        std::unique_ptr<PatientSimulation> fork() const;
+
+        ProfileManager& getProfileManager() { return profileManager; }
+        Home& getHome() { return home; }
+        Log& getLog() { return log; }
+        Pump& getPump() { return pump; }
+        SimulationEngine& getEngine() { return engine; }
+
+    private:
+        ProfileManager profileManager;
+        Home home;
+        Log log;
+        Pump pump;
+        SimulationEngine engine;
+
+        static constexpr uint32_t SNAPSHOT_MAGIC = 0x53535049; // "IPSS"
+        static constexpr uint32_t SNAPSHOT_VERSION = 9;
+};
+
+#endif // PATIENTSIMULATION_H
@@ -1,10 +1,11 @@
 #include "profile.h"
 #include <sstream>
+#include "snapshot.h"
 
 // Modify the constructor to accept a const string reference instead of string&, to be compatible with ProfileManager
 Profile::Profile(const string& mode, float basalRate, float correctionFactor, float carbohydratesRatio, float targetGlucoseLevels) :
-    mode(mode), basalRate(basalRate), correctionFactor(correctionFactor),
-    carbohydratesRatio(carbohydratesRatio), targetGlucoseLevels(targetGlucoseLevels),
+    version(make_shared<const ProfileVersion>(mode, vector<ProfileSegment>(1,
+            ProfileSegment{0, basalRate, correctionFactor, carbohydratesRatio, targetGlucoseLevels}), 1)),
     selectedProfile(false) {
 
     // Validation is not performed in the constructor, but relies on ProfileManager's validation
@@ -12,23 +13,124 @@ Profile::Profile(const string& mode, float basalRate, float correctionFactor, fl
 
 Profile::~Profile() {}
 
+ProfileVersion::ProfileVersion(const string& mode, const vector<ProfileSegment>& segments, uint64_t revision) :
+    mode(mode), segments(segments), revision(revision) {}
+
+// Readers holding the old version are unaffected; the swap is the only
+// point the editor and readers share
+void Profile::publish(const string& mode, const vector<ProfileSegment>& daySegments) {
+    atomic_store(&version, make_shared<const ProfileVersion>(mode, daySegments, version->getRevision() + 1));
+}
+
+void Profile::setMode(const string& mode) {
+    publish(mode, version->getSegments());
+}
+
+void Profile::setBasalRate(float basalRate) {
+    setSettings(basalRate, getCorrectionFactor(), getCarbohydratesRatio(), getTargetGlucoseLevels());
+}
+
+void Profile::setCorrectionFactor(float correctionFactor) {
+    setSettings(getBasalRate(), correctionFactor, getCarbohydratesRatio(), getTargetGlucoseLevels());
+}
+
+void Profile::setCarbohydratesRatio(float carbohydratesRatio) {
+    setSettings(getBasalRate(), getCorrectionFactor(), carbohydratesRatio, getTargetGlucoseLevels());
+}
+
+void Profile::setTargetGlucoseLevels(float targetGlucoseLevels) {
+    setSettings(getBasalRate(), getCorrectionFactor(), getCarbohydratesRatio(), targetGlucoseLevels);
+}
+
+void Profile::setSettings(float basalRate, float correctionFactor, float carbohydratesRatio, float targetGlucoseLevels) {
+    vector<ProfileSegment> daySegments = version->getSegments();
+    daySegments[0] = ProfileSegment{0, basalRate, correctionFactor, carbohydratesRatio, targetGlucoseLevels};
+    publish(getMode(), daySegments);
+}
+
+// Called on every delivery tick: a branchless binary search for the last
+// segment starting at or before the minute. With at most MAX_SEGMENTS it
+// is a handful of conditional moves and no unpredictable branches.
+const ProfileSegment& ProfileVersion::segmentAt(int minuteOfDay) const {
+    const ProfileSegment* base = segments.data();
+    size_t n = segments.size();
+    while (n > 1) {
+        size_t half = n / 2;
+        base = (base[half].startMinute <= minuteOfDay) ? base + half : base;
+        n -= half;
+    }
+    return *base;
+}
+
+int ProfileVersion::segmentEnd(int minuteOfDay) const {
+    size_t next = static_cast<size_t>(&segmentAt(minuteOfDay) - segments.data()) + 1;
+    return next < segments.size() ? segments[next].startMinute : Profile::MINUTES_PER_DAY;
+}
+
+bool Profile::validSegmentTimes(const vector<ProfileSegment>& daySegments) {
+    if (daySegments.empty() || daySegments.size() > static_cast<size_t>(MAX_SEGMENTS) || daySegments[0].startMinute != 0) {
+        return false;
+    }
+    for (size_t i = 1; i < daySegments.size(); ++i) {
+        if (daySegments[i].startMinute <= daySegments[i - 1].startMinute || daySegments[i].startMinute >= MINUTES_PER_DAY) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Profile::setSegments(const vector<ProfileSegment>& daySegments) {
+    if (!validSegmentTimes(daySegments)) {
+        return false;
+    }
+    publish(getMode(), daySegments);
+    return true;
+}
+
 // Print method to provide detailed configuration information
 void Profile::print() {
-    cout << "Profile: " << mode << endl;
-    cout << "  Basal Rate: " << basalRate << endl;
-    cout << "  Correction Factor: " << correctionFactor << endl;
-    cout << "  Carbohydrates Ratio: " << carbohydratesRatio << endl;
-    cout << "  Target Glucose Levels: " << targetGlucoseLevels << endl;
+    cout << "Profile: " << getMode() << endl;
+    cout << "  Basal Rate: " << getBasalRate() << endl;
+    cout << "  Correction Factor: " << getCorrectionFactor() << endl;
+    cout << "  Carbohydrates Ratio: " << getCarbohydratesRatio() << endl;
+    cout << "  Target Glucose Levels: " << getTargetGlucoseLevels() << endl;
+    const vector<ProfileSegment>& segments = getSegments();
+    for (size_t i = 1; i < segments.size(); ++i) {
+        const ProfileSegment& s = segments[i];
+        cout << "  From " << s.startMinute / 60 << ":" << (s.startMinute % 60 < 10 ? "0" : "") << s.startMinute % 60
+             << " - Basal: " << s.basalRate << ", CF: " << s.correctionFactor
+             << ", ICR: " << s.carbohydratesRatio << ", Target: " << s.targetGlucoseLevels << endl;
+    }
     cout << "  Status: " << (selectedProfile ? "Activated" : "Deactivated") << endl;
 }
 
 // Method to convert to string, convenient for logging and display
 string Profile::toString() const {
     stringstream ss;
-    ss << "Profile [Mode: " << mode
-       << ", Basal Rate: " << basalRate
-       << ", Correction Factor: " << correctionFactor
-       << ", Carbohydrates Ratio: " << carbohydratesRatio
-       << ", Target Glucose Levels: " << targetGlucoseLevels << "]";
+    ss << "Profile [Mode: " << getMode()
+       << ", Basal Rate: " << getBasalRate()
+       << ", Correction Factor: " << getCorrectionFactor()
+       << ", Carbohydrates Ratio: " << getCarbohydratesRatio()
+       << ", Target Glucose Levels: " << getTargetGlucoseLevels()
+       << ", Segments: " << getSegmentCount() << "]";
     return ss.str();
 }
+
+void Profile::saveState(SnapshotWriter& out) const {
+    out.writeString(getMode());
+    out.writeVector(getSegments());
+    out.write(selectedProfile);
+}
+
+bool Profile::restoreState(SnapshotReader& in) {
+    string restoredMode;
+    vector<ProfileSegment> restored;
+    in.readString(restoredMode);
+    in.readVector(restored);
+    in.read(selectedProfile);
+    if (!in.isValid() || !validSegmentTimes(restored)) {
+        return false;
+    }
+    publish(restoredMode, restored);
+    return true;
+}
@@ -2,40 +2,113 @@
 #define PROFILE_H
 
 #include <string>
+#include <string_view>
 #include <iostream>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+class SnapshotWriter;
+class SnapshotReader;
 
 using namespace std;
 
+// Therapy settings in effect from `startMinute` (minutes after midnight)
+// until the next segment of the day starts
+struct ProfileSegment {
+    int startMinute;
+    float basalRate;
+    float correctionFactor;
+    float carbohydratesRatio;
+    float targetGlucoseLevels;
+};
+
+// One published state of a profile. Versions never change once built, so
+// a bolus or simulation thread holding one reads it without locking while
+// the profile moves on to newer versions.
+class ProfileVersion {
+    private:
+        const string mode;
+        // Sorted by start; the first always starts at midnight
+        const vector<ProfileSegment> segments;
+        const uint64_t revision;
+
+    public:
+        ProfileVersion(const string& mode, const vector<ProfileSegment>& segments, uint64_t revision);
+
+        const string& getMode() const { return mode; }
+        uint64_t getRevision() const { return revision; }
+        float getBasalRate() const { return segments[0].basalRate; }
+        float getCorrectionFactor() const { return segments[0].correctionFactor; }
+        float getCarbohydratesRatio() const { return segments[0].carbohydratesRatio; }
+        float getTargetGlucoseLevels() const { return segments[0].targetGlucoseLevels; }
+
+        // Segment in effect at a minute of the day [0, MINUTES_PER_DAY)
+        const ProfileSegment& segmentAt(int minuteOfDay) const;
+        // Minute the segment in effect at `minuteOfDay` ends (MINUTES_PER_DAY for the last)
+        int segmentEnd(int minuteOfDay) const;
+        const vector<ProfileSegment>& getSegments() const { return segments; }
+        int getSegmentCount() const { return static_cast<int>(segments.size()); }
+};
+
+// An editable profile. Every change builds a new ProfileVersion and
+// publishes it with an atomic pointer swap; readers that pinned an older
+// version keep it alive until they let go.
 class Profile {
     private:
-        string mode;
-        float basalRate;
-        float correctionFactor;
-        float carbohydratesRatio;
-        float targetGlucoseLevels;
+        shared_ptr<const ProfileVersion> version;
         bool selectedProfile;
 
+        void publish(const string& mode, const vector<ProfileSegment>& daySegments);
+
     public:
         // Constructor & Destructor
         Profile(const string& mode, float basalRate, float correctionFactor,
                 float carbohydratesRatio, float targetGlucoseLevels);
         ~Profile();
 
-        // Getters
-        string getMode() const { return mode; }
-        float getBasalRate() const { return basalRate; }
-        float getCorrectionFactor() const { return correctionFactor; }
-        float getCarbohydratesRatio() const { return carbohydratesRatio; }
-        float getTargetGlucoseLevels() const { return targetGlucoseLevels; }
+        static const int MINUTES_PER_DAY = 24 * 60;
+        static const int MAX_SEGMENTS = 48;
+
+        // The current version; safe to call while another thread publishes
+        shared_ptr<const ProfileVersion> getVersion() const { return atomic_load(&version); }
+
+        // Getters read the current version and belong to the editing thread;
+        // the plain values are those of the first (midnight) segment, and
+        // segment references last until the next change. The mode is a copy,
+        // since callers keep it across changes; hasMode compares without one.
+        string getMode() const { return version->getMode(); }
+        bool hasMode(std::string_view name) const { return version->getMode() == name; }
+        uint64_t getRevision() const { return version->getRevision(); }
+        float getBasalRate() const { return version->getBasalRate(); }
+        float getCorrectionFactor() const { return version->getCorrectionFactor(); }
+        float getCarbohydratesRatio() const { return version->getCarbohydratesRatio(); }
+        float getTargetGlucoseLevels() const { return version->getTargetGlucoseLevels(); }
         bool isSelected() const { return selectedProfile; }
 
-        // Setters
-        void setMode(const string& mode) { this->mode = mode; }
-        void setBasalRate(float basalRate) { this->basalRate = basalRate; }
-        void setCorrectionFactor(float correctionFactor) { this->correctionFactor = correctionFactor; }
-        void setCarbohydratesRatio(float carbohydratesRatio) { this->carbohydratesRatio = carbohydratesRatio; }
-        void setTargetGlucoseLevels(float targetGlucoseLevels) { this->targetGlucoseLevels = targetGlucoseLevels; }
+        const ProfileSegment& segmentAt(int minuteOfDay) const { return version->segmentAt(minuteOfDay); }
+        int segmentEnd(int minuteOfDay) const { return version->segmentEnd(minuteOfDay); }
+        const vector<ProfileSegment>& getSegments() const { return version->getSegments(); }
+        int getSegmentCount() const { return version->getSegmentCount(); }
+
+        // Setters; each publishes a new version
+        void setMode(const string& mode);
+        void setBasalRate(float basalRate);
+        void setCorrectionFactor(float correctionFactor);
+        void setCarbohydratesRatio(float carbohydratesRatio);
+        void setTargetGlucoseLevels(float targetGlucoseLevels);
         void setSelectedProfile(bool selectedProfile) { this->selectedProfile = selectedProfile; }
+        // Set all midnight values in a single version
+        void setSettings(float basalRate, float correctionFactor, float carbohydratesRatio, float targetGlucoseLevels);
+
+        // Replace the day's segments; fails (changing nothing) unless the
+        // starts are increasing, the first is at midnight and all are in the day
+        bool setSegments(const vector<ProfileSegment>& daySegments);
+        static bool validSegmentTimes(const vector<ProfileSegment>& daySegments);
+
+        // Snapshot support
+        void saveState(SnapshotWriter& out) const;
+        bool restoreState(SnapshotReader& in);
 
         // Print and Debug
         void print();
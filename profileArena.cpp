@@ -0,0 +1,43 @@
+#include "profileArena.h"
+
+ProfileArena::ProfileArena() : freeList(nullptr), used(BLOCK_PROFILES), count(0) {}
+
+ProfileArena::~ProfileArena() {}
+
+// Reuse a freed cell first, then carve the next one from the last block
+ProfileArena::Cell* ProfileArena::takeCell() {
+    if (freeList) {
+        Cell* cell = freeList;
+        freeList = cell->next;
+        return cell;
+    }
+    if (used == BLOCK_PROFILES) {
+        blocks.emplace_back(new Cell[BLOCK_PROFILES]);
+        used = 0;
+    }
+    return &blocks.back()[used++];
+}
+
+void ProfileArena::releaseCell(Cell* cell) {
+    cell->next = freeList;
+    freeList = cell;
+}
+
+void ProfileArena::destroy(Profile* p) {
+    if (!p) {
+        return;
+    }
+    p->~Profile();
+    releaseCell(reinterpret_cast<Cell*>(p));
+    --count;
+}
+
+// Keep the first block so refilling a small catalog allocates nothing
+void ProfileArena::reset() {
+    if (blocks.size() > 1) {
+        blocks.resize(1);
+    }
+    freeList = nullptr;
+    used = blocks.empty() ? BLOCK_PROFILES : 0;
+    count = 0;
+}
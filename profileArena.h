@@ -0,0 +1,61 @@
+#ifndef PROFILEARENA_H
+#define PROFILEARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include "profile.h"
+
+// Slab storage for profiles. Profiles are built in place in fixed-size
+// blocks that are never moved or returned, so a Profile* stays valid until
+// the profile is destroyed and a freed cell is reused by the next create.
+// Catalogs built in one go end up contiguous, in creation order.
+class ProfileArena {
+    public:
+        ProfileArena();
+        ~ProfileArena();
+
+        ProfileArena(const ProfileArena&) = delete;
+        ProfileArena& operator=(const ProfileArena&) = delete;
+
+        template <class... Args>
+        Profile* create(Args&&... args) {
+            Cell* cell = takeCell();
+            try {
+                Profile* p = new (cell->storage) Profile(std::forward<Args>(args)...);
+                ++count;
+                return p;
+            } catch (...) {
+                releaseCell(cell);
+                throw;
+            }
+        }
+
+        // `p` must have come from this arena
+        void destroy(Profile* p);
+        // Destroying every profile is up to the owner; this only recycles
+        // the blocks (all cells must already be destroyed)
+        void reset();
+
+        size_t size() const { return count; }
+
+        static const size_t BLOCK_PROFILES = 64;
+
+    private:
+        union Cell {
+            Cell* next; // while free
+            alignas(Profile) unsigned char storage[sizeof(Profile)];
+        };
+
+        Cell* takeCell();
+        void releaseCell(Cell* cell);
+
+        std::vector<std::unique_ptr<Cell[]>> blocks;
+        Cell* freeList;
+        size_t used;    // cells handed out from the last block
+        size_t count;
+};
+
+#endif // PROFILEARENA_H
@@ -0,0 +1,89 @@
+#include "profileBenchmark.h"
+#include "profileManager.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double nanosSince(std::chrono::steady_clock::time_point start, size_t operations) {
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return operations ? elapsed.count() / operations : 0.0;
+}
+
+}
+
+ProfileBenchmarkMetrics ProfileBenchmark::run(size_t count, uint32_t seed) {
+    ProfileBenchmarkMetrics metrics;
+    metrics.profiles = count;
+    if (count < 2) {
+        return metrics;
+    }
+
+    // Names are built up front so only the manager is timed
+    std::vector<std::string> names(count);
+    for (size_t i = 0; i < count; ++i) {
+        names[i] = "profile-" + std::to_string(i);
+    }
+    std::mt19937 rng(seed);
+    std::vector<size_t> lookups(count);
+    for (size_t& n : lookups) {
+        n = rng() % count;
+    }
+    // Every odd profile, shuffled; profile-0 is active and cannot go
+    std::vector<size_t> deletes;
+    for (size_t i = 1; i < count; i += 2) {
+        deletes.push_back(i);
+    }
+    std::shuffle(deletes.begin(), deletes.end(), rng);
+
+    Trace::Sink sink = Trace::getSink();
+    Trace::setSink(nullptr);
+    auto wallStart = std::chrono::steady_clock::now();
+
+    ProfileManager manager;
+    std::string errorMsg;
+    bool ok = true;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        ok &= manager.createProfile(names[i], 1.0f, 50.0f, 10.0f, 110.0f, errorMsg);
+    }
+    metrics.createNanos = nanosSince(start, count);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t n : lookups) {
+        ok &= manager.profileExists(names[n]);
+    }
+    metrics.lookupNanos = nanosSince(start, count);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t n : lookups) {
+        ok &= manager.updateProfile(names[n], 1.2f, 45.0f, 12.0f, 100.0f, errorMsg);
+    }
+    metrics.updateNanos = nanosSince(start, count);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t n : deletes) {
+        ok &= manager.deleteProfile(names[n], errorMsg);
+    }
+    metrics.deleteNanos = nanosSince(start, deletes.size());
+
+    start = std::chrono::steady_clock::now();
+    ProfileListView left = manager.getProfileList();
+    metrics.listMillis = nanosSince(start, 1) * 1e-6;
+
+    // The even profiles are left, still in creation order
+    ok &= left.size() == count - deletes.size();
+    for (size_t i = 0; ok && i < left.size(); ++i) {
+        ok &= left[i]->getMode() == names[2 * i];
+    }
+
+    metrics.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    Trace::setSink(sink);
+    metrics.valid = ok;
+    return metrics;
+}
@@ -0,0 +1,30 @@
+#ifndef PROFILEBENCHMARK_H
+#define PROFILEBENCHMARK_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Mean cost of each catalog operation on one large ProfileManager
+struct ProfileBenchmarkMetrics {
+    size_t profiles = 0;
+    bool valid = false;      // every call succeeded and the survivors kept their order
+
+    double createNanos = 0.0;
+    double lookupNanos = 0.0;  // random names, all present
+    double updateNanos = 0.0;
+    double deleteNanos = 0.0;  // every odd profile, in random order
+    double listMillis = 0.0;   // one ordered listing of what is left
+    double wallSeconds = 0.0;
+};
+
+// Times ProfileManager's CRUD operations on `count` generated profiles
+// ("profile-0", "profile-1", ...) with no store open and tracing off, so
+// only the list, arena and index are measured.
+class ProfileBenchmark {
+    public:
+        static const size_t DEFAULT_PROFILES = 1000000;
+
+        static ProfileBenchmarkMetrics run(size_t count = DEFAULT_PROFILES, uint32_t seed = 7);
+};
+
+#endif // PROFILEBENCHMARK_H
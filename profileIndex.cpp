@@ -0,0 +1,111 @@
+#include "profileIndex.h"
+#include "profile.h"
+
+ProfileIndex::ProfileIndex(const std::vector<Profile*>& profiles) : profiles(profiles), count(0), mask(0) {
+    clear();
+}
+
+// FNV-1a, folded to 32 bits
+uint32_t ProfileIndex::hashOf(std::string_view name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+size_t ProfileIndex::probe(std::string_view name, uint32_t tag) const {
+    size_t i = tag & mask;
+    for (;;) {
+        const Slot& slot = buckets[i];
+        if (slot.position == NOT_FOUND
+                || (slot.tag == tag && profiles[slot.position]->hasMode(name))) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+int32_t ProfileIndex::find(std::string_view name) const {
+    return buckets[probe(name, hashOf(name))].position;
+}
+
+bool ProfileIndex::insert(std::string_view name, int32_t position) {
+    // Keep the load factor under 3/4
+    if ((count + 1) * 4 > buckets.size() * 3) {
+        rehash(buckets.size() * 2);
+    }
+    uint32_t tag = hashOf(name);
+    Slot& slot = buckets[probe(name, tag)];
+    if (slot.position != NOT_FOUND) {
+        return false;
+    }
+    ++count;
+    slot.tag = tag;
+    slot.position = position;
+    return true;
+}
+
+void ProfileIndex::erase(std::string_view name) {
+    size_t hole = probe(name, hashOf(name));
+    if (buckets[hole].position == NOT_FOUND) {
+        return;
+    }
+    buckets[hole].position = NOT_FOUND;
+    --count;
+
+    // Pull later entries of the run back over the hole unless their home
+    // slot lies after it, so every entry stays reachable from its home
+    for (size_t j = (hole + 1) & mask; buckets[j].position != NOT_FOUND; j = (j + 1) & mask) {
+        size_t home = buckets[j].tag & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            buckets[hole] = buckets[j];
+            buckets[j].position = NOT_FOUND;
+            hole = j;
+        }
+    }
+}
+
+void ProfileIndex::renumber(const std::vector<int32_t>& positions) {
+    for (Slot& slot : buckets) {
+        if (slot.position != NOT_FOUND) {
+            slot.position = positions[slot.position];
+        }
+    }
+}
+
+void ProfileIndex::clear() {
+    buckets.assign(MIN_CAPACITY, Slot{0, NOT_FOUND});
+    mask = MIN_CAPACITY - 1;
+    count = 0;
+}
+
+void ProfileIndex::reserve(size_t wanted) {
+    size_t capacity = buckets.size();
+    while (wanted * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+    if (capacity != buckets.size()) {
+        rehash(capacity);
+    }
+}
+
+void ProfileIndex::rehash(size_t capacity) {
+    std::vector<Slot> old;
+    old.swap(buckets);
+    buckets.assign(capacity, Slot{0, NOT_FOUND});
+    mask = capacity - 1;
+
+    // Tags carry the hash, so nothing is rehashed from the names
+    for (const Slot& slot : old) {
+        if (slot.position == NOT_FOUND) {
+            continue;
+        }
+        size_t i = slot.tag & mask;
+        while (buckets[i].position != NOT_FOUND) {
+            i = (i + 1) & mask;
+        }
+        buckets[i] = slot;
+    }
+}
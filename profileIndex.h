@@ -0,0 +1,53 @@
+#ifndef PROFILEINDEX_H
+#define PROFILEINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+class Profile;
+
+// Open-addressing hash index from profile name to position in a profile
+// list. Buckets hold only a hash fragment and a position; names are compared
+// through the list, so the table owns no strings and lookups can take any
+// string_view. Linear probing with backward-shift deletion keeps probe runs
+// short without tombstones.
+class ProfileIndex {
+    public:
+        static const int32_t NOT_FOUND = -1;
+
+        explicit ProfileIndex(const std::vector<Profile*>& profiles);
+
+        int32_t find(std::string_view name) const;
+        // False, changing nothing, if `name` is already indexed
+        bool insert(std::string_view name, int32_t position);
+        void erase(std::string_view name);
+        // Point every entry at `positions[old position]` (after the list was
+        // compacted); names are not compared, so the list may already have moved
+        void renumber(const std::vector<int32_t>& positions);
+        void clear();
+        void reserve(size_t count);
+
+        size_t size() const { return count; }
+
+    private:
+        struct Slot {
+            uint32_t tag;       // low bits of the hash; also gives the home slot
+            int32_t position;   // NOT_FOUND when empty
+        };
+
+        static uint32_t hashOf(std::string_view name);
+        // Slot holding `name`, or the empty slot where it would go
+        size_t probe(std::string_view name, uint32_t tag) const;
+        void rehash(size_t capacity);
+
+        const std::vector<Profile*>& profiles;
+        std::vector<Slot> buckets;
+        size_t count;
+        size_t mask;
+
+        const size_t MIN_CAPACITY = 16;
+};
+
+#endif // PROFILEINDEX_H
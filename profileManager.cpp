@@ -1,63 +1,99 @@
 #include "profileManager.h"
-#include <iostream>
+#include <algorithm>
+#include <cctype>
 #include <sstream>
+#include "profileRules.h"
+#include "profileStore.h"
+#include "trace.h"
+#include "snapshot.h"
 
-ProfileManager::ProfileManager() : currProfile(nullptr) {}
+ProfileManager::ProfileManager() : index(profileList), currProfile(nullptr) {}
 
 ProfileManager::~ProfileManager() {
+    removeAll();
+}
+
+void ProfileManager::addProfile(Profile* p) {
+    profileList.push_back(p);
+    index.insert(p->getMode(), static_cast<int32_t>(profileList.size() - 1));
+
+    // Automatically activate if this is the first profile
+    if (getProfileCount() == 1) {
+        currProfile = p;
+    }
+}
+
+// The deleted profile leaves a hole, so nothing else moves and the user's
+// order is kept. Holes are squeezed out once they outnumber the profiles;
+// each squeeze is paid for by the deletes before it, so a delete stays O(1)
+// amortized.
+void ProfileManager::removeAt(int position) {
+    index.erase(profileList[position]->getMode());
+    arena.destroy(profileList[position]);
+    profileList[position] = nullptr;
+    ++holes;
+    while (!profileList.empty() && !profileList.back()) {
+        profileList.pop_back();
+        --holes;
+    }
+    if (holes * 2 > profileList.size()) {
+        closeHoles();
+    }
+}
+
+// Move the profiles down over the holes, keeping their order, and point
+// the index at their new positions in one pass over its buckets
+void ProfileManager::closeHoles() const {
+    if (holes == 0) {
+        return;
+    }
+    vector<int32_t> positions(profileList.size(), -1);
+    size_t kept = 0;
+    for (size_t i = 0; i < profileList.size(); ++i) {
+        if (profileList[i]) {
+            positions[i] = static_cast<int32_t>(kept);
+            profileList[kept++] = profileList[i];
+        }
+    }
+    profileList.resize(kept);
+    holes = 0;
+    index.renumber(positions);
+}
+
+void ProfileManager::removeAll() {
     for (Profile* p : profileList) {
-        delete p;
+        if (p) {
+            arena.destroy(p);
+        }
     }
+    arena.reset();
+    profileList.clear();
+    holes = 0;
+    index.clear();
+    currProfile = nullptr;
 }
 
 // Check if a profile with the same name already exists
-bool ProfileManager::checkDuplicateName(const string& mode) {
+bool ProfileManager::checkDuplicateName(std::string_view mode) const {
     return searchName(mode) != -1;
 }
 
-// Validate profile parameters
+// Validate profile parameters against the shared rule table
 bool ProfileManager::validateProfileParams(const string& mode, float basalRate, float correctionFactor,
                                          float carbohydratesRatio, float targetGlucoseLevels, string& errorMsg) {
     // Validate mode name
-    if (mode.empty()) {
-        errorMsg = "Mode name cannot be empty";
-        return false;
-    }
-
-    // Validate basal rate
-    static const float MIN_BASAL_RATE = 0.0f;
-    static const float MAX_BASAL_RATE = 30.0f;
-    if (basalRate < MIN_BASAL_RATE || basalRate > MAX_BASAL_RATE) {
-        errorMsg = "Basal rate must be between " + to_string(MIN_BASAL_RATE) +
-                   " and " + to_string(MAX_BASAL_RATE);
-        return false;
-    }
-
-    // Validate correction factor
-    static const float MIN_CORRECTION_FACTOR = 1.0f;
-    static const float MAX_CORRECTION_FACTOR = 400.0f;
-    if (correctionFactor < MIN_CORRECTION_FACTOR || correctionFactor > MAX_CORRECTION_FACTOR) {
-        errorMsg = "Correction factor must be between " + to_string(MIN_CORRECTION_FACTOR) +
-                   " and " + to_string(MAX_CORRECTION_FACTOR);
+    ProfileRules::NameCheck name = ProfileRules::checkName(mode);
+    if (name != ProfileRules::NameOk) {
+        errorMsg = ProfileRules::describeName(name);
         return false;
     }
 
-    // Validate carbohydrate ratio
-    static const float MIN_CARB_RATIO = 1.0f;
-    static const float MAX_CARB_RATIO = 150.0f;
-    if (carbohydratesRatio < MIN_CARB_RATIO || carbohydratesRatio > MAX_CARB_RATIO) {
-        errorMsg = "Carbohydrate ratio must be between " + to_string(MIN_CARB_RATIO) +
-                   " and " + to_string(MAX_CARB_RATIO);
-        return false;
-    }
-
-    // Validate target glucose levels
-    static const float MIN_TARGET_GLUCOSE = 70.0f;
-    static const float MAX_TARGET_GLUCOSE = 180.0f;
-    if (targetGlucoseLevels < MIN_TARGET_GLUCOSE || targetGlucoseLevels > MAX_TARGET_GLUCOSE) {
-        errorMsg = "Target glucose levels must be between " + to_string(MIN_TARGET_GLUCOSE) +
-                   " and " + to_string(MAX_TARGET_GLUCOSE);
-        return false;
+    const float values[ProfileRules::FIELD_COUNT] = {basalRate, correctionFactor, carbohydratesRatio, targetGlucoseLevels};
+    for (int f = 0; f < ProfileRules::FIELD_COUNT; ++f) {
+        if (!ProfileRules::inRange(static_cast<ProfileRules::Field>(f), values[f])) {
+            errorMsg = ProfileRules::describeRange(static_cast<ProfileRules::Field>(f));
+            return false;
+        }
     }
 
     return true;
@@ -69,43 +105,45 @@ bool ProfileManager::createProfile(const string& mode, float basalRate, float co
     // Check if the name already exists
     if (checkDuplicateName(mode)) {
         errorMsg = "Profile '" + mode + "' already exists";
-        cout << errorMsg << endl;
+        TRACE(Warning, Profile, errorMsg);
         return false;
     }
 
     // Validate all parameters
     if (!validateProfileParams(mode, basalRate, correctionFactor, carbohydratesRatio,
                              targetGlucoseLevels, errorMsg)) {
-        cout << "Failed to create profile: " << errorMsg << endl;
+        TRACE(Warning, Profile, "Failed to create profile: " << errorMsg);
+        return false;
+    }
+
+    if (store && !store->put(mode, basalRate, correctionFactor, carbohydratesRatio, targetGlucoseLevels)) {
+        errorMsg = "Failed to save profile '" + mode + "'";
+        TRACE(Error, Profile, errorMsg);
         return false;
     }
 
     try {
         // Create the profile
-        Profile* p = new Profile(mode, basalRate, correctionFactor, carbohydratesRatio, targetGlucoseLevels);
-        profileList.push_back(p);
-
-        // Automatically activate if this is the first profile
-        if (profileList.size() == 1) {
-            currProfile = p;
-        }
+        Profile* p = arena.create(mode, basalRate, correctionFactor, carbohydratesRatio, targetGlucoseLevels);
+        addProfile(p);
+        compactStore();
 
-        cout << "Profile '" << mode << "' created successfully" << endl;
+        TRACE(Info, Profile, "Profile '" << mode << "' created successfully");
         return true;
     } catch (const std::exception& e) {
         errorMsg = "Error occurred while creating profile: " + string(e.what());
-        cout << errorMsg << endl;
+        TRACE(Error, Profile, errorMsg);
         return false;
     }
 }
 
 // Read a profile
-Profile* ProfileManager::readProfile(const string& mode) {
-    int index = searchName(mode);
-    if (index != -1) {
-        return profileList[index];
+Profile* ProfileManager::readProfile(std::string_view mode) {
+    int position = searchName(mode);
+    if (position != -1) {
+        return profileList[position];
     } else {
-        cout << "Profile with name '" << mode << "' not found" << endl;
+        TRACE(Warning, Profile, "Profile with name '" << mode << "' not found");
         return nullptr;
     }
 }
@@ -114,142 +152,403 @@ Profile* ProfileManager::readProfile(const string& mode) {
 bool ProfileManager::updateProfile(const string& mode, float basalRate, float correctionFactor,
                                  float carbohydratesRatio, float targetGlucoseLevels, string& errorMsg) {
     // Find the profile
-    int index = searchName(mode);
-    if (index == -1) {
+    int position = searchName(mode);
+    if (position == -1) {
         errorMsg = "Profile with name '" + mode + "' not found";
-        cout << errorMsg << endl;
+        TRACE(Warning, Profile, errorMsg);
         return false;
     }
 
     // Validate parameters
     if (!validateProfileParams(mode, basalRate, correctionFactor, carbohydratesRatio,
                              targetGlucoseLevels, errorMsg)) {
-        cout << "Failed to update profile: " << errorMsg << endl;
+        TRACE(Warning, Profile, "Failed to update profile: " << errorMsg);
+        return false;
+    }
+
+    if (store && !store->put(mode, basalRate, correctionFactor, carbohydratesRatio, targetGlucoseLevels)) {
+        errorMsg = "Failed to save profile '" + mode + "'";
+        TRACE(Error, Profile, errorMsg);
         return false;
     }
 
     try {
-        // Update the profile
-        Profile* p = profileList[index];
-        p->setBasalRate(basalRate);
-        p->setCorrectionFactor(correctionFactor);
-        p->setCarbohydratesRatio(carbohydratesRatio);
-        p->setTargetGlucoseLevels(targetGlucoseLevels);
-
-        cout << "Profile '" << mode << "' updated successfully" << endl;
+        // Update the profile as one new version, so a bolus never sees half the change
+        profileList[position]->setSettings(basalRate, correctionFactor, carbohydratesRatio, targetGlucoseLevels);
+        compactStore();
+
+        TRACE(Info, Profile, "Profile '" << mode << "' updated successfully");
         return true;
     } catch (const std::exception& e) {
         errorMsg = "Error occurred while updating profile: " + string(e.what());
-        cout << errorMsg << endl;
+        TRACE(Error, Profile, errorMsg);
+        return false;
+    }
+}
+
+// Replace the time-of-day segments of a profile
+bool ProfileManager::setProfileSegments(const string& mode, const vector<ProfileSegment>& segments, string& errorMsg) {
+    int position = searchName(mode);
+    if (position == -1) {
+        errorMsg = "Profile with name '" + mode + "' not found";
+        TRACE(Warning, Profile, errorMsg);
+        return false;
+    }
+
+    if (!Profile::validSegmentTimes(segments)) {
+        errorMsg = "Segments must start at midnight, be in increasing order and number at most "
+                   + to_string(Profile::MAX_SEGMENTS);
+        TRACE(Warning, Profile, "Failed to update segments: " << errorMsg);
+        return false;
+    }
+    for (const ProfileSegment& s : segments) {
+        if (!validateProfileParams(mode, s.basalRate, s.correctionFactor, s.carbohydratesRatio,
+                                   s.targetGlucoseLevels, errorMsg)) {
+            errorMsg = "Segment at minute " + to_string(s.startMinute) + ": " + errorMsg;
+            TRACE(Warning, Profile, "Failed to update segments: " << errorMsg);
+            return false;
+        }
+    }
+
+    Profile updated = *profileList[position];
+    updated.setSegments(segments);
+    if (store && !store->setSegments(updated)) {
+        errorMsg = "Failed to save segments of profile '" + mode + "'";
+        TRACE(Error, Profile, errorMsg);
         return false;
     }
+
+    profileList[position]->setSegments(segments);
+    compactStore();
+
+    TRACE(Info, Profile, "Profile '" << mode << "' now has " << segments.size() << " segments");
+    return true;
 }
 
 // Delete a profile
 bool ProfileManager::deleteProfile(const string& mode, string& errorMsg) {
     // Find the profile
-    int index = searchName(mode);
-    if (index == -1) {
+    int position = searchName(mode);
+    if (position == -1) {
         errorMsg = "Profile with name '" + mode + "' not found";
-        cout << errorMsg << endl;
+        TRACE(Warning, Profile, errorMsg);
         return false;
     }
 
     // Check if it is the currently active profile
-    if (profileList[index] == currProfile) {
+    if (profileList[position] == currProfile) {
         errorMsg = "Cannot delete the currently active profile";
-        cout << errorMsg << endl;
+        TRACE(Warning, Profile, errorMsg);
+        return false;
+    }
+
+    if (store && !store->remove(mode)) {
+        errorMsg = "Failed to save deletion of profile '" + mode + "'";
+        TRACE(Error, Profile, errorMsg);
         return false;
     }
 
     // Delete the profile
-    delete profileList[index];
-    profileList.erase(profileList.begin() + index);
+    removeAt(position);
+    compactStore();
 
-    cout << "Profile '" << mode << "' deleted successfully" << endl;
+    TRACE(Info, Profile, "Profile '" << mode << "' deleted successfully");
     return true;
 }
 
 // Activate a profile
 bool ProfileManager::activateProfile(const string& mode, string& errorMsg) {
     // Find the profile
-    int index = searchName(mode);
-    if (index == -1) {
+    int position = searchName(mode);
+    if (position == -1) {
         errorMsg = "Profile with name '" + mode + "' not found";
-        cout << errorMsg << endl;
+        TRACE(Warning, Profile, errorMsg);
+        return false;
+    }
+
+    if (store && !store->activate(mode)) {
+        errorMsg = "Failed to save activation of profile '" + mode + "'";
+        TRACE(Error, Profile, errorMsg);
         return false;
     }
 
     // Set the current profile
-    currProfile = profileList[index];
+    currProfile = profileList[position];
+    compactStore();
 
-    cout << "Profile '" << mode << "' activated" << endl;
+    TRACE(Info, Profile, "Profile '" << mode << "' activated");
     return true;
 }
 
 // Check if a profile exists
-bool ProfileManager::profileExists(const string& mode) const {
-    for (const Profile* p : profileList) {
-        if (p->getMode() == mode) {
-            return true;
-        }
-    }
-    return false;
+bool ProfileManager::profileExists(std::string_view mode) const {
+    return index.find(mode) != ProfileIndex::NOT_FOUND;
 }
 
 // Search for a profile index
-int ProfileManager::searchName(const string& mode) {
-    for (size_t i = 0; i < profileList.size(); ++i) {
-        if (profileList[i]->getMode() == mode) {
-            return i;
-        }
-    }
-    return -1;
+int ProfileManager::searchName(std::string_view mode) const {
+    return index.find(mode);
 }
 
 // Validate all profiles
 bool ProfileManager::validateAllProfiles(vector<string>& errorMessages) {
     bool allValid = true;
 
-    for (size_t i = 0; i < profileList.size(); ++i) {
-        Profile* p = profileList[i];
-
-        // Validate basal rate
-        static const float MIN_BASAL_RATE = 0.0f;
-        static const float MAX_BASAL_RATE = 30.0f;
-        if (p->getBasalRate() < MIN_BASAL_RATE || p->getBasalRate() > MAX_BASAL_RATE) {
-            string error = "Profile '" + p->getMode() + "': Invalid basal rate";
-            errorMessages.push_back(error);
-            allValid = false;
+    for (const Profile* p : getProfileList()) {
+        // Every segment of the day is held to the same limits
+        for (const ProfileSegment& s : p->getSegments()) {
+            const float values[ProfileRules::FIELD_COUNT] = {s.basalRate, s.correctionFactor,
+                                                             s.carbohydratesRatio, s.targetGlucoseLevels};
+            for (int f = 0; f < ProfileRules::FIELD_COUNT; ++f) {
+                if (ProfileRules::inRange(static_cast<ProfileRules::Field>(f), values[f])) {
+                    continue;
+                }
+                string label = ProfileRules::RULES[f].label;
+                label[0] = static_cast<char>(tolower(label[0]));
+                string error = "Profile '" + p->getMode() + "': ";
+                if (s.startMinute != 0) {
+                    error += "Segment at minute " + to_string(s.startMinute) + ": ";
+                }
+                errorMessages.push_back(error + "Invalid " + label);
+                allValid = false;
+            }
+        }
+    }
+
+    return allValid;
+}
+
+int ProfileManager::indexOf(const Profile* p) const {
+    if (!p) {
+        return -1;
+    }
+    closeHoles();
+    int position = index.find(p->getMode());
+    return (position != -1 && profileList[position] == p) ? position : -1;
+}
+
+Profile* ProfileManager::profileAt(int index) const {
+    closeHoles();
+    if (index < 0 || index >= static_cast<int>(profileList.size())) {
+        return nullptr;
+    }
+    return profileList[index];
+}
+
+void ProfileManager::saveState(SnapshotWriter& out) const {
+    closeHoles();
+    out.write(static_cast<uint64_t>(profileList.size()));
+    for (const Profile* p : getProfileList()) {
+        p->saveState(out);
+    }
+    out.write(static_cast<int32_t>(indexOf(currProfile)));
+}
+
+bool ProfileManager::restoreState(SnapshotReader& in) {
+    removeAll();
+
+    uint64_t count = 0;
+    if (!in.read(count)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < count && in.isValid(); ++i) {
+        // A profile that does not restore, or repeats a mode, fails the
+        // whole snapshot before the store is touched
+        Profile* p = arena.create("", 0.0f, 0.0f, 0.0f, 0.0f);
+        profileList.push_back(p);
+        if (!p->restoreState(in) || !index.insert(p->getMode(), static_cast<int32_t>(profileList.size() - 1))) {
+            profileList.pop_back();
+            arena.destroy(p);
+            removeAll();
+            return false;
         }
+    }
+
+    int32_t active = -1;
+    in.read(active);
+    currProfile = profileAt(active);
+    if (store && in.isValid()) {
+        store->rewrite(profileList, indexOf(currProfile));
+    }
+    return in.isValid();
+}
 
-        // Validate correction factor
-        static const float MIN_CORRECTION_FACTOR = 1.0f;
-        static const float MAX_CORRECTION_FACTOR = 400.0f;
-        if (p->getCorrectionFactor() < MIN_CORRECTION_FACTOR || p->getCorrectionFactor() > MAX_CORRECTION_FACTOR) {
-            string error = "Profile '" + p->getMode() + "': Invalid correction factor";
-            errorMessages.push_back(error);
-            allValid = false;
+ProfileImportReport ProfileManager::importProfiles(const string& path, ProfileFileFormat format) {
+    ProfileImportReport report;
+    string data;
+    if (!ProfileTransfer::readFile(path, data)) {
+        report.errors.push_back(ProfileImportError{0, ProfileImportError::ReadFailed, 0});
+        TRACE(Error, Profile, "Could not read '" << path << "'");
+        return report;
+    }
+
+    vector<ProfileRows> chunks = ProfileTransfer::parse(data, format, report.errors);
+    size_t rows = 0;
+    for (const ProfileRows& chunk : chunks) {
+        rows += chunk.size();
+        report.errors.insert(report.errors.end(), chunk.errors.begin(), chunk.errors.end());
+    }
+    report.rows = rows;
+    closeHoles();
+    profileList.reserve(profileList.size() + rows);
+    index.reserve(profileList.size() + rows);
+
+    // Rows arrive in file order: a row at minute 0 starts a profile and the
+    // rows after it with the same mode add its segments
+    const size_t firstNew = profileList.size();
+    const Profile* previousActive = currProfile;
+    vector<ProfileSegment> segments;
+    std::string_view mode;
+    uint64_t record = 0;
+    bool failed = true;
+    auto finish = [&]() {
+        if (failed) {
+            return;
+        }
+        if (searchName(mode) != -1) {
+            report.errors.push_back(ProfileImportError{record, ProfileImportError::Duplicate, ProfileImportError::MODE});
+            return;
         }
+        const ProfileSegment& base = segments[0];
+        Profile* p = arena.create(string(mode), base.basalRate, base.correctionFactor,
+                                  base.carbohydratesRatio, base.targetGlucoseLevels);
+        if (segments.size() > 1) {
+            p->setSegments(segments);
+        }
+        addProfile(p);
+    };
+
+    for (const ProfileRows& chunk : chunks) {
+        for (size_t i = 0; i < chunk.size(); ++i) {
+            std::string_view name = chunk.name(i);
+            int32_t start = chunk.startMinutes[i];
+            bool continues = start != 0 && name == mode && record != 0;
+            if (!continues) {
+                finish();
+                segments.clear();
+                mode = name;
+                record = chunk.records[i];
+                failed = false;
+            }
+            if (failed) {
+                continue; // the rest of a rejected profile
+            }
+            if (chunk.invalid[i] != 0) {
+                failed = true; // reported while parsing
+                continue;
+            }
+            if ((start != 0 && !continues) || start < 0 || start >= Profile::MINUTES_PER_DAY
+                    || (continues && start <= segments.back().startMinute)
+                    || segments.size() == static_cast<size_t>(Profile::MAX_SEGMENTS)) {
+                report.errors.push_back(ProfileImportError{chunk.records[i], ProfileImportError::BadSegment,
+                                                           ProfileImportError::START_MINUTE});
+                failed = true;
+                continue;
+            }
+            segments.push_back(ProfileSegment{start, chunk.values[ProfileRules::BasalRate][i],
+                                              chunk.values[ProfileRules::CorrectionFactor][i],
+                                              chunk.values[ProfileRules::CarbohydratesRatio][i],
+                                              chunk.values[ProfileRules::TargetGlucoseLevels][i]});
+        }
+    }
+    finish();
+    report.imported = profileList.size() - firstNew;
 
-        // Validate carbohydrate ratio
-        static const float MIN_CARB_RATIO = 1.0f;
-        static const float MAX_CARB_RATIO = 150.0f;
-        if (p->getCarbohydratesRatio() < MIN_CARB_RATIO || p->getCarbohydratesRatio() > MAX_CARB_RATIO) {
-            string error = "Profile '" + p->getMode() + "': Invalid carbohydrate ratio";
-            errorMessages.push_back(error);
-            allValid = false;
+    // One rewrite saves the whole import; if it fails, nothing was imported
+    if (store && report.imported > 0 && !store->rewrite(profileList, indexOf(currProfile))) {
+        while (profileList.size() > firstNew) {
+            removeAt(static_cast<int>(profileList.size()) - 1);
         }
+        currProfile = const_cast<Profile*>(previousActive);
+        report.imported = 0;
+        report.errors.push_back(ProfileImportError{0, ProfileImportError::SaveFailed, 0});
+    }
+
+    std::stable_sort(report.errors.begin(), report.errors.end(),
+                     [](const ProfileImportError& a, const ProfileImportError& b) { return a.record < b.record; });
+    TRACE(Info, Profile, "Imported " << report.imported << " profiles from '" << path << "' ("
+              << report.errors.size() << " errors)");
+    return report;
+}
+
+bool ProfileManager::exportProfiles(const string& path, ProfileFileFormat format, string& errorMsg) const {
+    if (!ProfileTransfer::writeFile(path, ProfileTransfer::format(getProfileList(), format))) {
+        errorMsg = "Could not write '" + path + "'";
+        TRACE(Error, Profile, errorMsg);
+        return false;
+    }
+    TRACE(Info, Profile, "Exported " << getProfileCount() << " profiles to '" << path << "'");
+    return true;
+}
 
-        // Validate target glucose levels
-        static const float MIN_TARGET_GLUCOSE = 70.0f;
-        static const float MAX_TARGET_GLUCOSE = 180.0f;
-        if (p->getTargetGlucoseLevels() < MIN_TARGET_GLUCOSE || p->getTargetGlucoseLevels() > MAX_TARGET_GLUCOSE) {
-            string error = "Profile '" + p->getMode() + "': Invalid target glucose levels";
-            errorMessages.push_back(error);
-            allValid = false;
+bool ProfileManager::openStore(const string& path, string& errorMsg) {
+    closeStore();
+    removeAll();
+
+    std::unique_ptr<ProfileStore> opened(new ProfileStore());
+    if (!opened->open(path, [this](const ProfileRecord& record) { applyRecord(record); })) {
+        removeAll();
+        errorMsg = "Could not open profile store '" + path + "'";
+        TRACE(Error, Profile, errorMsg);
+        return false;
+    }
+    store = std::move(opened);
+    compactStore();
+
+    TRACE(Info, Profile, "Loaded " << getProfileCount() << " profiles from '" << path << "'");
+    return true;
+}
+
+void ProfileManager::closeStore() {
+    store.reset();
+}
+
+// Replay one stored change; the records were validated when first written
+void ProfileManager::applyRecord(const ProfileRecord& record) {
+    int position = searchName(record.name());
+    switch (record.op) {
+    case ProfileStore::Put:
+        if (position == -1) {
+            addProfile(arena.create(string(record.name()), record.basalRate, record.correctionFactor,
+                                    record.carbohydratesRatio, record.targetGlucoseLevels));
+        } else {
+            profileList[position]->setSettings(record.basalRate, record.correctionFactor,
+                                               record.carbohydratesRatio, record.targetGlucoseLevels);
+        }
+        break;
+    case ProfileStore::Delete:
+        if (position != -1) {
+            if (profileList[position] == currProfile) {
+                currProfile = nullptr;
+            }
+            removeAt(position);
+        }
+        break;
+    case ProfileStore::Activate:
+        if (position != -1) {
+            currProfile = profileList[position];
+        }
+        break;
+    case ProfileStore::Segment:
+        if (position != -1) {
+            Profile* p = profileList[position];
+            ProfileSegment segment{record.startMinute, record.basalRate, record.correctionFactor,
+                                   record.carbohydratesRatio, record.targetGlucoseLevels};
+            vector<ProfileSegment> segments;
+            if (segment.startMinute != 0) {
+                segments = p->getSegments();
+            }
+            segments.push_back(segment);
+            p->setSegments(segments);
         }
+        break;
     }
+}
 
-    return allValid;
+// Fold the journal into a fresh catalog once it has grown long
+void ProfileManager::compactStore() {
+    if (store && store->needsCompaction()) {
+        closeHoles();
+        store->rewrite(profileList, indexOf(currProfile));
+    }
 }
@@ -2,18 +2,60 @@
 #ifndef PROFILEMANAGER_H
 #define PROFILEMANAGER_H
 
+#include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
 #include "profile.h"
+#include "profileArena.h"
+#include "profileIndex.h"
+#include "profileTransfer.h"
+
+class ProfileStore;
+struct ProfileRecord;
+
+// Read-only window onto the manager's profile list, in list order. It
+// copies nothing and is invalidated by the next profile change.
+class ProfileListView {
+    public:
+        ProfileListView(Profile* const* first, size_t count) : first(first), count(count) {}
+
+        Profile* const* begin() const { return first; }
+        Profile* const* end() const { return first + count; }
+        Profile* operator[](size_t i) const { return first[i]; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+    private:
+        Profile* const* first;
+        size_t count;
+};
 
 class ProfileManager {
     private:
-        vector<Profile*> profileList;
+        // Owns every profile; the list and index below only point into it
+        ProfileArena arena;
+        // In list order. A delete leaves a null hole so no other profile
+        // moves; ordered reads squeeze the holes out first, which is why
+        // they are allowed to change the list from const methods.
+        mutable vector<Profile*> profileList;
+        mutable size_t holes = 0;
+        // Name -> position in profileList; every lookup goes through it
+        mutable ProfileIndex index;
+        // When open, every change is written here before it is applied
+        std::unique_ptr<ProfileStore> store;
 
         // Internal helper functions for parameter validation and error checking
         bool validateProfileParams(const string& mode, float basalRate, float correctionFactor,
                                  float carbohydratesRatio, float targetGlucoseLevels, string& errorMsg);
-        bool checkDuplicateName(const string& mode);
+        bool checkDuplicateName(std::string_view mode) const;
+
+        void addProfile(Profile* p);
+        void removeAt(int position);
+        void removeAll();
+        void closeHoles() const;
+        void applyRecord(const ProfileRecord& record);
+        void compactStore();
 
     public:
         // Constructor & Destructor
@@ -22,27 +64,57 @@ class ProfileManager {
         Profile* currProfile = nullptr;
 
         // Getter
-        vector<Profile*> getProfileList() { return profileList; }
+        ProfileListView getProfileList() const {
+            closeHoles();
+            return ProfileListView(profileList.data(), profileList.size());
+        }
 
         // Enhanced CRUD operations - now return success status and provide error messages
         bool createProfile(const string& mode, float basalRate, float correctionFactor,
                          float carbohydratesRatio, float targetGlucoseLevels, string& errorMsg);
 
-        Profile* readProfile(const string& mode);
+        Profile* readProfile(std::string_view mode);
 
         bool updateProfile(const string& mode, float basalRate, float correctionFactor,
                          float carbohydratesRatio, float targetGlucoseLevels, string& errorMsg);
 
+        // Replace a profile's day with time-of-day segments; the first must
+        // start at midnight and its values become the profile's plain values
+        bool setProfileSegments(const string& mode, const vector<ProfileSegment>& segments, string& errorMsg);
+
+        // Profiles after the deleted one keep their order
         bool deleteProfile(const string& mode, string& errorMsg);
 
         // Profile selection and activation
         bool activateProfile(const string& mode, string& errorMsg);
         Profile* getActiveProfile() const { return currProfile; }
 
-        // Search and helper functions
-        int searchName(const string& mode);
-        int getProfileCount() const { return profileList.size(); }
-        bool profileExists(const string& mode) const;
+        // Search and helper functions. A searched position stays valid until
+        // the profiles next change or are read in order.
+        int searchName(std::string_view mode) const;
+        int getProfileCount() const { return static_cast<int>(profileList.size() - holes); }
+        bool profileExists(std::string_view mode) const;
+
+        // Position of a profile in list order (-1 if absent), and the reverse
+        int indexOf(const Profile* p) const;
+        Profile* profileAt(int index) const;
+
+        // Persistent catalog. Opening replaces every profile with the stored
+        // ones; from then on each change is saved before it takes effect.
+        bool openStore(const string& path, string& errorMsg);
+        void closeStore();
+        bool hasStore() const { return store != nullptr; }
+
+        // Bulk files (see ProfileTransfer). Import adds every valid profile in
+        // the file and reports each rejected record; with an open store the
+        // imported profiles are saved together, or not at all.
+        ProfileImportReport importProfiles(const string& path, ProfileFileFormat format);
+        bool exportProfiles(const string& path, ProfileFileFormat format, string& errorMsg) const;
+
+        // Snapshot support; restoring replaces every profile (and rewrites an
+        // open store to match)
+        void saveState(SnapshotWriter& out) const;
+        bool restoreState(SnapshotReader& in);
 
         // Validate all profiles - used for system startup checks
         bool validateAllProfiles(vector<string>& errorMessages);
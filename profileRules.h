@@ -0,0 +1,85 @@
+#ifndef PROFILERULES_H
+#define PROFILERULES_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Limits on profile settings, shared by ProfileManager's checks and bulk
+// import so every path accepts exactly the same profiles. Bulk import runs
+// a column at a time through inRange(), which compiles to vector compares.
+namespace ProfileRules {
+
+    enum Field {
+        BasalRate,
+        CorrectionFactor,
+        CarbohydratesRatio,
+        TargetGlucoseLevels,
+        FIELD_COUNT
+    };
+
+    struct Rule {
+        const char* label;  // in messages
+        const char* column; // CSV header and JSON key
+        float min;
+        float max;
+    };
+
+    constexpr Rule RULES[FIELD_COUNT] = {
+        {"Basal rate", "basalRate", 0.0f, 30.0f},
+        {"Correction factor", "correctionFactor", 1.0f, 400.0f},
+        {"Carbohydrate ratio", "carbohydratesRatio", 1.0f, 150.0f},
+        {"Target glucose levels", "targetGlucoseLevels", 70.0f, 180.0f},
+    };
+
+    // NaN fails both comparisons
+    inline bool inRange(Field field, float value) {
+        return value >= RULES[field].min && value <= RULES[field].max;
+    }
+
+    // Mode names are stored in fixed 40-byte records
+    constexpr size_t MAX_MODE_LENGTH = 40;
+
+    enum NameCheck {
+        NameOk,
+        NameEmpty,
+        NameTooLong,
+        NameControlCharacter // would break one-record-per-line files
+    };
+
+    inline NameCheck checkName(std::string_view mode) {
+        if (mode.empty()) {
+            return NameEmpty;
+        }
+        if (mode.size() > MAX_MODE_LENGTH) {
+            return NameTooLong;
+        }
+        for (unsigned char c : mode) {
+            if (c < 0x20 || c == 0x7F) {
+                return NameControlCharacter;
+            }
+        }
+        return NameOk;
+    }
+
+    inline std::string describeName(NameCheck check) {
+        switch (check) {
+        case NameOk:
+            break;
+        case NameEmpty:
+            return "Mode name cannot be empty";
+        case NameTooLong:
+            return "Mode name cannot be longer than " + std::to_string(MAX_MODE_LENGTH) + " characters";
+        case NameControlCharacter:
+            return "Mode name cannot contain control characters";
+        }
+        return "";
+    }
+
+    inline std::string describeRange(Field field) {
+        return std::string(RULES[field].label) + " must be between " + std::to_string(RULES[field].min)
+               + " and " + std::to_string(RULES[field].max);
+    }
+}
+
+#endif // PROFILERULES_H
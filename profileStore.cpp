@@ -0,0 +1,295 @@
+#include "profileStore.h"
+#include "profile.h"
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char PROFILE_MAGIC[4] = {'I', 'P', 'P', 'S'};
+
+std::string_view ProfileRecord::name() const {
+    size_t length = 0;
+    while (length < sizeof(mode) && mode[length] != '\0') {
+        ++length;
+    }
+    return std::string_view(mode, length);
+}
+
+ProfileStore::ProfileStore() : journal(nullptr), catalogCount(0), journalCount(0) {}
+
+ProfileStore::~ProfileStore() {
+    close();
+}
+
+namespace {
+
+struct CrcTable {
+    uint32_t entries[256];
+
+    CrcTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+}
+
+uint32_t ProfileStore::checksumOf(const ProfileRecord& record) {
+    static const CrcTable table;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&record);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < offsetof(ProfileRecord, checksum); ++i) {
+        crc = table.entries[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+ProfileRecord ProfileStore::makeRecord(Op op, std::string_view mode, float basalRate, float correctionFactor,
+                                       float carbohydratesRatio, float targetGlucoseLevels) {
+    ProfileRecord record;
+    std::memset(&record, 0, sizeof(record));
+    std::memcpy(record.mode, mode.data(), std::min(mode.size(), sizeof(record.mode)));
+    record.basalRate = basalRate;
+    record.correctionFactor = correctionFactor;
+    record.carbohydratesRatio = carbohydratesRatio;
+    record.targetGlucoseLevels = targetGlucoseLevels;
+    record.op = op;
+    record.checksum = checksumOf(record);
+    return record;
+}
+
+bool ProfileStore::open(const std::string& path, const std::function<void(const ProfileRecord&)>& apply) {
+    close();
+    this->path = path;
+
+    std::error_code error;
+    uintmax_t bytes = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+    if (error) {
+        return false;
+    }
+    if (bytes == 0) {
+        // Start a new, empty store
+        return rewrite(std::vector<Profile*>(), -1);
+    }
+
+    uintmax_t validBytes = 0;
+    {
+        QFile file(QString::fromStdString(path));
+        if (!file.open(QIODevice::ReadOnly) || bytes < sizeof(ProfileFileHeader)) {
+            return false;
+        }
+        const uchar* mapping = file.map(0, static_cast<qint64>(bytes));
+        if (!mapping) {
+            return false;
+        }
+
+        ProfileFileHeader header;
+        std::memcpy(&header, mapping, sizeof(header));
+        uintmax_t catalogEnd = sizeof(ProfileFileHeader) + uintmax_t(header.count) * sizeof(ProfileRecord);
+        if (std::memcmp(header.magic, PROFILE_MAGIC, sizeof(PROFILE_MAGIC)) != 0 || header.version != FORMAT_VERSION
+                || header.recordSize != sizeof(ProfileRecord) || catalogEnd > bytes) {
+            return false;
+        }
+
+        // Records are 64-byte aligned in the page-aligned mapping and used in place
+        const ProfileRecord* records = reinterpret_cast<const ProfileRecord*>(mapping + sizeof(ProfileFileHeader));
+        for (uint32_t i = 0; i < header.count; ++i) {
+            if (records[i].checksum != checksumOf(records[i])) {
+                return false; // the catalog is only ever replaced whole
+            }
+        }
+        for (uint32_t i = 0; i < header.count; ++i) {
+            apply(records[i]);
+        }
+        if (header.active >= 0 && static_cast<uint32_t>(header.active) < header.count) {
+            apply(makeRecord(Activate, records[header.active].name()));
+        }
+
+        // Replay the journal up to the first torn or corrupt record or run
+        uintmax_t available = (bytes - catalogEnd) / sizeof(ProfileRecord);
+        uint32_t replayed = 0;
+        while (replayed < available) {
+            uint32_t run = runAt(&records[header.count + replayed], available - replayed);
+            if (run == 0) {
+                break;
+            }
+            for (uint32_t i = 0; i < run; ++i) {
+                apply(records[header.count + replayed + i]);
+            }
+            replayed += run;
+        }
+
+        catalogCount = header.count;
+        journalCount = replayed;
+        validBytes = catalogEnd + uintmax_t(replayed) * sizeof(ProfileRecord);
+    }
+
+    if (validBytes != bytes) {
+        std::filesystem::resize_file(path, validBytes, error);
+        if (error) {
+            return false;
+        }
+    }
+    journal = fopen(path.c_str(), "ab");
+    return journal != nullptr;
+}
+
+void ProfileStore::close() {
+    if (journal) {
+        fclose(journal);
+    }
+    journal = nullptr;
+    catalogCount = 0;
+    journalCount = 0;
+}
+
+bool ProfileStore::put(std::string_view mode, float basalRate, float correctionFactor,
+                       float carbohydratesRatio, float targetGlucoseLevels) {
+    return append(makeRecord(Put, mode, basalRate, correctionFactor, carbohydratesRatio, targetGlucoseLevels));
+}
+
+bool ProfileStore::remove(std::string_view mode) {
+    return append(makeRecord(Delete, mode));
+}
+
+bool ProfileStore::activate(std::string_view mode) {
+    return append(makeRecord(Activate, mode));
+}
+
+static ProfileRecord segmentRecord(const ProfileRecord& base, const ProfileSegment& segment) {
+    ProfileRecord record = base;
+    record.basalRate = segment.basalRate;
+    record.correctionFactor = segment.correctionFactor;
+    record.carbohydratesRatio = segment.carbohydratesRatio;
+    record.targetGlucoseLevels = segment.targetGlucoseLevels;
+    record.startMinute = static_cast<uint16_t>(segment.startMinute);
+    return record;
+}
+
+// A day's Segment records, the midnight one carrying the run's length
+static std::vector<ProfileRecord> segmentRun(const ProfileRecord& base, const std::vector<ProfileSegment>& segments) {
+    std::vector<ProfileRecord> run;
+    run.reserve(segments.size());
+    for (const ProfileSegment& segment : segments) {
+        run.push_back(segmentRecord(base, segment));
+    }
+    if (!run.empty()) {
+        run.front().runLength = static_cast<uint8_t>(run.size());
+    }
+    return run;
+}
+
+uint32_t ProfileStore::runAt(const ProfileRecord* record, uintmax_t available) {
+    if (record->checksum != checksumOf(*record)) {
+        return 0;
+    }
+    if (record->op != Segment || record->startMinute != 0 || record->runLength <= 1) {
+        return 1;
+    }
+    if (record->runLength > available) {
+        return 0;
+    }
+    for (uint32_t i = 1; i < record->runLength; ++i) {
+        const ProfileRecord& next = record[i];
+        if (next.checksum != checksumOf(next) || next.op != Segment || next.startMinute == 0
+                || next.name() != record->name()) {
+            return 0;
+        }
+    }
+    return record->runLength;
+}
+
+bool ProfileStore::setSegments(const Profile& profile) {
+    std::vector<ProfileRecord> run = segmentRun(makeRecord(Segment, profile.getMode()), profile.getSegments());
+    for (ProfileRecord& record : run) {
+        record.checksum = checksumOf(record);
+    }
+    return append(run.data(), run.size());
+}
+
+bool ProfileStore::append(const ProfileRecord& record) {
+    return append(&record, 1);
+}
+
+// Write journal records at once and make them durable before reporting success
+bool ProfileStore::append(const ProfileRecord* records, size_t count) {
+    if (!journal || fwrite(records, sizeof(ProfileRecord), count, journal) != count || fflush(journal) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    bool synced = _commit(_fileno(journal)) == 0;
+#else
+    bool synced = fsync(fileno(journal)) == 0;
+#endif
+    if (synced) {
+        journalCount += static_cast<uint32_t>(count);
+    }
+    return synced;
+}
+
+bool ProfileStore::needsCompaction() const {
+    return journalCount >= std::max(MIN_JOURNAL_RECORDS, catalogCount);
+}
+
+bool ProfileStore::rewrite(const std::vector<Profile*>& profiles, int active) {
+    if (journal) {
+        fclose(journal);
+        journal = nullptr;
+    }
+
+    // QSaveFile writes a temporary and renames it over the old file on
+    // commit, so a crash leaves either the old store or the new one
+    QSaveFile file(QString::fromStdString(path));
+    bool ok = file.open(QIODevice::WriteOnly);
+    if (ok) {
+        ProfileFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, PROFILE_MAGIC, sizeof(PROFILE_MAGIC));
+        header.version = FORMAT_VERSION;
+        header.recordSize = sizeof(ProfileRecord);
+        header.active = -1;
+
+        // Single-segment profiles are one Put; the others are followed by
+        // their segment run
+        std::vector<ProfileRecord> records;
+        records.reserve(profiles.size());
+        for (size_t i = 0; i < profiles.size(); ++i) {
+            const Profile* p = profiles[i];
+            if (static_cast<int>(i) == active) {
+                header.active = static_cast<int32_t>(records.size());
+            }
+            records.push_back(makeRecord(Put, p->getMode(), p->getBasalRate(), p->getCorrectionFactor(),
+                                         p->getCarbohydratesRatio(), p->getTargetGlucoseLevels()));
+            if (p->getSegmentCount() > 1) {
+                for (ProfileRecord& record : segmentRun(makeRecord(Segment, p->getMode()), p->getSegments())) {
+                    record.checksum = checksumOf(record);
+                    records.push_back(record);
+                }
+            }
+        }
+        header.count = static_cast<uint32_t>(records.size());
+        qint64 recordBytes = static_cast<qint64>(records.size() * sizeof(ProfileRecord));
+        ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == static_cast<qint64>(sizeof(header))
+                && (recordBytes == 0 || file.write(reinterpret_cast<const char*>(records.data()), recordBytes) == recordBytes)
+                && file.commit();
+        if (ok) {
+            catalogCount = header.count;
+            journalCount = 0;
+        }
+    }
+
+    journal = fopen(path.c_str(), "ab");
+    return ok && journal != nullptr;
+}
@@ -0,0 +1,108 @@
+#ifndef PROFILESTORE_H
+#define PROFILESTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "profileRules.h"
+
+class Profile;
+
+// One profile as stored on disk. The same record is used for the catalog
+// and for journal entries, where `op` says what happened to the profile.
+struct ProfileRecord {
+    char mode[ProfileRules::MAX_MODE_LENGTH]; // NUL-padded, not terminated at full length
+    float basalRate;
+    float correctionFactor;
+    float carbohydratesRatio;
+    float targetGlucoseLevels;
+    uint8_t op;                 // ProfileStore::Op
+    uint8_t runLength;          // midnight Segment record: records in its day (0 in older files)
+    uint16_t startMinute;       // Segment records: minutes after midnight
+    uint32_t checksum;          // CRC-32 of everything above
+
+    std::string_view name() const;
+};
+static_assert(sizeof(ProfileRecord) == 64, "ProfileRecord is an on-disk format");
+
+// Layout of a profile file: one header, `count` catalog records, then
+// journal records appended by every change since the file was written.
+// Integers are little-endian (the native order of every supported target).
+struct ProfileFileHeader {
+    char magic[4];              // "IPPS"
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t count;
+    int32_t active;             // catalog position of the active profile, or -1
+    uint8_t reserved[44];
+};
+static_assert(sizeof(ProfileFileHeader) == 64, "ProfileFileHeader is an on-disk format");
+
+// Persistent profile catalog. Opening maps the file and replays it record
+// by record, with no text to parse. Each change is one checksummed journal
+// record (or one day's run of Segment records) appended and synced to disk
+// in a single write, so a crash loses at most the change in progress; a
+// torn or corrupt tail, including a partly written run, is cut off on the
+// next open. Once the
+// journal outgrows the catalog the whole file is rewritten to a temporary
+// and renamed over the old one.
+class ProfileStore {
+    public:
+        // Put sets a profile's midnight values. A Segment record starting at
+        // midnight resets the profile's day to that one segment and later
+        // starts add segments, so a day is written as a run of Segments. The
+        // midnight record carries the run's length and a run is replayed
+        // only if all of it is there.
+        enum Op : uint8_t {Put, Delete, Activate, Segment};
+
+        static const uint32_t FORMAT_VERSION = 1;
+        static const size_t MAX_MODE_LENGTH = sizeof(ProfileRecord::mode);
+
+        ProfileStore();
+        ~ProfileStore();
+
+        ProfileStore(const ProfileStore&) = delete;
+        ProfileStore& operator=(const ProfileStore&) = delete;
+
+        // Replay the file at `path` into `apply` (catalog first, as Puts,
+        // Segments and one Activate, then the journal). A missing file becomes an empty
+        // store. Fails if the file exists but is not a profile store.
+        bool open(const std::string& path, const std::function<void(const ProfileRecord&)>& apply);
+        void close();
+        bool isOpen() const { return journal != nullptr; }
+
+        bool put(std::string_view mode, float basalRate, float correctionFactor,
+                 float carbohydratesRatio, float targetGlucoseLevels);
+        bool remove(std::string_view mode);
+        bool activate(std::string_view mode);
+        // Replace a profile's time-of-day segments
+        bool setSegments(const Profile& profile);
+
+        bool needsCompaction() const;
+        // Replace the file with exactly this catalog and an empty journal
+        bool rewrite(const std::vector<Profile*>& profiles, int active);
+
+    private:
+        static ProfileRecord makeRecord(Op op, std::string_view mode, float basalRate = 0.0f, float correctionFactor = 0.0f,
+                                        float carbohydratesRatio = 0.0f, float targetGlucoseLevels = 0.0f);
+        static uint32_t checksumOf(const ProfileRecord& record);
+        // Records replayed together starting at `record`, given `available`
+        // records from there to the end of the file; 0 if the run is torn
+        static uint32_t runAt(const ProfileRecord* record, uintmax_t available);
+        bool append(const ProfileRecord& record);
+        bool append(const ProfileRecord* records, size_t count);
+
+        std::string path;
+        FILE* journal;
+        uint32_t catalogCount;
+        uint32_t journalCount;
+
+        // Journal records tolerated before a rewrite, at least
+        const uint32_t MIN_JOURNAL_RECORDS = 1024;
+};
+
+#endif // PROFILESTORE_H
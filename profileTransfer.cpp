@@ -0,0 +1,879 @@
+#include "profileTransfer.h"
+#include "profileManager.h"
+#include "workStealingPool.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const char* const MODE_COLUMN = "mode";
+const char* const START_COLUMN = "startMinute";
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool isJsonSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && isBlank(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && isBlank(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+std::string_view skipByteOrderMark(std::string_view data) {
+    if (data.size() >= 3 && data.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        data.remove_prefix(3);
+    }
+    return data;
+}
+
+template <class T>
+bool parseNumber(std::string_view text, T& value) {
+    text = trim(text);
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    const char* end = text.data() + text.size();
+    std::from_chars_result result = std::from_chars(text.data(), end, value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+// Where a CSV column or JSON key goes: a ProfileRules::Field, START_MINUTE, MODE, or -1
+int targetOf(std::string_view key) {
+    if (key == MODE_COLUMN) {
+        return ProfileImportError::MODE;
+    }
+    if (key == START_COLUMN) {
+        return ProfileImportError::START_MINUTE;
+    }
+    for (int f = 0; f < ProfileRules::FIELD_COUNT; ++f) {
+        if (key == ProfileRules::RULES[f].column) {
+            return f;
+        }
+    }
+    return -1;
+}
+
+const char* columnName(uint8_t detail) {
+    if (detail < ProfileRules::FIELD_COUNT) {
+        return ProfileRules::RULES[detail].column;
+    }
+    return detail == ProfileImportError::START_MINUTE ? START_COLUMN : MODE_COLUMN;
+}
+
+// Every row gets all columns, so a chunk stays rectangular
+void beginRow(ProfileRows& rows, uint64_t record) {
+    rows.records.push_back(record);
+    rows.nameEnds.push_back(static_cast<uint32_t>(rows.names.size()));
+    rows.startMinutes.push_back(0);
+    for (std::vector<float>& column : rows.values) {
+        column.push_back(0.0f);
+    }
+    rows.invalid.push_back(0);
+}
+
+void failRow(ProfileRows& rows, ProfileImportError::Code code, uint8_t detail) {
+    rows.invalid.back() |= ProfileTransfer::PARSE_FAILED;
+    rows.errors.push_back(ProfileImportError{rows.records.back(), code, detail});
+}
+
+// Check the required columns and the name of a row that parsed
+void finishRow(ProfileRows& rows, unsigned seen) {
+    rows.nameEnds.back() = static_cast<uint32_t>(rows.names.size());
+    if (rows.invalid.back() & ProfileTransfer::PARSE_FAILED) {
+        return;
+    }
+    for (uint8_t target = 0; target <= ProfileImportError::MODE; ++target) {
+        if (target != ProfileImportError::START_MINUTE && !(seen & (1u << target))) {
+            failRow(rows, ProfileImportError::MissingField, target);
+            return;
+        }
+    }
+    ProfileRules::NameCheck check = ProfileRules::checkName(rows.name(rows.size() - 1));
+    if (check != ProfileRules::NameOk) {
+        failRow(rows, ProfileImportError::BadName, static_cast<uint8_t>(check));
+    }
+}
+
+void storeNumber(ProfileRows& rows, int target, std::string_view text) {
+    if (target == ProfileImportError::START_MINUTE) {
+        if (trim(text).empty()) {
+            return; // left blank: the profile's first segment
+        }
+        if (!parseNumber(text, rows.startMinutes.back())) {
+            failRow(rows, ProfileImportError::BadNumber, ProfileImportError::START_MINUTE);
+        }
+    } else if (!parseNumber(text, rows.values[target].back())) {
+        failRow(rows, ProfileImportError::BadNumber, static_cast<uint8_t>(target));
+    }
+}
+
+void appendUtf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+bool isStructural(char c) {
+    return c == '"' || c == '{' || c == '}' || c == '[' || c == ']';
+}
+
+// Position of the quote ending the string that opens at `open`, or the end
+inline size_t closingQuote(std::string_view text, size_t open) {
+    size_t at = open + 1;
+    for (;;) {
+        const void* found = std::memchr(text.data() + at, '"', text.size() - at);
+        if (!found) {
+            return text.size();
+        }
+        at = static_cast<const char*>(found) - text.data();
+        // Escaped if an odd run of backslashes comes before it
+        size_t slashes = 0;
+        while (text[at - 1 - slashes] == '\\') {
+            ++slashes;
+        }
+        if (slashes % 2 == 0) {
+            return at;
+        }
+        ++at;
+    }
+}
+
+// Cursor over one chunk of a JSON file; reads return false on malformed input
+struct JsonReader {
+    std::string_view text;
+    size_t pos;
+
+    void skipSpace() {
+        while (pos < text.size() && isJsonSpace(text[pos])) {
+            ++pos;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool hex4(uint32_t& value) {
+        if (pos + 4 > text.size()) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = text[pos++];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    // A string value, unescaped onto the end of `out`
+    bool string(std::string& out) {
+        if (!consume('"')) {
+            return false;
+        }
+        while (pos < text.size()) {
+            // Copy plain runs in one go
+            size_t run = pos;
+            while (run < text.size() && text[run] != '"' && text[run] != '\\'
+                    && static_cast<unsigned char>(text[run]) >= 0x20) {
+                ++run;
+            }
+            out.append(text.data() + pos, run - pos);
+            pos = run;
+            if (pos >= text.size()) {
+                break;
+            }
+            char c = text[pos++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                return false;
+            }
+            if (pos >= text.size()) {
+                return false;
+            }
+            switch (text[pos++]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t code = 0;
+                if (!hex4(code)) {
+                    return false;
+                }
+                if (code >= 0xD800 && code < 0xDC00) {
+                    uint32_t low = 0;
+                    if (text.compare(pos, 2, "\\u") != 0 || (pos += 2, !hex4(low)) || low < 0xDC00 || low >= 0xE000) {
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // An object key; points into the text unless it has escapes
+    bool key(std::string_view& out, std::string& scratch) {
+        skipSpace();
+        size_t end = pos + 1;
+        while (end < text.size() && text[end] != '"' && text[end] != '\\') {
+            ++end;
+        }
+        if (pos < text.size() && text[pos] == '"' && end < text.size() && text[end] == '"') {
+            out = text.substr(pos + 1, end - pos - 1);
+            pos = end + 1;
+            return true;
+        }
+        scratch.clear();
+        if (!string(scratch)) {
+            return false;
+        }
+        out = scratch;
+        return true;
+    }
+
+    // The text of a number, true/false/null, or any other bare token
+    std::string_view token() {
+        skipSpace();
+        size_t start = pos;
+        while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ']' && !isJsonSpace(text[pos])) {
+            ++pos;
+        }
+        return text.substr(start, pos - start);
+    }
+
+    // Skip a value of a key we do not use, nested or not
+    bool skipValue(std::string& scratch) {
+        skipSpace();
+        if (pos >= text.size()) {
+            return false;
+        }
+        char c = text[pos];
+        if (c == '"') {
+            scratch.clear();
+            return string(scratch);
+        }
+        if (c != '{' && c != '[') {
+            return !token().empty();
+        }
+        return skipToClose(0);
+    }
+
+    // Move past the bracket closing the one at `depth`, minding strings
+    bool skipToClose(int depth) {
+        bool inString = false;
+        for (; pos < text.size(); ++pos) {
+            char c = text[pos];
+            if (inString) {
+                if (c == '\\') ++pos;
+                else if (c == '"') inString = false;
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth <= 0) {
+                ++pos;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+}
+
+std::string ProfileImportError::describe() const {
+    std::string where = record ? "Record " + std::to_string(record) + ": " : std::string();
+    switch (code) {
+    case ReadFailed:
+        return "Could not read the file";
+    case BadHeader:
+        return where + "The header has no '" + columnName(detail) + "' column";
+    case Syntax:
+        return where + "Malformed record";
+    case MissingField:
+        return where + "Missing '" + columnName(detail) + "'";
+    case BadNumber:
+        return where + "'" + columnName(detail) + "' is not a number";
+    case OutOfRange:
+        return where + ProfileRules::describeRange(static_cast<ProfileRules::Field>(detail));
+    case BadName:
+        return where + ProfileRules::describeName(static_cast<ProfileRules::NameCheck>(detail));
+    case BadSegment:
+        return where + "Segments must follow their profile, start at midnight, be in increasing order and number at most "
+               + std::to_string(Profile::MAX_SEGMENTS);
+    case Duplicate:
+        return where + "A profile with this name already exists";
+    case SaveFailed:
+        return "Could not save the imported profiles";
+    }
+    return where + "Unknown error";
+}
+
+bool ProfileTransfer::readFile(const std::string& path, std::string& data) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    bool ok = fseek(file, 0, SEEK_END) == 0;
+    long size = ok ? ftell(file) : -1;
+    ok = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        data.resize(static_cast<size_t>(size));
+        ok = size == 0 || fread(&data[0], 1, data.size(), file) == data.size();
+    }
+    fclose(file);
+    return ok;
+}
+
+bool ProfileTransfer::writeFile(const std::string& path, const std::string& data) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = data.empty() || fwrite(data.data(), 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && ok;
+}
+
+void ProfileTransfer::runChunks(size_t count, unsigned threads, const std::function<void(size_t)>& work) {
+    if (count <= 1 || threads <= 1) {
+        for (size_t k = 0; k < count; ++k) {
+            work(k);
+        }
+        return;
+    }
+    WorkStealingPool pool(static_cast<unsigned>(std::min<size_t>(threads, count)));
+    for (size_t k = 0; k < count; ++k) {
+        pool.submit([&work, k] { work(k); });
+    }
+    pool.wait();
+}
+
+// Chunks of whole lines
+std::vector<ProfileTransfer::Chunk> ProfileTransfer::splitCsv(std::string_view body, size_t chunks) {
+    std::vector<Chunk> out;
+    size_t step = std::max(MIN_CHUNK_BYTES, body.size() / std::max<size_t>(chunks, 1));
+    size_t begin = 0;
+    while (begin < body.size()) {
+        size_t end = begin + step < body.size() ? body.find('\n', begin + step) : std::string_view::npos;
+        end = (end == std::string_view::npos) ? body.size() : end + 1;
+        out.push_back(Chunk{begin, end, 0});
+        begin = end;
+    }
+    return out;
+}
+
+// Chunks of whole objects of the top-level array. Finding object starts
+// needs the string state, so this one pass over the bytes is sequential;
+// everything else about a record is parsed in the chunks.
+std::vector<ProfileTransfer::Chunk> ProfileTransfer::splitJson(std::string_view data, size_t chunks,
+                                                               std::vector<ProfileImportError>& errors) {
+    std::vector<Chunk> out;
+    size_t pos = 0;
+    while (pos < data.size() && isJsonSpace(data[pos])) {
+        ++pos;
+    }
+    if (pos >= data.size() || data[pos] != '[') {
+        errors.push_back(ProfileImportError{0, ProfileImportError::Syntax, 0});
+        return out;
+    }
+
+    size_t step = std::max(MIN_CHUNK_BYTES, (data.size() - pos) / std::max<size_t>(chunks, 1));
+    size_t nextSplit = pos;
+    size_t end = std::string_view::npos;
+    uint64_t objects = 0;
+    int depth = 0;
+    const size_t size = data.size();
+    for (size_t i = pos; i < size && end == std::string_view::npos; ++i) {
+        // Hop between the bytes that matter, and from quote to quote
+        while (i < size && !isStructural(data[i])) {
+            ++i;
+        }
+        if (i >= size) {
+            break;
+        }
+        switch (data[i]) {
+        case '"':
+            i = closingQuote(data, i);
+            break;
+        case '{':
+            if (depth == 1) {
+                if (i >= nextSplit) {
+                    if (!out.empty()) {
+                        out.back().end = i;
+                    }
+                    out.push_back(Chunk{i, i, objects});
+                    nextSplit = i + step;
+                }
+                ++objects;
+            }
+            ++depth;
+            break;
+        case '[':
+            ++depth;
+            break;
+        default: // '}' or ']'
+            if (--depth == 0) {
+                end = i;
+            }
+            break;
+        }
+    }
+
+    if (end == std::string_view::npos) {
+        // Truncated file: keep the records that are complete
+        errors.push_back(ProfileImportError{0, ProfileImportError::Syntax, 0});
+        end = data.size();
+    }
+    if (!out.empty()) {
+        out.back().end = end;
+    }
+    return out;
+}
+
+void ProfileTransfer::parseCsvChunk(std::string_view chunk, const std::vector<int>& columns, ProfileRows& rows,
+                                    uint64_t& lines) {
+    std::string quoted;
+    lines = 0;
+    size_t pos = 0;
+    while (pos < chunk.size()) {
+        size_t eol = chunk.find('\n', pos);
+        if (eol == std::string_view::npos) {
+            eol = chunk.size();
+        }
+        std::string_view line = chunk.substr(pos, eol - pos);
+        pos = eol + 1;
+        uint64_t record = lines++; // made global once every chunk's line count is known
+        if (trim(line).empty()) {
+            continue;
+        }
+
+        beginRow(rows, record);
+        unsigned seen = 0;
+        size_t at = 0;
+        for (size_t column = 0; !(rows.invalid.back() & PARSE_FAILED); ++column) {
+            int target = column < columns.size() ? columns[column] : -1;
+            while (at < line.size() && isBlank(line[at])) {
+                ++at;
+            }
+
+            std::string_view text;
+            bool isQuoted = at < line.size() && line[at] == '"';
+            if (isQuoted) {
+                // "" inside quotes is one quote
+                quoted.clear();
+                bool closed = false;
+                for (++at; at < line.size(); ++at) {
+                    if (line[at] == '"') {
+                        if (at + 1 < line.size() && line[at + 1] == '"') {
+                            quoted += '"';
+                            ++at;
+                            continue;
+                        }
+                        closed = true;
+                        ++at;
+                        break;
+                    }
+                    quoted += line[at];
+                }
+                while (at < line.size() && isBlank(line[at])) {
+                    ++at;
+                }
+                if (!closed || (at < line.size() && line[at] != ',')) {
+                    failRow(rows, ProfileImportError::Syntax, 0);
+                    break;
+                }
+                text = quoted;
+            } else {
+                size_t comma = line.find(',', at);
+                if (comma == std::string_view::npos) {
+                    comma = line.size();
+                }
+                text = trim(line.substr(at, comma - at));
+                at = comma;
+            }
+
+            if (target == ProfileImportError::MODE) {
+                rows.names.append(text.data(), text.size());
+            } else if (target >= 0) {
+                storeNumber(rows, target, text);
+            }
+            if (target >= 0) {
+                seen |= 1u << target;
+            }
+            if (at >= line.size()) {
+                break;
+            }
+            ++at; // the comma
+        }
+        finishRow(rows, seen);
+    }
+}
+
+void ProfileTransfer::parseJsonChunk(std::string_view chunk, uint64_t firstRecord, ProfileRows& rows) {
+    std::string key;
+    JsonReader reader{chunk, 0};
+    uint64_t record = firstRecord;
+    for (;;) {
+        while (reader.pos < chunk.size() && (isJsonSpace(chunk[reader.pos]) || chunk[reader.pos] == ',')) {
+            ++reader.pos;
+        }
+        if (reader.pos >= chunk.size()) {
+            break;
+        }
+
+        if (chunk[reader.pos] != '{') {
+            // Not an object: report it against the next record and skip it
+            rows.errors.push_back(ProfileImportError{record + 1, ProfileImportError::Syntax, 0});
+            size_t before = reader.pos;
+            reader.skipValue(key);
+            reader.pos = std::max(reader.pos, before + 1);
+            continue;
+        }
+        beginRow(rows, ++record);
+        size_t objectStart = reader.pos++;
+
+        unsigned seen = 0;
+        bool ok = true;
+        if (!reader.consume('}')) {
+            do {
+                std::string_view name;
+                ok = reader.key(name, key) && reader.consume(':');
+                if (!ok) {
+                    break;
+                }
+                int target = targetOf(name);
+                if (target == ProfileImportError::MODE) {
+                    reader.skipSpace();
+                    ok = reader.string(rows.names);
+                } else if (target >= 0) {
+                    std::string_view text = reader.token();
+                    storeNumber(rows, target, text);
+                } else {
+                    ok = reader.skipValue(key);
+                }
+                if (target >= 0) {
+                    seen |= 1u << target;
+                }
+            } while (ok && !(rows.invalid.back() & PARSE_FAILED) && reader.consume(','));
+            ok = ok && (rows.invalid.back() & PARSE_FAILED || reader.consume('}'));
+        }
+
+        if (!ok) {
+            failRow(rows, ProfileImportError::Syntax, 0);
+        }
+        if (rows.invalid.back() & PARSE_FAILED) {
+            // Drop any partial name and rescan the object from its start,
+            // where the string state is known, to resume after it
+            rows.names.resize(rows.nameEnds.back());
+            reader.pos = objectStart;
+            reader.skipToClose(0);
+        }
+        finishRow(rows, seen);
+    }
+}
+
+// Check every value column against its rule, a whole column at a time
+void ProfileTransfer::validate(ProfileRows& rows) {
+    const size_t n = rows.size();
+    uint32_t* invalid = rows.invalid.data();
+    for (int f = 0; f < ProfileRules::FIELD_COUNT; ++f) {
+        const ProfileRules::Rule& rule = ProfileRules::RULES[f];
+        const float* values = rows.values[f].data();
+        const uint32_t bit = 1u << f;
+        size_t i = 0;
+
+#if defined(__AVX__)
+        const __m256 lo = _mm256_set1_ps(rule.min);
+        const __m256 hi = _mm256_set1_ps(rule.max);
+        const __m256 flag = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(bit)));
+        for (; i + 8 <= n; i += 8) {
+            __m256 v = _mm256_loadu_ps(&values[i]);
+            __m256 ok = _mm256_and_ps(_mm256_cmp_ps(v, lo, _CMP_GE_OQ), _mm256_cmp_ps(v, hi, _CMP_LE_OQ));
+            __m256 marks = _mm256_loadu_ps(reinterpret_cast<const float*>(&invalid[i]));
+            _mm256_storeu_ps(reinterpret_cast<float*>(&invalid[i]), _mm256_or_ps(marks, _mm256_andnot_ps(ok, flag)));
+        }
+#elif defined(__SSE2__)
+        const __m128 lo = _mm_set1_ps(rule.min);
+        const __m128 hi = _mm_set1_ps(rule.max);
+        const __m128 flag = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(bit)));
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_loadu_ps(&values[i]);
+            __m128 ok = _mm_and_ps(_mm_cmpge_ps(v, lo), _mm_cmple_ps(v, hi));
+            __m128 marks = _mm_loadu_ps(reinterpret_cast<const float*>(&invalid[i]));
+            _mm_storeu_ps(reinterpret_cast<float*>(&invalid[i]), _mm_or_ps(marks, _mm_andnot_ps(ok, flag)));
+        }
+#endif
+        for (; i < n; ++i) {
+            invalid[i] |= ProfileRules::inRange(static_cast<ProfileRules::Field>(f), values[i]) ? 0u : bit;
+        }
+    }
+
+    // Rows that parsed but broke a rule; parse failures were reported already
+    for (size_t i = 0; i < n; ++i) {
+        if (invalid[i] == 0 || (invalid[i] & PARSE_FAILED)) {
+            continue;
+        }
+        for (int f = 0; f < ProfileRules::FIELD_COUNT; ++f) {
+            if (invalid[i] & (1u << f)) {
+                rows.errors.push_back(ProfileImportError{rows.records[i], ProfileImportError::OutOfRange,
+                                                         static_cast<uint8_t>(f)});
+            }
+        }
+    }
+}
+
+std::vector<ProfileRows> ProfileTransfer::parse(std::string_view data, ProfileFileFormat format,
+                                                std::vector<ProfileImportError>& errors, unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t wanted = threads * CHUNKS_PER_THREAD;
+    data = skipByteOrderMark(data);
+    std::vector<ProfileRows> rows;
+
+    if (format == ProfileFileFormat::Json) {
+        std::vector<Chunk> chunks = splitJson(data, wanted, errors);
+        rows.resize(chunks.size());
+        runChunks(chunks.size(), threads, [&](size_t k) {
+            parseJsonChunk(data.substr(chunks[k].begin, chunks[k].end - chunks[k].begin), chunks[k].firstRecord, rows[k]);
+            validate(rows[k]);
+        });
+        return rows;
+    }
+
+    // The header says which column holds what
+    size_t headerEnd = data.find('\n');
+    std::string_view header = data.substr(0, headerEnd);
+    std::vector<int> columns;
+    unsigned seen = 0;
+    size_t at = 0;
+    do {
+        size_t comma = header.find(',', at);
+        std::string_view name = trim(header.substr(at, comma == std::string_view::npos ? std::string_view::npos : comma - at));
+        if (name.size() >= 2 && name.front() == '"' && name.back() == '"') {
+            name = name.substr(1, name.size() - 2);
+        }
+        int target = targetOf(name);
+        if (target >= 0) {
+            if (seen & (1u << target)) {
+                target = -1; // the first of repeated columns wins
+            } else {
+                seen |= 1u << target;
+            }
+        }
+        columns.push_back(target);
+        at = comma == std::string_view::npos ? comma : comma + 1;
+    } while (at != std::string_view::npos);
+    for (uint8_t target = 0; target <= ProfileImportError::MODE; ++target) {
+        if (target != ProfileImportError::START_MINUTE && !(seen & (1u << target))) {
+            errors.push_back(ProfileImportError{1, ProfileImportError::BadHeader, target});
+            return rows;
+        }
+    }
+    if (headerEnd == std::string_view::npos) {
+        return rows;
+    }
+
+    std::string_view body = data.substr(headerEnd + 1);
+    std::vector<Chunk> chunks = splitCsv(body, wanted);
+    std::vector<uint64_t> lines(chunks.size());
+    rows.resize(chunks.size());
+    runChunks(chunks.size(), threads, [&](size_t k) {
+        parseCsvChunk(body.substr(chunks[k].begin, chunks[k].end - chunks[k].begin), columns, rows[k], lines[k]);
+        validate(rows[k]);
+    });
+
+    // Chunk-relative line numbers become file line numbers; the header is line 1
+    uint64_t base = 2;
+    for (size_t k = 0; k < rows.size(); ++k) {
+        for (uint64_t& record : rows[k].records) {
+            record += base;
+        }
+        for (ProfileImportError& error : rows[k].errors) {
+            error.record += base;
+        }
+        base += lines[k];
+    }
+    return rows;
+}
+
+namespace {
+
+void appendNumber(std::string& out, float value) {
+    char text[32];
+    std::to_chars_result result = std::to_chars(text, text + sizeof(text), value); // shortest exact form
+    out.append(text, result.ptr);
+}
+
+void appendNumber(std::string& out, int value) {
+    char text[16];
+    std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+    out.append(text, result.ptr);
+}
+
+void appendCsvName(std::string& out, const std::string& name) {
+    bool needsQuotes = name.find_first_of(",\"") != std::string::npos
+            || (!name.empty() && (isBlank(name.front()) || isBlank(name.back())));
+    if (!needsQuotes) {
+        out += name;
+        return;
+    }
+    out += '"';
+    for (char c : name) {
+        if (c == '"') {
+            out += '"';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+void appendJsonName(std::string& out, const std::string& name) {
+    static const char HEX[] = "0123456789abcdef";
+    out += '"';
+    for (char c : name) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (u < 0x20) {
+            out += "\\u00";
+            out += HEX[u >> 4];
+            out += HEX[u & 0xF];
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void appendProfile(std::string& out, const Profile& p, ProfileFileFormat format, bool first) {
+    for (const ProfileSegment& s : p.getSegments()) {
+        const float values[ProfileRules::FIELD_COUNT] = {s.basalRate, s.correctionFactor,
+                                                         s.carbohydratesRatio, s.targetGlucoseLevels};
+        if (format == ProfileFileFormat::Csv) {
+            appendCsvName(out, p.getMode());
+            out += ',';
+            appendNumber(out, s.startMinute);
+            for (float value : values) {
+                out += ',';
+                appendNumber(out, value);
+            }
+            out += '\n';
+            continue;
+        }
+
+        out += first ? "\n  {\"" : ",\n  {\"";
+        first = false;
+        out += MODE_COLUMN;
+        out += "\": ";
+        appendJsonName(out, p.getMode());
+        out += ", \"";
+        out += START_COLUMN;
+        out += "\": ";
+        appendNumber(out, s.startMinute);
+        for (int f = 0; f < ProfileRules::FIELD_COUNT; ++f) {
+            out += ", \"";
+            out += ProfileRules::RULES[f].column;
+            out += "\": ";
+            appendNumber(out, values[f]);
+        }
+        out += '}';
+    }
+}
+
+}
+
+std::string ProfileTransfer::format(const ProfileListView& profiles, ProfileFileFormat format, unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t chunks = std::max<size_t>(1, std::min(threads * CHUNKS_PER_THREAD, profiles.size() / MIN_CHUNK_PROFILES));
+    size_t perChunk = (profiles.size() + chunks - 1) / chunks;
+
+    std::vector<std::string> parts(chunks);
+    runChunks(chunks, threads, [&](size_t k) {
+        size_t begin = k * perChunk;
+        size_t end = std::min(profiles.size(), begin + perChunk);
+        std::string& out = parts[k];
+        out.reserve((end - begin) * 96);
+        for (size_t i = begin; i < end; ++i) {
+            appendProfile(out, *profiles[i], format, i == 0);
+        }
+    });
+
+    std::string out;
+    size_t total = 64;
+    for (const std::string& part : parts) {
+        total += part.size();
+    }
+    out.reserve(total);
+    if (format == ProfileFileFormat::Csv) {
+        out += MODE_COLUMN;
+        out += ',';
+        out += START_COLUMN;
+        for (const ProfileRules::Rule& rule : ProfileRules::RULES) {
+            out += ',';
+            out += rule.column;
+        }
+        out += '\n';
+    } else {
+        out += '[';
+    }
+    for (const std::string& part : parts) {
+        out += part;
+    }
+    if (format == ProfileFileFormat::Json) {
+        out += profiles.empty() ? "]\n" : "\n]\n";
+    }
+    return out;
+}
@@ -0,0 +1,112 @@
+#ifndef PROFILETRANSFER_H
+#define PROFILETRANSFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "profileRules.h"
+
+class ProfileListView;
+
+enum class ProfileFileFormat {Csv, Json};
+
+// One problem found while importing. Plain data, so collecting errors
+// allocates nothing per row; describe() builds the text when it is shown.
+struct ProfileImportError {
+    enum Code : uint8_t {
+        ReadFailed,     // the file could not be read
+        BadHeader,      // the CSV header lacks a required column
+        Syntax,
+        MissingField,
+        BadNumber,
+        OutOfRange,
+        BadName,        // detail is the ProfileRules::NameCheck
+        BadSegment,     // out of order, outside the day, or too many
+        Duplicate,      // the name is already taken
+        SaveFailed      // the profile store could not be rewritten
+    };
+
+    // `detail` for field errors: a ProfileRules::Field or one of these
+    static constexpr uint8_t START_MINUTE = ProfileRules::FIELD_COUNT;
+    static constexpr uint8_t MODE = ProfileRules::FIELD_COUNT + 1;
+
+    uint64_t record;    // CSV line or JSON object, from 1; 0 for the whole file
+    Code code;
+    uint8_t detail;
+
+    std::string describe() const;
+};
+
+struct ProfileImportReport {
+    size_t rows = 0;        // profile and segment records read
+    size_t imported = 0;    // profiles added
+    std::vector<ProfileImportError> errors; // in file order
+};
+
+// Parsed records of one chunk of a file, one column per field
+struct ProfileRows {
+    std::string names;              // unescaped names, back to back
+    std::vector<uint32_t> nameEnds;
+    std::vector<uint64_t> records;
+    std::vector<int32_t> startMinutes;
+    std::vector<float> values[ProfileRules::FIELD_COUNT];
+    std::vector<uint32_t> invalid;  // nonzero if the row failed to parse or broke a rule
+    std::vector<ProfileImportError> errors;
+
+    size_t size() const { return records.size(); }
+    std::string_view name(size_t row) const {
+        uint32_t begin = row == 0 ? 0 : nameEnds[row - 1];
+        return std::string_view(names).substr(begin, nameEnds[row] - begin);
+    }
+};
+
+// Bulk profile files. A CSV file has a header naming its columns and one
+// row per profile segment:
+//
+//   mode,startMinute,basalRate,correctionFactor,carbohydratesRatio,targetGlucoseLevels
+//
+// A JSON file is an array of flat objects with the same keys. startMinute
+// may be left out; a record starting at minute 0 begins a profile and the
+// records right after it with the same mode add its later segments.
+//
+// Parsing splits the file at record boundaries into chunks handled on a
+// WorkStealingPool, and each chunk is checked against ProfileRules one
+// column at a time. Export formats slices of the list in parallel the same way.
+class ProfileTransfer {
+    public:
+        static bool readFile(const std::string& path, std::string& data);
+        static bool writeFile(const std::string& path, const std::string& data);
+
+        // Chunks come back in file order with global record numbers;
+        // problems with the file as a whole are added to `errors`
+        static std::vector<ProfileRows> parse(std::string_view data, ProfileFileFormat format,
+                                              std::vector<ProfileImportError>& errors, unsigned threads = 0);
+        static std::string format(const ProfileListView& profiles, ProfileFileFormat format, unsigned threads = 0);
+
+        static constexpr uint32_t PARSE_FAILED = 1u << 31; // in ProfileRows::invalid, with one bit per broken rule
+
+    private:
+        struct Chunk {
+            size_t begin;
+            size_t end;
+            uint64_t firstRecord; // JSON: objects before the chunk
+        };
+
+        static std::vector<Chunk> splitCsv(std::string_view body, size_t chunks);
+        static std::vector<Chunk> splitJson(std::string_view data, size_t chunks, std::vector<ProfileImportError>& errors);
+        static void parseCsvChunk(std::string_view chunk, const std::vector<int>& columns, ProfileRows& rows,
+                                  uint64_t& lines);
+        static void parseJsonChunk(std::string_view chunk, uint64_t firstRecord, ProfileRows& rows);
+        static void validate(ProfileRows& rows);
+        static void runChunks(size_t count, unsigned threads, const std::function<void(size_t)>& work);
+
+        // Chunks smaller than this are not worth a thread
+        static constexpr size_t MIN_CHUNK_BYTES = 256 * 1024;
+        static constexpr size_t MIN_CHUNK_PROFILES = 4096;
+        static constexpr size_t CHUNKS_PER_THREAD = 4;
+};
+
+#endif // PROFILETRANSFER_H
@@ -1,10 +1,18 @@
 #include "pump.h"
 #include <iostream>
 #include <ctime>
+#include <algorithm>
+#include <cmath>
+#include "snapshot.h"
 
 // Constructor
 Pump::Pump(ProfileManager* pm, Home* h, Log* l)
-    : profileManager(pm), home(h), log(l), bolus(nullptr), insulinDeliveryActive(false), currentProfile(nullptr), currentGlucoseLevel(120.0f) {
+    : profileManager(pm), home(h), log(l), bolus(nullptr), insulinDeliveryActive(false), currentProfile(nullptr), currentGlucose(GlucoseMgdl::fromWhole(120)),
+      controller(nullptr), tempBasalRate(-1.0f), basalOwed(0.0), minuteOfDay(0), clockSeconds(0) {
+    deliveryScheduler.setHistory(&bolusHistory);
+    glucoseModel = new BergmanMinimalModel();
+    glucoseModel->reset(currentGlucose.toFloat());
+
     // Connect to Home signals for alerts
     if (home) {
         connect(home, &Home::lowBatteryWarning, this, &Pump::handleLowBatteryWarning);
@@ -17,7 +25,9 @@ Pump::Pump(ProfileManager* pm, Home* h, Log* l)
 
 // Destructor
 Pump::~Pump() {
-    // Destructor does not need to delete pointers because they are passed in externally
+    // Profile manager, home and log are passed in externally; the model and bolus are ours
+    bolusPool.destroy(bolus);
+    delete glucoseModel;
 }
 
 // Update to log
@@ -32,13 +42,13 @@ void Pump::powerOn() {
     if (home) {
         home->usePower(); // from Home class
     }
-    updateLog("Pump powered on.");
+    writeLog(LogFormat::PowerOn);
 }
 
 // Power off
 void Pump::powerOff() {
     stopInsulinDelivery();
-    updateLog("Pump powered off.");
+    writeLog(LogFormat::PowerOff);
 }
 
 // battery management
@@ -47,7 +57,7 @@ void Pump::startCharging()
 {
     if (home) {
         home->chargePower();
-        updateLog("[System] Charging started");
+        writeLog(LogFormat::ChargingStarted);
     }
 }
 
@@ -55,7 +65,7 @@ void Pump::stopCharging()
 {
     if (home) {
         home->stopCharging();
-        updateLog("[System] Charging stopped");
+        writeLog(LogFormat::ChargingStopped);
     }
 }
 
@@ -71,7 +81,7 @@ bool Pump::isCharging()
 
 // CGM alert - Related to Requirements 5 and 7
 void Pump::triggerCGMAlert() {
-    updateLog("[Alert] CGM Alert triggered!");
+    writeLog(LogFormat::CgmAlert);
     // Automatically stop insulin delivery when blood glucose is below the threshold
     stopInsulinDelivery();
 }
@@ -82,35 +92,35 @@ void Pump::occlusionAlert() {
         home->checkOcclusion();
     }
     stopInsulinDelivery();
-    updateLog("[Alert] Occlusion Alert triggered! Insulin delivery stopped.");
+    writeLog(LogFormat::OcclusionAlert);
 }
 
 // Start insulin delivery - Requirement 5
 void Pump::startInsulinDelivery() {
     insulinDeliveryActive = true;
-    updateLog("[Pump] Insulin delivery started.");
+    writeLog(LogFormat::DeliveryStarted);
 }
 
 // Stop insulin delivery - Requirement 5
 void Pump::stopInsulinDelivery() {
     insulinDeliveryActive = false;
-    updateLog("[Pump] Insulin delivery stopped.");
+    writeLog(LogFormat::DeliveryStopped);
 }
 
 // Resume insulin delivery - Requirement 5
 void Pump::resumeInsulinDelivery() {
     insulinDeliveryActive = true;
-    updateLog("[Pump] Insulin delivery resumed.");
+    writeLog(LogFormat::DeliveryResumed);
 }
 
 // Deliver bolus insulin - Requirement 4
 void Pump::deliverBolus(float glucoseLevel, float carbIntake) {
     if (!insulinDeliveryActive) {
-        updateLog("[Bolus] Cannot deliver bolus: insulin delivery not active.");
+        writeLog(LogFormat::BolusRejectedInactive);
         return;
     }
     if (!currentProfile) {
-        updateLog("[Bolus] Cannot deliver bolus: no active profile selected.");
+        writeLog(LogFormat::BolusRejectedNoProfile);
         return;
     }
 
@@ -118,109 +128,160 @@ void Pump::deliverBolus(float glucoseLevel, float carbIntake) {
     std::string bolusID = "Bolus-" + std::to_string(time(nullptr));
 
     // Create a new bolus with the current profile
-    Bolus tempBolus(bolusID, glucoseLevel, carbIntake, currentProfile);
+    Bolus* b = newBolus(bolusID, glucoseLevel, carbIntake);
 
     // Calculate the appropriate dose
-    tempBolus.calculateFinalBolus();
-    float calculatedDose = tempBolus.getAppropriateDose();
-    updateLog("[Bolus] Calculated bolus dose: " + std::to_string(calculatedDose) + " units");
+    b->calculateFinalBolus();
+    float calculatedDose = b->getAppropriateDose();
+    writeLog(LogFormat::BolusCalculated, calculatedDose);
+
+    glucoseModel->addCarbs(carbIntake);
+    queueBolus(*b, BolusHistory::Pump);
+    bolusPool.destroy(b);
 
-    updateLog("[Bolus] Bolus delivery confirmed: " + std::to_string(calculatedDose) + " units");
+    writeLog(LogFormat::BolusConfirmed, calculatedDose);
 }
 
 // Exteneded bolus - Requirement 4
 void Pump::deliverExtendedBolus(float glucoseLevel, int duration) {
     if (!insulinDeliveryActive || !currentProfile) {
-        updateLog("[Bolus] Cannot deliver extended bolus: insulin delivery not active or no profile selected.");
+        writeLog(LogFormat::ExtendedBolusRejected);
         return;
     }
 
     // Create a temporary bolus with the current profile
     std::string bolusID = "ExtBolus-" + std::to_string(time(nullptr));
-    Bolus tempBolus(bolusID, glucoseLevel, 0, currentProfile);
+    Bolus* b = newBolus(bolusID, glucoseLevel, 0);
 
     // Calculate the appropriate dose
-    tempBolus.calculateFinalBolus();
+    b->calculateFinalBolus();
 
     // Convert duration from minutes to hours
     int hours = duration / 60;
     if (hours < 1) hours = 1;
 
-    tempBolus.extendedBolus(hours);
+    b->setDeliveryType(Bolus::EXTENDED);
+    b->setExtendedDuration(hours);
+    b->extendedBolus(hours);
+    queueBolus(*b, BolusHistory::Pump);
+    bolusPool.destroy(b);
 
-    updateLog("[Bolus] Extended bolus started for " + std::to_string(duration) + " minutes");
+    writeLog(LogFormat::ExtendedBolusStarted, duration);
 }
 
 // Quick bolus - Requirement 4
 void Pump::deliverQuickBolus(float glucoseLevel, int duration) {
     if (!insulinDeliveryActive || !currentProfile) {
-        updateLog("[Bolus] Cannot deliver quick bolus: insulin delivery not active or no profile selected.");
+        writeLog(LogFormat::QuickBolusRejected);
         return;
     }
 
     // Create a temporary bolus with the current profile
     std::string bolusID = "[Bolus] QuickBolus-" + std::to_string(time(nullptr));
-    Bolus tempBolus(bolusID, glucoseLevel, 0, currentProfile);
+    Bolus* b = newBolus(bolusID, glucoseLevel, 0);
 
     // Calculate the appropriate dose
-    tempBolus.calculateFinalBolus();
+    b->calculateFinalBolus();
 
-    tempBolus.quickBolus();
+    b->setDeliveryType(Bolus::QUICK);
+    b->quickBolus();
+    InsulinUnits quickDose = b->getImmediateDose();
+    queueBolus(*b, BolusHistory::Pump);
+    bolusPool.destroy(b);
 
-    updateLog("[Bolus] Quick bolus delivered");
+    writeLog(LogFormat::QuickBolusDelivered, quickDose.toFloat());
 }
 
 // Pause bolus delivery - Requirement 4
 void Pump::pauseBolus() {
     if (!bolus) {
-        updateLog("[Bolus] No active bolus to pause.");
+        writeLog(LogFormat::PauseNoBolus);
         return;
     }
 
     if (bolus->isActive()) {
         bolus->pauseDelivery();
-        updateLog("[Bolus] Bolus delivery paused.");
+        writeLog(LogFormat::BolusPaused);
     } else if (bolus->isPaused()) {
-        updateLog("[Bolus] Bolus is already paused.");
+        writeLog(LogFormat::BolusAlreadyPaused);
     } else if (bolus->isCanceled()) {
-        updateLog("[Bolus] Cannot pause: Bolus has been canceled.");
+        writeLog(LogFormat::PauseCanceled);
     }
 }
 
 // Resume bolus delivery - Requirement 4
 void Pump::resumeBolus() {
     if (!bolus) {
-        updateLog("[Bolus] No bolus to resume.");
+        writeLog(LogFormat::ResumeNoBolus);
         return;
     }
 
     if (!insulinDeliveryActive) {
-        updateLog("[Bolus] Cannot resume bolus: insulin delivery not active.");
+        writeLog(LogFormat::ResumeInactive);
         return;
     }
 
     if (bolus->isPaused()) {
         bolus->resumeDelivery();
-        updateLog("[Bolus] Bolus delivery resumed.");
+        writeLog(LogFormat::BolusResumed);
     } else if (bolus->isActive()) {
-        updateLog("[Bolus] Bolus is already active.");
+        writeLog(LogFormat::BolusAlreadyActive);
     } else if (bolus->isCanceled()) {
-        updateLog("[Bolus] Cannot resume: Bolus has been canceled.");
+        writeLog(LogFormat::ResumeCanceled);
     }
 }
 
 // Cancel bolus delivery - Requirement 4
 void Pump::cancelBolus() {
     if (!bolus) {
-        updateLog("[Bolus] No active bolus to cancel.");
+        writeLog(LogFormat::CancelNoBolus);
         return;
     }
 
     if (!bolus->isCanceled()) {
         bolus->cancelDelivery();
-        updateLog("[Bolus] Bolus delivery canceled.");
+        writeLog(LogFormat::BolusCanceled);
+    } else {
+        writeLog(LogFormat::BolusAlreadyCanceled);
+    }
+}
+
+void Pump::pauseBolus(uint32_t entry) {
+    // The current bolus's delivery follows the bolus itself
+    if (bolus && deliveryScheduler.sourceOf(entry) == bolus) {
+        pauseBolus();
+    } else if (!deliveryScheduler.isInFlight(entry)) {
+        writeLog(LogFormat::PauseNoBolus);
+    } else if (deliveryScheduler.pauseEntry(entry)) {
+        writeLog(LogFormat::BolusPaused);
+    } else {
+        writeLog(LogFormat::BolusAlreadyPaused);
+    }
+}
+
+void Pump::resumeBolus(uint32_t entry) {
+    if (bolus && deliveryScheduler.sourceOf(entry) == bolus) {
+        resumeBolus();
+    } else if (!deliveryScheduler.isInFlight(entry)) {
+        writeLog(LogFormat::ResumeNoBolus);
+    } else if (!insulinDeliveryActive) {
+        writeLog(LogFormat::ResumeInactive);
+    } else if (deliveryScheduler.resumeEntry(entry)) {
+        writeLog(LogFormat::BolusResumed);
+    } else {
+        writeLog(LogFormat::BolusAlreadyActive);
+    }
+}
+
+void Pump::cancelBolus(uint32_t entry) {
+    if (bolus && deliveryScheduler.sourceOf(entry) == bolus) {
+        cancelBolus();
+    } else if (!deliveryScheduler.isInFlight(entry)) {
+        writeLog(LogFormat::CancelNoBolus);
+    } else if (deliveryScheduler.cancelEntry(entry)) {
+        writeLog(LogFormat::BolusCanceled);
     } else {
-        updateLog("[Bolus] Bolus is already canceled.");
+        writeLog(LogFormat::BolusAlreadyCanceled);
     }
 }
 
@@ -237,7 +298,7 @@ void Pump::createUserProfile(const std::string& mode, float basalRate, float cor
                          float carbRatio, float targetGlucose, std::string& errMsg) {
     if (profileManager) {
         profileManager->createProfile(mode, basalRate, correctionFactor, carbRatio, targetGlucose,errMsg);
-        updateLog("[Profile] Created new profile: " + mode);
+        writeLog(LogFormat::ProfileCreated, mode);
     }
 }
 
@@ -246,13 +307,13 @@ void Pump::switchProfile(const std::string& mode) {
     if (profileManager) {
         Profile* selectedProfile = profileManager->readProfile(mode);
         if (selectedProfile) {
-            currentProfile = selectedProfile;
+            setCurrentProfile(selectedProfile);
             if (home) {
                 home->selectProfile(selectedProfile);
             }
-            updateLog("[Profile] Switched to profile: " + mode);
+            writeLog(LogFormat::ProfileSwitched, mode);
         } else {
-            updateLog("[Profile] Failed to switch to profile: " + mode);
+            writeLog(LogFormat::ProfileSwitchFailed, mode);
         }
     }
 }
@@ -260,23 +321,23 @@ void Pump::switchProfile(const std::string& mode) {
 // Battery alert
 void Pump::handleLowBatteryWarning(float level)
 {
-    updateLog(QString("[Alert] Low battery warning: %1% remaining").arg(level).toStdString());
+    writeLog(LogFormat::LowBattery, level);
 }
 
 void Pump::handleCriticalBatteryWarning(float level)
 {
-    updateLog(QString("[Alert] CRITICAL BATTERY WARNING: %1% remaining").arg(level).toStdString());
-    updateLog("[System] Please connect charger immediately to prevent shutdown");
+    writeLog(LogFormat::CriticalBattery, level);
+    writeLog(LogFormat::ChargeNow);
 }
 
 void Pump::handleLowInsulinWarning(int remaining)
 {
-    updateLog(QString("[Alert] Low insulin warning: %1 units remaining").arg(remaining).toStdString());
+    writeLog(LogFormat::LowInsulin, remaining);
 }
 
 void Pump::emergencyShutdown()
 {
-    updateLog("[System] Emergency shutdown initiated due to critical battery level");
+    writeLog(LogFormat::EmergencyShutdown);
     stopInsulinDelivery();
     if (bolus && !bolus->isCanceled()) {
         cancelBolus();
@@ -284,20 +345,250 @@ void Pump::emergencyShutdown()
     powerOff();;
 }
 
-void Pump::adjustGlucoseLevel(){
-    if(currentProfile->getTargetGlucoseLevels() > home->getGlucoseLevel()){
-        home->setGlucoseLevel(home->getGlucoseLevel() + 0.1);
+// Apply pending pump actions; SimulationEngine calls this before each advance
+void Pump::simulate() {
+    pinProfile();
+
+    // An activated bolus is eaten and handed to the delivery scheduler once
+    if (bolus && bolus->isActive() && !bolus->isDelivered()) {
+        glucoseModel->addCarbs(bolus->getCarbIntake());
+        queueBolus(*bolus, BolusHistory::Manual);
+    }
+
+    // Follow pause/resume/cancel on in-flight deliveries
+    deliveryScheduler.sync(insulinDeliveryActive);
+}
+
+long long Pump::deliverPulse(int planId, long long now) {
+    InsulinUnits units;
+    long long next = deliveryScheduler.deliverPulse(planId, now, insulinDeliveryActive, units);
+    if (units > InsulinUnits()) {
+        deliverInsulin(units);
+    }
+    return next;
+}
+
+long long Pump::deliverBasalPulses(long long now) {
+    // Spans between events add up with rounding, so allow a hair under a pulse
+    const double pulse = DeliveryScheduler::PULSE.toDouble() - BASAL_TOLERANCE;
+    while (basalOwed >= pulse) {
+        deliverInsulin(DeliveryScheduler::PULSE);
+        basalOwed -= DeliveryScheduler::PULSE.toDouble();
     }
-    else if(currentProfile->getTargetGlucoseLevels() < home->getGlucoseLevel()){
-        home->setGlucoseLevel(home->getGlucoseLevel() - 0.1);
+    if (basalOwed < 0.0) {
+        basalOwed = 0.0;
+    }
+    return nextBasalPulse(now);
+}
+
+long long Pump::nextBasalPulse(long long now) const {
+    float rate = getEffectiveBasalRate();
+    if (rate <= 0.0f) {
+        return -1;
+    }
+    double seconds = (DeliveryScheduler::PULSE.toDouble() - basalOwed) * 3600.0 / rate;
+    return now + std::max<long long>(static_cast<long long>(std::ceil(seconds)), 1);
+}
+
+Bolus* Pump::createBolus(const std::string& bolusID, float glucoseLevel, float carbIntake) {
+    clearBolus();
+    bolus = newBolus(bolusID, glucoseLevel, carbIntake);
+    return bolus;
+}
+
+void Pump::clearBolus() {
+    if (bolus) {
+        // Deliveries already under way continue without the old bolus
+        deliveryScheduler.detach(bolus);
+        bolusPool.destroy(bolus);
+        bolus = nullptr;
+    }
+}
+
+Bolus* Pump::newBolus(const std::string& bolusID, float glucoseLevel, float carbIntake) {
+    Bolus* b = bolusPool.create(bolusID, glucoseLevel, carbIntake, currentProfile);
+    b->setMinuteOfDay(minuteOfDay);
+    attachInsulinOnBoard(*b);
+    return b;
+}
+
+void Pump::queueBolus(Bolus& b, BolusHistory::Origin origin) {
+    int hours = b.getExtendedDuration();
+    if (hours < 1) hours = 1;
+    InsulinUnits immediate = b.getImmediateDose();
+    InsulinUnits extended = b.getExtendedDose();
+    uint32_t entry = bolusHistory.add(clockSeconds, InsulinUnits::fromValue(b.getAppropriateDose()),
+                                      DeliveryScheduler::plannedUnits(immediate, extended),
+                                      extended > InsulinUnits() ? hours * 3600 : 0, b.getDeliveryType(), origin);
+
+    // The current bolus's delivery follows its pause/resume/cancel; the
+    // others are controlled through their history entry
+    deliveryScheduler.add(&b == bolus ? &b : nullptr, immediate, extended, hours * 3600, entry);
+    b.markDelivered();
+}
+
+void Pump::deliverInsulin(InsulinUnits units) {
+    glucoseModel->addInsulin(units.toFloat());
+    if (home) {
+        home->recordInsulinDose(units);
+    }
+}
+
+void Pump::attachInsulinOnBoard(Bolus& b) {
+    if (home) {
+        b.setInsulinOnBoardSource(&home->getInsulinOnBoard());
+    }
+}
+
+void Pump::setController(Controller* c) {
+    controller = c;
+    tempBasalRate = -1.0f;
+    if (controller) {
+        controller->reset();
+        writeLog(LogFormat::ControllerEnabled, controller->getName());
+    } else {
+        writeLog(LogFormat::ControllerDisabled);
+    }
+}
+
+// One control step: read the sensor, ask the controller, apply its command
+void Pump::runController(long long now) {
+    if (!controller || !insulinDeliveryActive || !activeVersion) {
+        return;
+    }
+
+    ControllerInput input;
+    input.minutes = now / 60.0;
+    input.glucose = currentGlucose.toFloat();
+    input.insulinOnBoard = home ? home->getIOB() : 0.0f;
+    const ProfileSegment& segment = activeSegment();
+    input.basalRate = segment.basalRate;
+    input.correctionFactor = segment.correctionFactor;
+    input.carbRatio = segment.carbohydratesRatio;
+    input.targetGlucose = segment.targetGlucoseLevels;
+
+    ControllerCommand command = controller->decide(input);
+    setTempBasalRate(command.basalRate);
+
+    // Corrections are rounded down to whole pulses like any other dose
+    InsulinUnits correction = InsulinUnits::fromTicks(BolusRules::deliverableTicks(command.bolusUnits));
+    if (correction >= DeliveryScheduler::PULSE) {
+        uint32_t entry = bolusHistory.add(now, InsulinUnits::fromValue(command.bolusUnits), correction,
+                                          0, Bolus::STANDARD, BolusHistory::Controller);
+        deliveryScheduler.add(nullptr, correction, InsulinUnits(), 0, entry);
+        writeLog(LogFormat::ControllerCorrection, correction.toFloat());
+    }
+}
+
+void Pump::setTempBasalRate(float rate) {
+    if (rate < 0.0f || !activeVersion) {
+        tempBasalRate = -1.0f;
+        return;
+    }
+    tempBasalRate = std::min(rate, activeSegment().basalRate * Controller::MAX_BASAL_MULTIPLE);
+}
+
+float Pump::getEffectiveBasalRate() const {
+    if (!insulinDeliveryActive || !activeVersion) {
+        return 0.0f;
+    }
+    return tempBasalRate >= 0.0f ? tempBasalRate : activeSegment().basalRate;
+}
+
+void Pump::advancePhysiology(double minutes) {
+    basalOwed += getEffectiveBasalRate() * minutes / 60.0;
+    glucoseModel->advance(minutes);
+
+    currentGlucose = GlucoseMgdl::fromValue(glucoseModel->getGlucose());
+    if (home) {
+        home->setGlucoseLevel(currentGlucose);
+    }
+}
+
+void Pump::setCurrentProfile(Profile* p) {
+    currentProfile = p;
+    pinProfile();
+    if (p) {
+        // A well-tuned basal rate holds the patient at the profile target,
+        // for the segment in effect now rather than the midnight one
+        const ProfileSegment& segment = activeSegment();
+        glucoseModel->setEquilibrium(segment.targetGlucoseLevels, segment.basalRate);
+    }
+}
+
+void Pump::setGlucoseModel(GlucoseModel* model) {
+    if (!model || model == glucoseModel) {
+        return;
+    }
+    delete glucoseModel;
+    glucoseModel = model;
+    glucoseModel->reset(currentGlucose.toFloat());
+    if (currentProfile) {
+        std::shared_ptr<const ProfileVersion> version = currentProfile->getVersion();
+        const ProfileSegment& segment = version->segmentAt(minuteOfDay);
+        glucoseModel->setEquilibrium(segment.targetGlucoseLevels, segment.basalRate);
+    }
+}
+
+void Pump::setCurrentGlucoseLevel(float level) {
+    currentGlucose = GlucoseMgdl::fromValue(level);
+    glucoseModel->setGlucose(currentGlucose.toFloat());
+    if (home) {
+        home->setGlucoseLevel(currentGlucose);
     }
 }
 
 float Pump::getCurrentGlucoseLevel() const {
-    return currentGlucoseLevel;
+    return currentGlucose.toFloat();
 }
 
 int Pump::getInsulinDoseRemaining()
 {
     return home ? home->getInsulinDoseRemaining() : 0;
 }
+
+void Pump::saveState(SnapshotWriter& out) const
+{
+    out.write(insulinDeliveryActive);
+    out.write(currentGlucose);
+    out.write(tempBasalRate);
+    out.write(basalOwed);
+    out.write(static_cast<int32_t>(profileManager ? profileManager->indexOf(currentProfile) : -1));
+    glucoseModel->saveState(out);
+    bolusHistory.saveState(out);
+    out.write(bolus != nullptr);
+    if (bolus) {
+        bolus->saveState(out);
+    }
+    deliveryScheduler.saveState(out, std::vector<Bolus*>(1, bolus));
+}
+
+bool Pump::restoreState(SnapshotReader& in)
+{
+    int32_t profileIndex = -1;
+    in.read(insulinDeliveryActive);
+    in.read(currentGlucose);
+    in.read(tempBasalRate);
+    in.read(basalOwed);
+    in.read(profileIndex);
+
+    currentProfile = profileManager ? profileManager->profileAt(profileIndex) : nullptr;
+    pinProfile();
+    if (home) {
+        home->selectProfile(currentProfile);
+    }
+    clearBolus();
+
+    bool hasBolus = false;
+    if (!glucoseModel->restoreState(in) || !bolusHistory.restoreState(in) || !in.read(hasBolus)) {
+        return false;
+    }
+    if (hasBolus) {
+        bolus = bolusPool.create("", 0.0f, 0.0f, nullptr);
+        if (!bolus->restoreState(in)) {
+            return false;
+        }
+        attachInsulinOnBoard(*bolus);
+    }
+    return deliveryScheduler.restoreState(in, std::vector<Bolus*>(1, bolus));
+}
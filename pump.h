@@ -4,6 +4,11 @@
 #include "log.h"
 #include "home.h"
 #include "bolus.h"
+#include "bolusHistory.h"
+#include "bolusPool.h"
+#include "glucoseModel.h"
+#include "deliveryScheduler.h"
+#include "controller.h"
 #include <string>
 #include <QObject>
 #include <QDebug>
@@ -16,12 +21,47 @@ class Pump : public QObject{
     Profile* currentProfile;
     Home* home;
     Log* log;
-    Bolus* bolus;
+    BolusPool bolusPool;
+    Bolus* bolus;               // the bolus the windows control; from bolusPool
+    BolusHistory bolusHistory;  // every bolus queued for delivery
+    GlucoseModel* glucoseModel; // owned
+    DeliveryScheduler deliveryScheduler;
+
 
 
     // following variables are added to manage insulin delivery and bolus
     bool insulinDeliveryActive;
-    float currentGlucoseLevel;
+    GlucoseMgdl currentGlucose; // latest sensor reading
+    Controller* controller; // not owned
+    float tempBasalRate;    // controller override; negative = profile basal
+    double basalOwed;       // basal units accrued since the last basal pulse
+    static constexpr double BASAL_TOLERANCE = 1e-9; // rounding slack on basalOwed, in units
+    int minuteOfDay;        // simulated time of day, selects the profile segment
+    long long clockSeconds; // simulated seconds, stamps history entries
+
+    // The current profile's version as of the last simulate(); the
+    // delivery path reads it without locking while the profile is edited
+    std::shared_ptr<const ProfileVersion> activeVersion;
+    void pinProfile() { activeVersion = currentProfile ? currentProfile->getVersion() : nullptr; }
+
+    // Therapy settings in effect now; requires a current profile
+    const ProfileSegment& activeSegment() const { return activeVersion->segmentAt(minuteOfDay); }
+
+    // Log a predefined message; formatting is deferred until the log is read
+    template <class... Args>
+    void writeLog(LogFormat format, const Args&... args) {
+        if (log) {
+            log->write(format, args...);
+        }
+    }
+
+    // Hand delivered insulin to the patient model and the IOB engine
+    void deliverInsulin(InsulinUnits units);
+    void attachInsulinOnBoard(Bolus& b);
+    // A pooled bolus on the current profile at the current time of day
+    Bolus* newBolus(const std::string& bolusID, float glucoseLevel, float carbIntake);
+    // Record the bolus in the history and hand its doses to the scheduler
+    void queueBolus(Bolus& b, BolusHistory::Origin origin);
 
     public:
     // Constructor
@@ -57,8 +97,30 @@ class Pump : public QObject{
     void pauseBolus();
     void resumeBolus();
     void cancelBolus();
+    // The same for any bolus still being delivered, by its history entry
+    void pauseBolus(uint32_t entry);
+    void resumeBolus(uint32_t entry);
+    void cancelBolus(uint32_t entry);
 
     void simulate();
+    // Advance the patient model over simulated time, accrue basal insulin
+    // at the effective rate and publish glucose to Home
+    void advancePhysiology(double minutes);
+    // Deliver one scheduled pulse; returns the next pulse time or -1
+    long long deliverPulse(int planId, long long now);
+    // Basal goes out in pump pulses like a bolus does. Delivers every whole
+    // pulse accrued so far and returns when the next one is due at the
+    // current rate, or -1 while nothing is being infused.
+    long long deliverBasalPulses(long long now);
+    long long nextBasalPulse(long long now) const;
+
+    // Closed-loop control. The engine calls runController() on every CGM
+    // sample while a controller is attached.
+    void setController(Controller* c);
+    Controller* getController() { return controller; }
+    void runController(long long now);
+    void setTempBasalRate(float rate);
+    float getEffectiveBasalRate() const;
 
     // Profile management - Requirement 3
     void createUserProfile(const std::string& mode, float basalRate, float correctionFactor,
@@ -66,18 +128,40 @@ class Pump : public QObject{
     void switchProfile(const std::string& mode);
 
     ProfileManager* getProfileManager() { return profileManager; }
+    Log* getLog() { return log; }
+
+    // Minutes after midnight; the engine sets this as simulated time passes
+    void setTimeOfDay(int minute) { minuteOfDay = minute; }
+    int getTimeOfDay() const { return minuteOfDay; }
+    void setClock(long long seconds) { clockSeconds = seconds; }
+    long long getClock() const { return clockSeconds; }
 
-    void setCurrentProfile(Profile* p){ this->currentProfile = p; }
+    void setCurrentProfile(Profile* p);
     Profile* getCurrentProfile() { return currentProfile; }
+    const ProfileVersion* getActiveVersion() const { return activeVersion.get(); }
     Bolus* getBolus() {return bolus;}
-    Bolus* setBolus(Bolus* b){  this->bolus = b;  return this->bolus; }
+    // Replace the current bolus with a new one from the pool. Deliveries of
+    // the previous bolus that are under way carry on without it.
+    Bolus* createBolus(const std::string& bolusID, float glucoseLevel, float carbIntake);
+    void clearBolus();
+    const BolusHistory& getBolusHistory() const { return bolusHistory; }
+    DeliveryScheduler& getDeliveryScheduler() { return deliveryScheduler; }
     Home* getHome() {return home;}
     int getInsulinDoseRemaining();
-    void adjustGlucoseLevel();
+
+    // Patient model; the pump takes ownership of a replacement model
+    GlucoseModel* getGlucoseModel() { return glucoseModel; }
+    void setGlucoseModel(GlucoseModel* model);
 
     void setCurrentGlucoseLevel(float level);
     float getCurrentGlucoseLevel() const;
 
+    // Snapshot support. Profile manager, home and log are saved by their
+    // owners; the pump saves its bolus and history and re-links its profile.
+    // An attached controller is not part of the snapshot and must be re-attached.
+    void saveState(SnapshotWriter& out) const;
+    bool restoreState(SnapshotReader& in);
+
     public slots:
     // Alert handling slots
     void handleLowBatteryWarning(float level);
@@ -14,17 +14,18 @@ QBolusWindow::QBolusWindow(Pump* pump, QWidget *parent)
 
 QBolusWindow::~QBolusWindow() {
   delete ui;
-  delete currentBolus;
-  // Do not delete patientProfile or pump — they are managed externally
+  // Do not delete currentBolus, patientProfile or pump — they are managed externally
 }
 
 void QBolusWindow::setPatientProfile(Profile* profile) {
     this->patientProfile = profile;
 
     if (patientProfile) {
-        float targetBG = patientProfile->getTargetGlucoseLevels();
-        float carbRatio = patientProfile->getCarbohydratesRatio();
-        float correctionFactor = patientProfile->getCorrectionFactor();
+        // Show the settings of the segment in effect now
+        const ProfileSegment& segment = patientProfile->segmentAt(pump ? pump->getTimeOfDay() : 0);
+        float targetBG = segment.targetGlucoseLevels;
+        float carbRatio = segment.carbohydratesRatio;
+        float correctionFactor = segment.correctionFactor;
 
         // Optional: Show these in read-only labels for user reference (not required)
         ui->correctionFactor->setPlainText(QString::number(correctionFactor));
@@ -56,30 +57,37 @@ void QBolusWindow::onCalculateBolusClicked() {
        return;
    }
 
-   if (currentBolus) delete currentBolus;
-
-   Bolus* b = new Bolus("B001", glucose, carbs, patientProfile);
-   currentBolus = pump->setBolus(b);
-   pump->getHome()->setGlucoseLevel(glucose);
+   // The pump replaces its bolus with one from its pool; a delivery of the
+   // previous bolus still in progress carries on without it
+   currentBolus = pump->createBolus("B001", glucose, carbs);
+   currentBolus->setProfile(patientProfile);
+   pump->setCurrentGlucoseLevel(glucose);
 
    currentBolus->setCorrectionFactorOverride(correctionFactor);
-   currentBolus->setIOB(5.0f);
    currentBolus->calculateFinalBolus();
 
-   float dose = currentBolus->getAppropriateDose();
+   // Report what the pump gives, which is whole pulses of the calculated dose
+   float dose = currentBolus->getDeliverableDose().toFloat();
 
-   if (dose == 0.0f) {
+   if (currentBolus->getAppropriateDose() == 0.0f) {
        QMessageBox::critical(this, "Calculation Error", "Unable to calculate dose. Check input or profile values.");
        return;
    }
+   if (currentBolus->getDeliverableDose() == InsulinUnits()) {
+       QMessageBox::warning(this, "No Bolus",
+                            QString("The calculated dose of %1 units is less than one pump pulse; nothing will be delivered.")
+                            .arg(currentBolus->getAppropriateDose(), 0, 'f', 2));
+       return;
+   }
 
    if (ui->quickBolus->isChecked()) {
-       float quickDose = 0.6f * dose;
        currentBolus->quickBolus();
+       float quickDose = currentBolus->getImmediateDose().toFloat();
        ui->resultLabel->setText(QString("Quick Bolus: %1 units delivered immediately.").arg(quickDose, 0, 'f', 2));
    }
    else if (ui->extendedBolus->isChecked()) {
-       float extendedDose = 0.4f * dose;
+       currentBolus->setDeliveryType(Bolus::EXTENDED);
+       float extendedDose = currentBolus->getExtendedDose().toFloat();
 
        int hours = ui->extendedTimeInput->value();
 
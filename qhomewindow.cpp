@@ -4,7 +4,7 @@
 #include <QTextEdit>
 #include <QVBoxLayout>
 
-QHomeWindow::QHomeWindow(Pump* pump, QWidget *parent) : QWidget(parent), pump(pump) {
+QHomeWindow::QHomeWindow(Pump* pump, RealTimePacer* pacer, QWidget *parent) : QWidget(parent), pacer(pacer), pump(pump) {
     bolusButton = new QPushButton("Bolus", this);
     optionsButton = new QPushButton("Options", this);
     occlusionAlertButton = new QPushButton("Occlusion Alert", this);
@@ -61,11 +61,10 @@ QHomeWindow::QHomeWindow(Pump* pump, QWidget *parent) : QWidget(parent), pump(pu
     layout->addWidget(chartView);
     setLayout(layout);
 
-    timer = new QTimer(this);
-    connect(timer, &QTimer::timeout, this, &QHomeWindow::updateSim);
-    connect(timer, &QTimer::timeout, this, &QHomeWindow::updateBatteryDisplay);
-    connect(timer, &QTimer::timeout, this, &QHomeWindow::updateInsulinDisplay);
-    timer->start(1000);
+    // The pacer advances the simulation each second; we only refresh views
+    connect(pacer, &RealTimePacer::advanced, this, &QHomeWindow::updateSim);
+    connect(pacer, &RealTimePacer::advanced, this, &QHomeWindow::updateBatteryDisplay);
+    connect(pacer, &RealTimePacer::advanced, this, &QHomeWindow::updateInsulinDisplay);
 
     // Connect buttons to slots (navigation)
     connect(bolusButton, &QPushButton::clicked, this, &QHomeWindow::navBolus);
@@ -112,12 +111,10 @@ void QHomeWindow::navOptions() {
 }
 
 void QHomeWindow::updateSim() {
-    pump->getHome()->checkBatteryAlert();
-    pump->getHome()->checkInsulinRemainingAlert();
+    // Alerts and the glucose model now run inside SimulationEngine
     if(pump->getBolus() != nullptr)
      if(pump->getBolus()->isActive()){
          series->append(timeStep,pump->getHome()->getGlucoseLevel());
-         pump->adjustGlucoseLevel();
          timeStep++;
       if (timeStep > 60) {
          series->remove(0);
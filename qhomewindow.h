@@ -8,12 +8,13 @@
 #include <QtCharts/QScatterSeries>
 #include "qerrormessage.h"
 #include "qpersonalprofiles.h"
+#include "realTimePacer.h"
 
 
 class QHomeWindow : public QWidget {
     Q_OBJECT
 public:
-    explicit QHomeWindow(Pump* pump, QWidget *parent = nullptr);
+    explicit QHomeWindow(Pump* pump, RealTimePacer* pacer, QWidget *parent = nullptr);
 
 signals:
     void navBolusRequested();
@@ -40,7 +41,7 @@ private:
     QScatterSeries *series;
     QPushButton *occlusionAlertButton;
     QPushButton  *CGMAlertButton;
-    QTimer *timer;
+    RealTimePacer *pacer;
     int timeStep = 0;
     QPushButton *startDeliveryButton;
     QPushButton *pauseDeliveryButton;
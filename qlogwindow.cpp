@@ -1,6 +1,69 @@
 #include "qlogwindow.h"
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QVBoxLayout>
 
 QLogWindow::QLogWindow(Pump* pump, QWidget *parent) : QMainWindow(parent), pump(pump){
     homeButton = new QPushButton("Home", this);
-    log = new QLabel(this);
+    categoryBox = new QComboBox(this);
+    followBox = new QCheckBox("Follow", this);
+    table = new QTableView(this);
+    model = new LogTableModel(pump->getLog(), this);
+    refreshTimer = new QTimer(this);
+
+    categoryBox->addItem("All", LogTableModel::ALL_CATEGORIES);
+    for (int c = 0; c < LogFormats::CATEGORY_COUNT; ++c) {
+        categoryBox->addItem(LogTableModel::categoryName(static_cast<LogCategory>(c)), c);
+    }
+    followBox->setChecked(true);
+
+    // Fixed row heights let the view place any row without measuring the
+    // ones above it, which keeps scrolling cheap with millions of rows
+    table->setModel(model);
+    table->setWordWrap(false);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->verticalHeader()->hide();
+    table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    table->verticalHeader()->setDefaultSectionSize(table->fontMetrics().height() + 4);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    table->horizontalHeader()->setStretchLastSection(true);
+
+    QHBoxLayout *controls = new QHBoxLayout();
+    controls->addWidget(homeButton);
+    controls->addWidget(categoryBox);
+    controls->addWidget(followBox);
+
+    QWidget *central = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(central);
+    layout->addLayout(controls);
+    layout->addWidget(table);
+    setCentralWidget(central);
+
+    connect(homeButton, &QPushButton::clicked, this, &QLogWindow::onHomeButtonClicked);
+    connect(categoryBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &QLogWindow::onCategoryChanged);
+    connect(refreshTimer, &QTimer::timeout, this, &QLogWindow::refreshLog);
+    refreshTimer->start(REFRESH_MS);
+}
+
+void QLogWindow::onHomeButtonClicked() {
+    emit navHomeRequested();
+}
+
+void QLogWindow::onCategoryChanged(int index) {
+    model->setCategoryFilter(categoryBox->itemData(index).toInt());
+    if (followBox->isChecked()) {
+        table->scrollToBottom();
+    }
+}
+
+void QLogWindow::refreshLog() {
+    // Nothing to draw while another page is showing
+    if (!isVisible()) {
+        return;
+    }
+    int before = model->rowCount();
+    model->refresh();
+    if (followBox->isChecked() && model->rowCount() != before) {
+        table->scrollToBottom();
+    }
 }
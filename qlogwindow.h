@@ -3,19 +3,38 @@
 
 #include <QMainWindow>
 #include <QPushButton>
-#include <QLabel>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QTableView>
+#include <QTimer>
 
 #include "pump.h"
+#include "logTableModel.h"
 
 class QLogWindow : public QMainWindow {
     Q_OBJECT
 public:
     explicit QLogWindow(Pump* pump, QWidget *parent = nullptr);
 
+signals:
+    void navHomeRequested();
+
+private slots:
+    void onHomeButtonClicked();
+    void onCategoryChanged(int index);
+    void refreshLog();
+
 private:
     QPushButton *homeButton;
-    QLabel *log;
+    QComboBox *categoryBox;
+    QCheckBox *followBox;
+    QTableView *table;
+    LogTableModel *model;
+    QTimer *refreshTimer;
     Pump* pump;
+
+    // New entries are picked up at this interval
+    const int REFRESH_MS = 100;
 };
 
 #endif // QLOGWINDOW_H
@@ -8,6 +8,7 @@ QOptionsMenu::QOptionsMenu(Pump* pump, QWidget *parent) : QWidget(parent), ui(ne
     connect(ui->homeButton, &QPushButton::clicked, this, &QOptionsMenu::onHomeButtonClicked);
     connect(ui->powerOffButton, &QPushButton::clicked, this, &QOptionsMenu::onPowerOffClicked);
     connect(ui->createButton, &QPushButton::clicked, this, &QOptionsMenu::onCreateClicked);
+    connect(ui->logButton, &QPushButton::clicked, this, &QOptionsMenu::onLogClicked);
 }
 
 QOptionsMenu::~QOptionsMenu() {
@@ -26,3 +27,7 @@ void QOptionsMenu::onPowerOffClicked() {
 void QOptionsMenu::onCreateClicked() {
     emit navPersonalRequested();
 }
+
+void QOptionsMenu::onLogClicked() {
+    emit navLogRequested();
+}
@@ -17,11 +17,13 @@ public:
 signals:
     void navHomeRequested();
     void navPersonalRequested();
+    void navLogRequested();
 
 private slots:
     void onHomeButtonClicked();
     void onPowerOffClicked();
     void onCreateClicked();
+    void onLogClicked();
 
 private:
     Ui::OptionsMenu *ui;
@@ -1,5 +1,7 @@
 #include "qpersonalprofiles.h"
 #include "ui_personalprofiles.h"
+#include <QFileDialog>
+#include "trace.h"
 
 QPersonalProfiles::QPersonalProfiles(Pump* pump, QWidget *parent) : QWidget(parent), ui(new Ui::PersonalProfiles), pump(pump) {
    ui->setupUi(this);
@@ -19,6 +21,10 @@ QPersonalProfiles::QPersonalProfiles(Pump* pump, QWidget *parent) : QWidget(pare
    // Delete a profile
    connect(ui->deleteButton, &QPushButton::clicked, this, &QPersonalProfiles::deleteProfile);
 
+   // Bulk import and export
+   connect(ui->importButton, &QPushButton::clicked, this, &QPersonalProfiles::importProfiles);
+   connect(ui->exportButton, &QPushButton::clicked, this, &QPersonalProfiles::exportProfiles);
+
 }
 
 QPersonalProfiles::~QPersonalProfiles() {
@@ -44,13 +50,13 @@ void QPersonalProfiles::createProfile(){
    float targetFlt = Qtarget.toFloat();
 
    if(targetFlt == 0 || carbsFlt == 0 || correctionFlt == 0 || basalFlt == 0 || pump->getProfileManager()->searchName(nameStr) != -1 || nameStr.length() == 0){
-       cout << "No profile created. Invalid inputs" << endl;
+       TRACE(Warning, Ui, "No profile created. Invalid inputs");
    } else {
        std::string errorMsg;
        if (pump->getProfileManager()->createProfile(nameStr, basalFlt, correctionFlt, carbsFlt, targetFlt, errorMsg)) {
               listProfiles();
           } else {
-              cout << "Failed to create profile: " << errorMsg << endl;
+              TRACE(Warning, Ui, "Failed to create profile: " << errorMsg);
           }
 
    }
@@ -73,7 +79,7 @@ void QPersonalProfiles::readProfile(){
        pump->setCurrentProfile(p);
 
    } else {
-       cout << "no profiles with name " << selectStr << endl;
+       TRACE(Warning, Ui, "no profiles with name " << selectStr);
    }
 }
 
@@ -97,18 +103,18 @@ void QPersonalProfiles::updateProfile(){
        float targetFlt = Qtarget.toFloat();
 
        if(targetFlt == 0 || carbsFlt == 0 || correctionFlt == 0 || basalFlt == 0){
-           cout << "No profile updated. Invalid inputs" << endl;
+           TRACE(Warning, Ui, "No profile updated. Invalid inputs");
        } else {
               std::string errorMsg; // Create error message variable
               if (pump->getProfileManager()->updateProfile(nameStr, basalFlt, correctionFlt, carbsFlt, targetFlt, errorMsg)) {
                   listProfiles();
-                  cout << "Profile " << selectStr << " updated" << endl;
+                  TRACE(Info, Ui, "Profile " << selectStr << " updated");
               } else {
-                  cout << "Failed to update profile: " << errorMsg << endl;
+                  TRACE(Warning, Ui, "Failed to update profile: " << errorMsg);
               }
           }
       }else {
-      cout << "Profile not found" << endl;
+      TRACE(Warning, Ui, "Profile not found");
    }
 }
 
@@ -121,14 +127,45 @@ void QPersonalProfiles::deleteProfile(){
       if (pump->getProfileManager()->deleteProfile(selectStr, errorMsg)) {
           listProfiles();
       } else {
-          cout << "Failed to delete profile: " << errorMsg << endl;
+          TRACE(Warning, Ui, "Failed to delete profile: " << errorMsg);
       }
 }
 
+static ProfileFileFormat formatOf(const QString& path) {
+   return path.endsWith(".json", Qt::CaseInsensitive) ? ProfileFileFormat::Json : ProfileFileFormat::Csv;
+}
+
+void QPersonalProfiles::importProfiles() {
+   QString path = QFileDialog::getOpenFileName(this, "Import Profiles", QString(), "Profiles (*.csv *.json)");
+   if (path.isEmpty()) {
+       return;
+   }
+
+   ProfileImportReport report = pump->getProfileManager()->importProfiles(path.toStdString(), formatOf(path));
+   // Only the first few problems are worth printing for a large file
+   const size_t MAX_SHOWN = 20;
+   for (size_t i = 0; i < report.errors.size() && i < MAX_SHOWN; ++i) {
+       TRACE(Warning, Ui, report.errors[i].describe());
+   }
+   listProfiles();
+}
+
+void QPersonalProfiles::exportProfiles() {
+   QString path = QFileDialog::getSaveFileName(this, "Export Profiles", QString(), "CSV (*.csv);;JSON (*.json)");
+   if (path.isEmpty()) {
+       return;
+   }
+
+   std::string errorMsg;
+   if (!pump->getProfileManager()->exportProfiles(path.toStdString(), formatOf(path), errorMsg)) {
+       TRACE(Error, Ui, "Failed to export profiles: " << errorMsg);
+   }
+}
+
 void QPersonalProfiles::listProfiles() {
    QString profileListText;
 
-   for (Profile* p : pump->getProfileManager()->getProfileList()) {
+   for (const Profile* p : pump->getProfileManager()->getProfileList()) {
        profileListText += QString::fromStdString(p->getMode()) + ", ";
    }
 
@@ -26,6 +26,10 @@ private slots:
     void updateProfile();
     void deleteProfile();
 
+    // Bulk CSV/JSON files, picked by extension
+    void importProfiles();
+    void exportProfiles();
+
     void listProfiles();
 
 private:
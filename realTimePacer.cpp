@@ -0,0 +1,30 @@
+#include "realTimePacer.h"
+
+RealTimePacer::RealTimePacer(SimulationEngine* engine, QObject *parent)
+    : QObject(parent), engine(engine), timer(new QTimer(this)), speed(1)
+{
+    connect(timer, &QTimer::timeout, this, &RealTimePacer::onTimeout);
+}
+
+void RealTimePacer::start()
+{
+    timer->start(TICK_INTERVAL_MS);
+}
+
+void RealTimePacer::stop()
+{
+    timer->stop();
+}
+
+void RealTimePacer::setSpeed(int simSecondsPerTick)
+{
+    speed = (simSecondsPerTick < 1) ? 1 : simSecondsPerTick;
+}
+
+void RealTimePacer::onTimeout()
+{
+    if (engine) {
+        engine->advance(speed);
+    }
+    emit advanced();
+}
@@ -0,0 +1,37 @@
+#ifndef REALTIMEPACER_H
+#define REALTIMEPACER_H
+
+#include <QObject>
+#include <QTimer>
+#include "simulationEngine.h"
+
+// Drives a SimulationEngine from a wall-clock QTimer so the GUI sees the
+// simulation progress in real time (or at a fixed speed-up).
+class RealTimePacer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit RealTimePacer(SimulationEngine* engine, QObject *parent = nullptr);
+
+    void start();
+    void stop();
+
+    // Simulated seconds advanced per wall-clock tick (1 = real time)
+    void setSpeed(int simSecondsPerTick);
+    int getSpeed() const { return speed; }
+
+signals:
+    void advanced(); // emitted after every tick so views can refresh
+
+private slots:
+    void onTimeout();
+
+private:
+    SimulationEngine* engine;
+    QTimer *timer;
+    int speed;
+
+    const int TICK_INTERVAL_MS = 1000;
+};
+
+#endif // REALTIMEPACER_H
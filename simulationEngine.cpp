@@ -0,0 +1,268 @@
+#include "simulationEngine.h"
+#include <algorithm>
+#include "pump.h"
+#include "homeRules.h"
+#include "snapshot.h"
+
+SimulationEngine::SimulationEngine(Pump* pump)
+    : pump(pump), startTime(QDateTime::currentDateTime()), startSecondOfDay(0), elapsedSeconds(0),
+      batteryEvent(0), batteryEventTime(-1), reminderEvent(0), cgmEvent(0), basalEvent(0), basalEventTime(-1), eventsProcessed(0) {
+    setStartTime(startTime);
+}
+
+void SimulationEngine::setStartTime(const QDateTime& start) {
+    startTime = start;
+    startSecondOfDay = start.time().msecsSinceStartOfDay() / 1000;
+    if (pump) {
+        pump->setTimeOfDay(minuteOfDayAt(elapsedSeconds));
+        pump->setClock(elapsedSeconds);
+    }
+}
+
+QDateTime SimulationEngine::getCurrentTime() const {
+    return startTime.addSecs(elapsedSeconds);
+}
+
+void SimulationEngine::setSampleListener(SampleListener listener) {
+    sampleListener = std::move(listener);
+    scheduleCgmSample();
+}
+
+void SimulationEngine::advance(long long seconds) {
+    if (seconds <= 0) {
+        return;
+    }
+    long long target = elapsedSeconds + seconds;
+
+    if (pump) {
+        // Pick up anything the user did since the last call
+        pump->simulate();
+        scheduleDeliveryWakeups();
+        scheduleStateEvents();
+    }
+
+    // Jump from event to event instead of ticking through idle time
+    SimEvent event;
+    while (events.popNext(target, event)) {
+        advanceTo(event.time);
+        dispatch(event);
+        ++eventsProcessed;
+    }
+    advanceTo(target);
+}
+
+void SimulationEngine::advanceTo(long long time) {
+    if (time <= elapsedSeconds) {
+        return;
+    }
+
+    long long minutes = time / HOME_TICK_SECONDS - elapsedSeconds / HOME_TICK_SECONDS;
+    long long from = elapsedSeconds;
+    elapsedSeconds = time;
+
+    if (!pump) {
+        return;
+    }
+    if (pump->getLog()) {
+        // Events logged from here on carry simulated time
+        pump->getLog()->setEventTime(startTime.toMSecsSinceEpoch() + elapsedSeconds * 1000);
+    }
+    if (minutes > 0 && pump->getHome()) {
+        pump->getHome()->advanceMinutes(minutes, getCurrentTime());
+    }
+
+    // The patient model integrates the span in one adaptive call per basal
+    // segment it crosses
+    const ProfileVersion* profile = pump->getActiveVersion();
+    while (from < time) {
+        int minute = minuteOfDayAt(from);
+        long long until = time;
+        if (profile && profile->getSegmentCount() > 1) {
+            long long segmentEnd = ((startSecondOfDay + from) / 60 + profile->segmentEnd(minute) - minute) * 60
+                                   - startSecondOfDay;
+            until = std::min(time, segmentEnd);
+        }
+        pump->setTimeOfDay(minute);
+        pump->advancePhysiology((until - from) / 60.0);
+        from = until;
+    }
+    pump->setTimeOfDay(minuteOfDayAt(time));
+    pump->setClock(time);
+}
+
+void SimulationEngine::dispatch(const SimEvent& event) {
+    Home* home = pump ? pump->getHome() : nullptr;
+    if (!home) {
+        return;
+    }
+
+    switch (event.type) {
+    case SimEventType::BatteryThreshold:
+        batteryEvent = 0;
+        batteryEventTime = -1;
+        home->raiseAlerts();
+        scheduleBatteryThreshold();
+        scheduleAlertReminder();
+        break;
+
+    case SimEventType::BolusPulse: {
+        long long next = pump->deliverPulse(event.payload, elapsedSeconds);
+        if (next >= 0) {
+            events.schedule(next, SimEventType::BolusPulse, event.payload);
+        }
+        scheduleAlertReminder(); // the reservoir may have dropped below the low level
+        break;
+    }
+
+    case SimEventType::AlertReminder:
+        reminderEvent = 0;
+        if (home->isBatteryLow() || home->isInsulinLow()) {
+            home->raiseAlerts();
+            scheduleAlertReminder();
+        }
+        break;
+
+    case SimEventType::CgmSample:
+        cgmEvent = 0;
+        if (sampleListener) {
+            sampleListener(elapsedSeconds);
+        }
+        pump->runController(elapsedSeconds);
+        scheduleDeliveryWakeups(); // automatic corrections start pulsing now
+        scheduleCgmSample();
+        scheduleBasalPulse(pump->nextBasalPulse(elapsedSeconds)); // the temp basal may have changed
+        break;
+
+    case SimEventType::BasalPulse:
+        basalEvent = 0;
+        basalEventTime = -1;
+        scheduleBasalPulse(pump->deliverBasalPulses(elapsedSeconds));
+        scheduleAlertReminder();
+        break;
+    }
+}
+
+// New or resumed deliveries get their next pulse right away
+void SimulationEngine::scheduleDeliveryWakeups() {
+    for (int planId : pump->getDeliveryScheduler().takeWakeups()) {
+        events.schedule(elapsedSeconds, SimEventType::BolusPulse, planId);
+    }
+}
+
+void SimulationEngine::scheduleStateEvents() {
+    scheduleBatteryThreshold();
+    scheduleAlertReminder();
+    scheduleCgmSample();
+    scheduleBasalPulse(pump->nextBasalPulse(elapsedSeconds));
+}
+
+// The pulse time is recomputed whenever the rate may have changed; a change
+// of profile segment between pulses is caught up at the next one
+void SimulationEngine::scheduleBasalPulse(long long next) {
+    if (next == basalEventTime) {
+        return;
+    }
+    events.cancel(basalEvent);
+    basalEvent = (next >= 0) ? events.schedule(next, SimEventType::BasalPulse) : 0;
+    basalEventTime = next;
+}
+
+// Samples fall on a fixed five-minute grid only while someone listens
+void SimulationEngine::scheduleCgmSample() {
+    if (!pump || (!pump->getController() && !sampleListener)) {
+        events.cancel(cgmEvent);
+        cgmEvent = 0;
+        return;
+    }
+    if (cgmEvent != 0) {
+        return;
+    }
+    long long next = (elapsedSeconds / CGM_SAMPLE_SECONDS + 1) * CGM_SAMPLE_SECONDS;
+    cgmEvent = events.schedule(next, SimEventType::CgmSample);
+}
+
+// Battery drains linearly between events, so the minute it crosses the next
+// alert level can be computed directly instead of polled for
+// Called after every advance; the queue is only touched when the crossing
+// time moves (the GUI charged the pump or changed the level), so steady
+// drain leaves no cancelled entries behind
+void SimulationEngine::scheduleBatteryThreshold() {
+    long long next = batteryThresholdTime();
+    if (next == batteryEventTime) {
+        return;
+    }
+    events.cancel(batteryEvent);
+    batteryEvent = (next >= 0) ? events.schedule(next, SimEventType::BatteryThreshold) : 0;
+    batteryEventTime = next;
+}
+
+long long SimulationEngine::batteryThresholdTime() const {
+    Home* home = pump ? pump->getHome() : nullptr;
+    if (!home || home->getCharging()) {
+        return -1;
+    }
+
+    float battery = home->getBatteryLevel();
+    float level;
+    bool inclusive;
+    if (battery >= HomeRules::LOW_BATTERY_THRESHOLD) {
+        level = HomeRules::LOW_BATTERY_THRESHOLD;
+        inclusive = false; // low alert fires below 20%
+    } else if (battery > HomeRules::CRITICAL_BATTERY_THRESHOLD) {
+        level = HomeRules::CRITICAL_BATTERY_THRESHOLD;
+        inclusive = true;  // critical alert fires at or below 5%
+    } else {
+        return -1; // already critical; reminders take over
+    }
+
+    auto crossed = [&](long long minutes) {
+        float b = HomeRules::batteryAfter(battery, false, minutes);
+        return inclusive ? b <= level : b < level;
+    };
+
+    // Estimate, then correct for float rounding
+    long long minutes = static_cast<long long>((battery - level) / HomeRules::PASSIVE_DRAIN_RATE);
+    if (minutes < 1) minutes = 1;
+    while (minutes > 1 && crossed(minutes - 1)) --minutes;
+    while (!crossed(minutes)) ++minutes;
+
+    return (elapsedSeconds / HOME_TICK_SECONDS + minutes) * HOME_TICK_SECONDS;
+}
+
+void SimulationEngine::scheduleAlertReminder() {
+    Home* home = pump ? pump->getHome() : nullptr;
+    if (reminderEvent != 0 || !home) {
+        return;
+    }
+    if (home->isBatteryLow() || home->isInsulinLow()) {
+        reminderEvent = events.schedule(elapsedSeconds + ALERT_REMINDER_SECONDS, SimEventType::AlertReminder);
+    }
+}
+
+void SimulationEngine::saveState(SnapshotWriter& out) const {
+    out.write(static_cast<int64_t>(startTime.toMSecsSinceEpoch()));
+    out.write(elapsedSeconds);
+    out.write(batteryEvent);
+    out.write(batteryEventTime);
+    out.write(reminderEvent);
+    out.write(cgmEvent);
+    out.write(basalEvent);
+    out.write(basalEventTime);
+    out.write(eventsProcessed);
+    events.saveState(out);
+}
+
+bool SimulationEngine::restoreState(SnapshotReader& in) {
+    int64_t startMsecs = 0;
+    in.read(startMsecs);
+    in.read(elapsedSeconds);
+    setStartTime(QDateTime::fromMSecsSinceEpoch(startMsecs));
+    in.read(batteryEvent);
+    in.read(batteryEventTime);
+    in.read(reminderEvent);
+    in.read(cgmEvent);
+    in.read(basalEvent);
+    in.read(basalEventTime);
+    in.read(eventsProcessed);
+    return events.restoreState(in);
+}
@@ -0,0 +1,93 @@
+#ifndef SIMULATIONENGINE_H
+#define SIMULATIONENGINE_H
+
+#include <QDateTime>
+#include <functional>
+#include "eventQueue.h"
+
+class SnapshotWriter;
+class SnapshotReader;
+
+class Pump;
+
+// Virtual-clock, discrete-event simulation engine. Advances Home, Pump and
+// the active Bolus in simulated time, as fast as the CPU allows. Between
+// events state evolves in closed form (battery, IOB) or by one adaptive
+// integration (glucose), so idle stretches cost nothing. Real-time pacing
+// (the GUI) is layered on top by RealTimePacer.
+class SimulationEngine {
+    public:
+        explicit SimulationEngine(Pump* pump);
+
+        // Advance the simulation by the given number of simulated seconds
+        void advance(long long seconds);
+        void runMinutes(long long minutes) { advance(minutes * 60); }
+        void runDays(int days) { advance(static_cast<long long>(days) * SECONDS_PER_DAY); }
+
+        // Simulated clock
+        long long getElapsedSeconds() const { return elapsedSeconds; }
+        QDateTime getStartTime() const { return startTime; }
+        void setStartTime(const QDateTime& start);
+        QDateTime getCurrentTime() const;
+
+        Pump* getPump() { return pump; }
+        EventQueue& getEventQueue() { return events; }
+        long long getEventsProcessed() const { return eventsProcessed; }
+
+        // Called with the simulated time at every five-minute CGM sample, so
+        // a headless run can watch glucose without stepping the clock itself.
+        // Samples are taken while a listener or a pump controller is attached;
+        // the listener is not part of a snapshot.
+        typedef std::function<void(long long elapsedSeconds)> SampleListener;
+        void setSampleListener(SampleListener listener);
+        // Snapshot support for the clock and pending events
+        void saveState(SnapshotWriter& out) const;
+        bool restoreState(SnapshotReader& in);
+
+        static const long long SECONDS_PER_DAY = 24 * 60 * 60;
+
+    private:
+        // Minutes after midnight at an elapsed time
+        int minuteOfDayAt(long long time) const {
+            return static_cast<int>((startSecondOfDay + time) / 60 % (SECONDS_PER_DAY / 60));
+        }
+
+        // Move state forward to `time` with no events in between
+        void advanceTo(long long time);
+        void dispatch(const SimEvent& event);
+
+        // Re-derive events that depend on state the GUI may have changed
+        void scheduleStateEvents();
+        void scheduleBatteryThreshold();
+        // Minute tick at which the battery drains past the next alert level,
+        // or -1 if it will not
+        long long batteryThresholdTime() const;
+        void scheduleAlertReminder();
+        void scheduleDeliveryWakeups();
+        void scheduleCgmSample();
+        void scheduleBasalPulse(long long next);
+
+        Pump* pump;
+        QDateTime startTime;
+        long long startSecondOfDay; // cached from startTime
+        long long elapsedSeconds;
+
+        EventQueue events;
+        EventQueue::EventId batteryEvent;
+        long long batteryEventTime; // when batteryEvent is due; -1 if none
+        EventQueue::EventId reminderEvent;
+        EventQueue::EventId cgmEvent;
+        SampleListener sampleListener;
+        EventQueue::EventId basalEvent;
+        long long basalEventTime;   // when basalEvent is due; -1 if none
+        long long eventsProcessed;
+
+        // Home background updates happen on whole simulated minutes
+        const int HOME_TICK_SECONDS = 60;
+        // Standing alerts are re-raised this often while they persist
+        const int ALERT_REMINDER_SECONDS = 15 * 60;
+        // CGM sensors report every five minutes
+        const int CGM_SAMPLE_SECONDS = 5 * 60;
+};
+
+#endif // SIMULATIONENGINE_H
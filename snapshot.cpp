@@ -0,0 +1,17 @@
+#include "snapshot.h"
+
+void SnapshotWriter::writeString(const std::string& s) {
+    write(static_cast<uint64_t>(s.size()));
+    buffer.insert(buffer.end(), s.begin(), s.end());
+}
+
+bool SnapshotReader::readString(std::string& s) {
+    uint64_t length = 0;
+    if (!read(length) || length > static_cast<uint64_t>(end - cursor)) {
+        valid = false;
+        return false;
+    }
+    s.assign(cursor, static_cast<size_t>(length));
+    cursor += length;
+    return true;
+}
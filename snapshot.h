@@ -0,0 +1,88 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Compact binary snapshot buffers. Values are stored as raw native bytes,
+// so a snapshot is only meant to be restored by the same build on the same
+// platform (e.g. forking what-if branches inside one run), not archived.
+class SnapshotWriter {
+    public:
+        SnapshotWriter() {}
+
+        template <class T>
+        void write(const T& value) {
+            static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be trivially copyable");
+            const char* bytes = reinterpret_cast<const char*>(&value);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+        }
+
+        void writeString(const std::string& s);
+
+        template <class T>
+        void writeVector(const std::vector<T>& values) {
+            static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be trivially copyable");
+            write(static_cast<uint64_t>(values.size()));
+            const char* bytes = reinterpret_cast<const char*>(values.data());
+            buffer.insert(buffer.end(), bytes, bytes + values.size() * sizeof(T));
+        }
+
+        const std::vector<char>& data() const { return buffer; }
+        std::vector<char> take() { std::vector<char> out; out.swap(buffer); return out; }
+        void reserve(size_t bytes) { buffer.reserve(bytes); }
+
+    private:
+        std::vector<char> buffer;
+};
+
+// Reads back what SnapshotWriter wrote. Every read is bounds-checked; once a
+// read fails the reader stays invalid and all later reads fail too.
+class SnapshotReader {
+    public:
+        SnapshotReader(const char* data, size_t size) : cursor(data), end(data + size), valid(true) {}
+        explicit SnapshotReader(const std::vector<char>& data)
+            : cursor(data.data()), end(data.data() + data.size()), valid(true) {}
+
+        template <class T>
+        bool read(T& value) {
+            static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be trivially copyable");
+            if (!valid || static_cast<size_t>(end - cursor) < sizeof(T)) {
+                valid = false;
+                return false;
+            }
+            std::memcpy(&value, cursor, sizeof(T));
+            cursor += sizeof(T);
+            return true;
+        }
+
+        bool readString(std::string& s);
+
+        template <class T>
+        bool readVector(std::vector<T>& values) {
+            uint64_t count = 0;
+            if (!read(count) || count > static_cast<uint64_t>(end - cursor) / sizeof(T)) {
+                valid = false;
+                return false;
+            }
+            values.resize(static_cast<size_t>(count));
+            if (count > 0) {
+                std::memcpy(values.data(), cursor, static_cast<size_t>(count) * sizeof(T));
+            }
+            cursor += count * sizeof(T);
+            return true;
+        }
+
+        bool isValid() const { return valid; }
+        bool atEnd() const { return cursor == end; }
+
+    private:
+        const char* cursor;
+        const char* end;
+        bool valid;
+};
+
+#endif // SNAPSHOT_H
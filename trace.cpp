@@ -0,0 +1,29 @@
+#include "trace.h"
+#include <atomic>
+#include <iostream>
+
+namespace {
+
+std::atomic<Trace::Sink> currentSink(&Trace::consoleSink);
+
+}
+
+void Trace::setSink(Sink sink) {
+    currentSink.store(sink, std::memory_order_release);
+}
+
+Trace::Sink Trace::getSink() {
+    return currentSink.load(std::memory_order_acquire);
+}
+
+void Trace::consoleSink(Level level, Category, const std::string& message) {
+    std::ostream& out = (level <= Warning) ? std::cerr : std::cout;
+    out << message << '\n';
+}
+
+void Trace::write(Level level, Category category, const std::string& message) {
+    Sink sink = getSink();
+    if (sink) {
+        sink(level, category, message);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+// Diagnostic tracing with the level and categories fixed at compile time.
+// A TRACE below TRACE_LEVEL or outside TRACE_CATEGORIES compiles to nothing:
+// its message is never formatted and its arguments never evaluated. Enabled
+// traces are formatted only while a sink is installed and handed to it as
+// one string; the default sink writes to the console.
+//
+// Build with, for example, DEFINES += TRACE_LEVEL=1 TRACE_CATEGORIES=0x3
+
+namespace Trace {
+
+    enum Level : int {
+        Error = 0,      // an operation failed
+        Warning = 1,    // a request was refused or adjusted
+        Info = 2,       // something the user asked for happened
+        Debug = 3       // working detail, such as dose breakdowns
+    };
+
+    enum Category : unsigned {
+        Bolus = 1u << 0,
+        Profile = 1u << 1,
+        Home = 1u << 2,
+        Ui = 1u << 3,
+        All = 0xFFFFFFFFu
+    };
+
+    // Receives each enabled trace; may be called from any thread
+    using Sink = void (*)(Level level, Category category, const std::string& message);
+
+    // The sink for all later traces; nullptr drops them unformatted
+    void setSink(Sink sink);
+    Sink getSink();
+    // Errors and warnings to std::cerr, the rest to std::cout
+    void consoleSink(Level level, Category category, const std::string& message);
+
+    void write(Level level, Category category, const std::string& message);
+}
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 3
+#endif
+#ifndef TRACE_CATEGORIES
+#define TRACE_CATEGORIES 0xFFFFFFFFu
+#endif
+
+namespace Trace {
+    constexpr bool enabled(Level level, Category category) {
+        return level <= TRACE_LEVEL && (category & static_cast<unsigned>(TRACE_CATEGORIES)) != 0;
+    }
+}
+
+// TRACE(Warning, Bolus, "Bolus " << id << " is already paused");
+#define TRACE(level, category, message)                                             \
+    do {                                                                            \
+        if constexpr (Trace::enabled(Trace::level, Trace::category)) {              \
+            if (Trace::getSink()) {                                                 \
+                std::ostringstream traceStream;                                     \
+                traceStream << message;                                             \
+                Trace::write(Trace::level, Trace::category, traceStream.str());     \
+            }                                                                       \
+        }                                                                           \
+    } while (0)
+
+#endif // TRACE_H
@@ -0,0 +1,77 @@
+#ifndef UNITS_H
+#define UNITS_H
+
+#include <cmath>
+#include <cstdint>
+
+// Fixed-point amounts for insulin and glucose bookkeeping. A value is a
+// whole number of ticks, so totals add up exactly and come out the same
+// with any compiler, optimization level or thread count. Floats are only
+// used at the edges: profile settings, the glucose model and the UI.
+template <class Tag, int64_t TICKS>
+class FixedPoint {
+    public:
+        static constexpr int64_t TICKS_PER_UNIT = TICKS;
+
+        constexpr FixedPoint() : ticks(0) {}
+
+        static constexpr FixedPoint fromTicks(int64_t ticks) { return FixedPoint(ticks); }
+        static constexpr FixedPoint fromWhole(int64_t units) { return FixedPoint(units * TICKS); }
+        // Nearest tick, ties to even (the rounding the SIMD conversions use
+        // too); NaN is zero and huge values saturate
+        static FixedPoint fromValue(double value) {
+            double scaled = value * static_cast<double>(TICKS);
+            if (scaled != scaled) {
+                return FixedPoint();
+            }
+            if (scaled > LIMIT) scaled = LIMIT;
+            if (scaled < -LIMIT) scaled = -LIMIT;
+            return FixedPoint(static_cast<int64_t>(std::nearbyint(scaled)));
+        }
+
+        constexpr int64_t getTicks() const { return ticks; }
+        // Whole units, rounded toward zero
+        constexpr int64_t getWhole() const { return ticks / TICKS; }
+        constexpr double toDouble() const { return static_cast<double>(ticks) / TICKS; }
+        constexpr float toFloat() const { return static_cast<float>(toDouble()); }
+
+        // Greatest multiple of `step` not above this amount
+        constexpr FixedPoint roundDown(FixedPoint step) const {
+            int64_t rest = ticks % step.ticks;
+            return FixedPoint(ticks - (rest < 0 ? rest + step.ticks : rest));
+        }
+        // numerator/denominator of this amount, rounded toward zero
+        constexpr FixedPoint scaled(int64_t numerator, int64_t denominator) const {
+            return FixedPoint(ticks * numerator / denominator);
+        }
+
+        constexpr FixedPoint operator+(FixedPoint other) const { return FixedPoint(ticks + other.ticks); }
+        constexpr FixedPoint operator-(FixedPoint other) const { return FixedPoint(ticks - other.ticks); }
+        constexpr FixedPoint operator*(int64_t count) const { return FixedPoint(ticks * count); }
+        FixedPoint& operator+=(FixedPoint other) { ticks += other.ticks; return *this; }
+        FixedPoint& operator-=(FixedPoint other) { ticks -= other.ticks; return *this; }
+
+        constexpr bool operator==(FixedPoint other) const { return ticks == other.ticks; }
+        constexpr bool operator!=(FixedPoint other) const { return ticks != other.ticks; }
+        constexpr bool operator<(FixedPoint other) const { return ticks < other.ticks; }
+        constexpr bool operator<=(FixedPoint other) const { return ticks <= other.ticks; }
+        constexpr bool operator>(FixedPoint other) const { return ticks > other.ticks; }
+        constexpr bool operator>=(FixedPoint other) const { return ticks >= other.ticks; }
+
+    private:
+        constexpr explicit FixedPoint(int64_t t) : ticks(t) {}
+
+        static constexpr double LIMIT = 1e15; // ticks; far past any real amount, well inside int64
+
+        int64_t ticks;
+};
+
+struct InsulinTag;
+struct GlucoseTag;
+
+// Insulin in 0.001 U ticks, fine enough for any pump's increments
+typedef FixedPoint<InsulinTag, 1000> InsulinUnits;
+// Glucose in 0.1 mg/dL ticks, the resolution of a sensor reading
+typedef FixedPoint<GlucoseTag, 10> GlucoseMgdl;
+
+#endif // UNITS_H
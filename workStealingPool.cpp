@@ -0,0 +1,96 @@
+#include "workStealingPool.h"
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+    : queued(0), pending(0), steals(0), nextQueue(0), stopping(false) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+    }
+
+    for (unsigned i = 0; i < threads; ++i) {
+        queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
+
+// Tasks are dealt round-robin; stealing evens out any imbalance later
+void WorkStealingPool::submit(std::function<void()> task) {
+    unsigned index = nextQueue.fetch_add(1) % queues.size();
+    pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> guard(queues[index]->lock);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        queued.fetch_add(1);
+    }
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(sleepLock);
+    allDone.wait(lock, [this] { return pending.load() == 0; });
+}
+
+bool WorkStealingPool::popLocal(unsigned index, std::function<void()>& task) {
+    WorkerQueue& q = *queues[index];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(unsigned thief, std::function<void()>& task) {
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        WorkerQueue& q = *queues[(thief + offset) % queues.size()];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            steals.fetch_add(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(unsigned index) {
+    std::function<void()> task;
+    for (;;) {
+        if (popLocal(index, task) || steal(index, task)) {
+            queued.fetch_sub(1);
+            task();
+            task = nullptr;
+
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> guard(sleepLock);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        // Nothing to run anywhere: sleep until new work or shutdown
+        std::unique_lock<std::mutex> lock(sleepLock);
+        workAvailable.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
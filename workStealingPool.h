@@ -0,0 +1,54 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool where every worker owns a task deque. Workers pop
+// their own work from the back and steal from the front of other workers'
+// deques when they run dry, so there is no single shared queue to contend on.
+class WorkStealingPool {
+    public:
+        explicit WorkStealingPool(unsigned threads = 0); // 0 = one per core
+        ~WorkStealingPool();
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        void submit(std::function<void()> task);
+        void wait(); // block until every submitted task has finished
+
+        unsigned getThreadCount() const { return static_cast<unsigned>(workers.size()); }
+        size_t getStealCount() const { return steals.load(); }
+
+    private:
+        struct WorkerQueue {
+            std::mutex lock;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        void workerLoop(unsigned index);
+        bool popLocal(unsigned index, std::function<void()>& task);
+        bool steal(unsigned thief, std::function<void()>& task);
+
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+        std::vector<std::thread> workers;
+
+        std::atomic<size_t> queued;   // tasks sitting in some deque
+        std::atomic<size_t> pending;  // tasks submitted but not finished
+        std::atomic<size_t> steals;
+        std::atomic<unsigned> nextQueue;
+        bool stopping;
+
+        std::mutex sleepLock;
+        std::condition_variable workAvailable;
+        std::condition_variable allDone;
+};
+
+#endif // WORKSTEALINGPOOL_H